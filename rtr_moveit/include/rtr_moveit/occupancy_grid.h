@@ -0,0 +1,163 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Dense bitset representation of occupancy voxels
+ */
+
+#ifndef RTR_MOVEIT_OCCUPANCY_GRID_H
+#define RTR_MOVEIT_OCCUPANCY_GRID_H
+
+// C++
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// RapidPlan
+#include <rtr-occupancy/Voxel.hpp>
+
+namespace rtr_moveit
+{
+/* Occupancy grid that stores a single bit per voxel of a volume region. Voxels are indexed in X/Y/Z order so that
+ * iterating the bits yields voxels in the same lexicographical order as the voxel lists of the OccupancyHandler. */
+class OccupancyGrid
+{
+public:
+  /* @brief Constructor, creates an empty grid without voxels */
+  OccupancyGrid() = default;
+
+  /* @brief Constructor
+   * @param  resolution - the number of voxels along the X/Y/Z axes
+   */
+  explicit OccupancyGrid(const std::array<uint16_t, 3>& resolution);
+
+  /* @brief Sets a new grid resolution and marks all voxels free
+   * @param  resolution - the number of voxels along the X/Y/Z axes
+   */
+  void resize(const std::array<uint16_t, 3>& resolution);
+
+  /* @brief Marks all voxels free */
+  void clear();
+
+  /* @brief Returns the number of voxels along the X/Y/Z axes */
+  const std::array<uint16_t, 3>& getResolution() const
+  {
+    return resolution_;
+  }
+
+  /* @brief Returns the number of occupied voxels */
+  std::size_t count() const;
+
+  /* @brief Returns true if no voxel is occupied */
+  bool empty() const;
+
+  /* @brief Returns a hash of resolution and occupied voxels, equal grids have equal hashes */
+  std::size_t hash() const;
+
+  /* @brief Checks if a voxel is occupied, the voxel indices must be inside the grid resolution */
+  bool isOccupied(uint16_t x, uint16_t y, uint16_t z) const
+  {
+    const std::size_t index = getIndex(x, y, z);
+    return (words_[index / WORD_BITS] >> (index % WORD_BITS)) & 1u;
+  }
+
+  /* @brief Checks if any voxel in a range of linear voxel indices is occupied
+   * @param  begin, end - the index range [begin, end) in X/Y/Z order, must be inside the grid
+   */
+  bool isAnyOccupied(std::size_t begin, std::size_t end) const;
+
+  /* @brief Marks a voxel occupied, the voxel indices must be inside the grid resolution */
+  void setOccupied(uint16_t x, uint16_t y, uint16_t z)
+  {
+    const std::size_t index = getIndex(x, y, z);
+    words_[index / WORD_BITS] |= uint64_t(1) << (index % WORD_BITS);
+  }
+
+  /* @brief Marks a voxel free, the voxel indices must be inside the grid resolution */
+  void setFree(uint16_t x, uint16_t y, uint16_t z)
+  {
+    const std::size_t index = getIndex(x, y, z);
+    words_[index / WORD_BITS] &= ~(uint64_t(1) << (index % WORD_BITS));
+  }
+
+  /* @brief Marks a list of voxels occupied
+   * @param  voxels - the occupied voxels
+   * @return false if any voxel is outside of the grid, those voxels are skipped
+   */
+  bool setOccupied(const std::vector<rtr::Voxel>& voxels);
+
+  /* @brief Appends all occupied voxels to a voxel list in lexicographical X/Y/Z order
+   * @param  voxels - the voxel list
+   */
+  void toVoxels(std::vector<rtr::Voxel>& voxels) const;
+
+  /* @brief Marks all voxels occupied that are occupied in the other grid (union)
+   * @return false if the grid resolutions don't match
+   */
+  bool merge(const OccupancyGrid& other);
+
+  /* @brief Marks all voxels free that are not occupied in the other grid (intersection)
+   * @return false if the grid resolutions don't match
+   */
+  bool intersect(const OccupancyGrid& other);
+
+  /* @brief Marks all voxels free that are occupied in the other grid (difference)
+   * @return false if the grid resolutions don't match
+   */
+  bool subtract(const OccupancyGrid& other);
+
+  bool operator==(const OccupancyGrid& other) const
+  {
+    return resolution_ == other.resolution_ && words_ == other.words_;
+  }
+
+  bool operator!=(const OccupancyGrid& other) const
+  {
+    return !(*this == other);
+  }
+
+private:
+  static constexpr std::size_t WORD_BITS = 64;
+
+  std::size_t getIndex(uint16_t x, uint16_t y, uint16_t z) const
+  {
+    return (static_cast<std::size_t>(x) * resolution_[1] + y) * resolution_[2] + z;
+  }
+
+  std::array<uint16_t, 3> resolution_ = { { 0, 0, 0 } };
+  std::vector<uint64_t> words_;
+};
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_OCCUPANCY_GRID_H
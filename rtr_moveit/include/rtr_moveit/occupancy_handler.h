@@ -39,9 +39,21 @@
 #ifndef RTR_MOVEIT_OCCUPANCY_HANDLER_H
 #define RTR_MOVEIT_OCCUPANCY_HANDLER_H
 
+// C++
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
 // C++ synchronization
 #include <tf/transform_listener.h>
 
+// Eigen
+#include <Eigen/StdVector>
+
 // PCL
 #include <pcl/pcl_base.h>
 
@@ -50,54 +62,244 @@
 
 // rtr_moveit
 #include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/voxelization.h>
 
 namespace rtr_moveit
 {
 class OccupancyHandler
 {
 public:
+  // Methods for generating voxels from planning scenes
+  enum VoxelizationMethod
+  {
+    OBJECT_LOCAL,  // voxelize collision objects inside their bounding boxes using exact shape tests
+    FULL_SWEEP     // check all voxels of the volume for collisions with the complete collision world
+  };
+
   /* @brief Constructor */
   OccupancyHandler(const ros::NodeHandle& nh);
 
-  /* @brief Set the volume region for all occupancy data queries
-   * @param  roadmap_volume  - The new region
-   */
-  void setVolumeRegion(const RoadmapVolume& roadmap_volume);
-
   /* @brief Set the point cloud topic for all pcl queries
    * @param  pcl_topic  - The new pcl topic
    */
   void setPointCloudTopic(const std::string& pcl_topic);
 
-  /* @brief Initializes occupancy_data with a new point cloud
+  /* @brief Set the method used for generating voxels from planning scenes
+   * @param  method  - The voxelization method
+   */
+  void setVoxelizationMethod(const VoxelizationMethod& method);
+
+  /* @brief Set the number of threads used for collision checking voxels with FCL
+   * @param  threads  - the number of worker threads, values < 1 select the number of hardware threads
+   */
+  void setVoxelizationThreads(int threads);
+
+  /* @brief Initializes occupancy_data with a new point cloud. Blocks until a point cloud has been received that is
+   *        not older than planner_config/pcl_max_age compared to the time of the call.
+   * @param  volume - the volume region of the query
    * @param  occupancy_data  - the result data including the point cloud
    * @param  timeout - timeout in seconds
+   * @param  cancelled - optional flag that aborts waiting for point clouds if set
    * @return true on success
    */
-  bool fromPointCloud(OccupancyData& occupancy_data, double timeout = 1.0);
+  bool fromPointCloud(const RoadmapVolume& volume, OccupancyData& occupancy_data, double timeout = 1.0,
+                      const std::atomic<bool>* cancelled = nullptr);
+
+  /* @brief Adds a point cloud sensor that is used for fusing occupancy data with fromFusedSources()
+   * @param  name - the sensor name, an existing sensor with the same name is replaced
+   * @param  pcl_topic - the point cloud topic of the sensor
+   * @param  max_age - the maximum age of point clouds in seconds
+   */
+  void addPointCloudSensor(const std::string& name, const std::string& pcl_topic, double max_age);
+
+  /* @brief Generates an occupancy grid that combines the planning scene voxels with the latest point clouds of all
+   *        sensors. Blocks until all sensors have received point clouds that are recent enough.
+   * @param  planning_scene  - the planning scene
+   * @param  volume - the volume region of the query
+   * @param  occupancy_data  - the result data including the fused occupancy grid
+   * @param  timeout - timeout in seconds for waiting for point clouds
+   * @param  cancelled - optional flag that aborts voxelization and waiting for point clouds if set
+   * @return true on success
+   */
+  bool fromFusedSources(const planning_scene::PlanningSceneConstPtr& planning_scene, const RoadmapVolume& volume,
+                        OccupancyData& occupancy_data, double timeout = 1.0,
+                        const std::atomic<bool>* cancelled = nullptr);
+
+  /* @brief Voxelizes a point cloud without converting it. X/Y/Z coordinates are read from the serialized cloud data
+   *        and points outside of the volume region are dropped.
+   * @param  cloud - the point cloud
+   * @param  volume - the volume region that defines the grid resolution
+   * @param  volume_to_cloud - the transform of the cloud frame relative to the volume origin corner
+   * @param  grid - the occupied voxels are added to this grid, it's resized if the resolution doesn't match
+   * @return false if the cloud has no float32 x/y/z fields or an invalid data layout
+   */
+  bool voxelizePointCloud(const pcl::PCLPointCloud2& cloud, const RoadmapVolume& volume,
+                          const Eigen::Isometry3d& volume_to_cloud, OccupancyGrid& grid) const;
 
   /* @brief Generates a list of occupancy voxels given a planning scene
    * @param  planning_scene  - the planning scene
+   * @param  volume - the volume region of the query
    * @param  occupancy_data  - the result data including the voxels
-   * @return true on success
+   * @param  cancelled - optional flag that aborts the voxelization if set
+   * @return true on success, false if the voxelization has been cancelled
    */
-  bool fromPlanningScene(const planning_scene::PlanningSceneConstPtr& planning_scene, OccupancyData& occupancy_data);
+  bool fromPlanningScene(const planning_scene::PlanningSceneConstPtr& planning_scene, const RoadmapVolume& volume,
+                         OccupancyData& occupancy_data, const std::atomic<bool>* cancelled = nullptr);
+
+  /* @brief Clears the cached voxels of all volume regions */
+  void clearOccupancyCache();
 
 private:
+  // Point cloud sensor used for occupancy fusion
+  struct PointCloudSensor
+  {
+    std::string topic;
+    double max_age;
+    ros::Subscriber subscriber;
+    pcl::PCLPointCloud2ConstPtr cloud;
+  };
+
+  // Voxels of a single collision object together with the object state they have been generated from
+  struct ObjectVoxels
+  {
+    std::vector<shapes::ShapeConstPtr> shapes;
+    decltype(collision_detection::World::Object::shape_poses_) shape_poses;
+    // fingerprint of the occupied octree leaves, octrees are modified without changing the shape or pose
+    uint64_t octree_fingerprint = 0;
+    std::vector<rtr::Voxel> voxels;
+  };
+
+  // Voxels of all collision objects inside a volume region, only valid for a fixed volume pose in the planning frame
+  struct VolumeOccupancyCache
+  {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    RoadmapVolume volume;
+    Eigen::Isometry3d world_to_volume;
+    std::map<std::string, ObjectVoxels> objects;
+    OccupancyGrid grid;
+    std::vector<rtr::Voxel> voxels;
+  };
+
   /* Callback function for point cloud subscribers
    * @param  cloud_pcl2 - the pointer of a new sensed point cloud
    */
   void pclCallback(const pcl::PCLPointCloud2ConstPtr& cloud_pcl2);
 
+  /* Callback function for point cloud sensor subscribers
+   * @param  cloud_pcl2 - the pointer of a new sensed point cloud
+   * @param  name - the name of the sensor
+   */
+  void sensorCallback(const pcl::PCLPointCloud2ConstPtr& cloud_pcl2, const std::string& name);
+
+  /* Looks up the transform of a point cloud frame in the frame of the volume region
+   * @param  volume - the volume region
+   * @param  cloud_frame - the point cloud frame
+   * @param  cloud_to_volume - the transform of the cloud frame
+   * @return false if the transform is not available
+   */
+  bool lookupCloudTransform(const RoadmapVolume& volume, const std::string& cloud_frame,
+                            tf::StampedTransform& cloud_to_volume);
+
+  /* Voxelizes all collision objects of the planning scene separately. Voxels of objects that didn't change since
+   * the last call are reused from the occupancy cache of the volume region. Sensor updates modify octrees
+   * without changing the shape or pose, so objects with octree shapes are voxelized again if the fingerprint of
+   * their occupied leaves has changed.
+   * @param  planning_scene  - the planning scene
+   * @param  volume - the volume region
+   * @param  world_to_volume - the transform of the volume origin corner in the planning frame
+   * @param  voxels  - the occupied voxels in lexicographical order
+   * @param  cancelled - optional flag that aborts the voxelization if set, partial results are not cached
+   * @return false if the voxelization has been cancelled
+   */
+  bool voxelizeCollisionObjects(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                const RoadmapVolume& volume, const Eigen::Isometry3d& world_to_volume,
+                                std::vector<rtr::Voxel>& voxels, const std::atomic<bool>* cancelled);
+
+  /* Voxelizes all shapes of a single collision object
+   * @param  voxelizer - the voxelizer of the volume region
+   * @param  object - the collision object
+   * @param  world_to_volume - the transform of the volume origin corner in the planning frame
+   * @param  voxels  - the occupied voxels are appended to this list, duplicates are possible
+   * @param  cancelled - optional flag that aborts the voxelization if set
+   */
+  void voxelizeCollisionObject(const ShapeVoxelizer& voxelizer, const collision_detection::World::Object& object,
+                               const Eigen::Isometry3d& world_to_volume, std::vector<rtr::Voxel>& voxels,
+                               const std::atomic<bool>* cancelled);
+
+  /* Returns the occupancy cache of a volume region, the cache is reset if the volume has been moved.
+   * Must be called with cache_mutex_ locked.
+   * @param  volume - the volume region
+   * @param  world_to_volume - the transform of the volume origin corner in the planning frame
+   * @return the cache entry of the volume region
+   */
+  VolumeOccupancyCache& getVolumeOccupancyCache(const RoadmapVolume& volume, const Eigen::Isometry3d& world_to_volume);
+
+  /* Checks all voxels of a given range for collisions with the shapes of a collision object
+   * @param  object - the collision object
+   * @param  shape_ids - the indices of the object shapes to check
+   * @param  voxelizer - the voxelizer of the volume region
+   * @param  world_to_volume - the transform of the volume origin corner in the planning frame
+   * @param  range - the range of voxels to check
+   * @param  voxels  - the occupied voxels are appended to this list
+   * @param  cancelled - optional flag that aborts the collision checks if set
+   */
+  void probeCollisionObject(const collision_detection::World::Object& object, const std::vector<std::size_t>& shape_ids,
+                            const ShapeVoxelizer& voxelizer, const Eigen::Isometry3d& world_to_volume,
+                            const VoxelRange& range, std::vector<rtr::Voxel>& voxels,
+                            const std::atomic<bool>* cancelled);
+
+  /* Moves a voxel box through the complete volume and checks for collisions with the collision world
+   * @param  planning_scene  - the planning scene
+   * @param  volume - the volume region
+   * @param  world_to_volume - the transform of the volume origin corner in the planning frame
+   * @param  voxels  - the occupied voxels in lexicographical order
+   * @param  cancelled - optional flag that aborts the collision checks if set
+   */
+  void sweepVolume(const planning_scene::PlanningSceneConstPtr& planning_scene, const RoadmapVolume& volume,
+                   const Eigen::Isometry3d& world_to_volume, std::vector<rtr::Voxel>& voxels,
+                   const std::atomic<bool>* cancelled);
+
+  /* Moves a voxel box through a range of voxels and checks for collisions with the collision world
+   * @param  planning_scene  - the planning scene
+   * @param  volume - the volume region
+   * @param  world_to_volume - the transform of the volume origin corner in the planning frame
+   * @param  range - the range of voxels to check
+   * @param  voxels  - the occupied voxels are appended to this list in lexicographical order
+   * @param  cancelled - optional flag that aborts the collision checks if set
+   */
+  void sweepVoxelRange(const planning_scene::PlanningSceneConstPtr& planning_scene, const RoadmapVolume& volume,
+                       const Eigen::Isometry3d& world_to_volume, const VoxelRange& range,
+                       std::vector<rtr::Voxel>& voxels, const std::atomic<bool>* cancelled) const;
+
+  /* Splits the X range of voxels into slabs that are processed by the voxelization worker threads. The voxels of all
+   * slabs are appended in the order of the slabs so that the result doesn't depend on the thread scheduling.
+   * @param  range - the range of voxels to split
+   * @param  process_slab - function that computes the voxels of a single slab, it's called concurrently
+   * @param  voxels  - the voxels of all slabs are appended to this list
+   */
+  void processVoxelSlabs(const VoxelRange& range,
+                         const std::function<void(const VoxelRange&, std::vector<rtr::Voxel>&)>& process_slab,
+                         std::vector<rtr::Voxel>& voxels) const;
+
   ros::NodeHandle nh_;
-  RoadmapVolume volume_region_;
+  VoxelizationMethod voxelization_method_ = OBJECT_LOCAL;
+  int voxelization_threads_ = 1;
   std::string pcl_topic_;
+  bool voxelize_point_clouds_ = false;
 
   // PCL synchronization
+  std::mutex pcl_mutex_;
+  std::condition_variable pcl_condition_;
+  double pcl_max_age_ = 0.1;
   pcl::PCLPointCloud2ConstPtr next_cloud_;
+  std::map<std::string, PointCloudSensor> pcl_sensors_;
   bool pcl_ready_ = false;
   ros::Subscriber pcl_sub_;
   tf::TransformListener tf_listener_;
+
+  // Planning scene occupancy cache
+  std::mutex cache_mutex_;
+  std::vector<VolumeOccupancyCache, Eigen::aligned_allocator<VolumeOccupancyCache>> occupancy_cache_;
 };
 }  // namespace rtr_moveit
 
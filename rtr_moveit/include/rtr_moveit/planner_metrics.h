@@ -0,0 +1,180 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Lock-free latency histograms and counters of the planning stages
+ */
+
+#ifndef RTR_MOVEIT_PLANNER_METRICS_H
+#define RTR_MOVEIT_PLANNER_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+#include <diagnostic_msgs/DiagnosticStatus.h>
+
+namespace rtr_moveit
+{
+/** Latency histogram with logarithmic buckets that can be recorded concurrently without locking.
+ *  The bucket bounds grow by a factor of 2^(1/4) starting at 1us, percentiles are accurate to about 19%.
+ */
+class LatencyHistogram
+{
+public:
+  struct Summary
+  {
+    uint64_t count = 0;
+    double p50 = 0.0;  // seconds
+    double p99 = 0.0;  // seconds
+    double max = 0.0;  // seconds
+  };
+
+  LatencyHistogram();
+
+  /** Adds a latency sample in seconds */
+  void record(double seconds);
+
+  /** Returns count, percentiles and maximum of all recorded samples */
+  Summary getSummary() const;
+
+  /** Removes all samples */
+  void reset();
+
+private:
+  static const std::size_t NUM_BUCKETS = 100;  // 1us to ~30s
+  std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> max_nanoseconds_;
+};
+
+/** Always-on metrics of the planner plugin, shared by the planner manager, contexts and the planner interface */
+class PlannerMetrics
+{
+public:
+  enum Stage
+  {
+    SOLVE,                 // complete planning request
+    GOAL_SAMPLING,         // conversion of goal constraints to RapidPlan goals
+    OCCUPANCY,             // occupancy data generation
+    START_STATE,           // start state lookup
+    CHECK_SCENE,           // collision check of the roadmap including cache lookup and roadmap preparation
+    MPA_CHECK_SCENE,       // hardware round-trip of RapidPlanInterface::CheckScene()
+    SOFTWARE_CHECK_SCENE,  // collision check of the roadmap swept volumes on the CPU
+    FIND_PATH,             // single PathPlanner::FindPath() call
+    GOAL_SEARCH,           // graph searches of all goals
+    CONNECT,               // trajectory conversion and start/goal connection checks
+    NUM_STAGES
+  };
+
+  enum Counter
+  {
+    REQUESTS,
+    SUCCESSFUL_REQUESTS,
+    PREEMPTED_REQUESTS,
+    MPA_CHECK_SCENE_CALLS,
+    MPA_ROADMAP_WRITES,
+    COLLISION_CACHE_HITS,
+    COLLISION_CACHE_MISSES,
+    MPA_DEVICE_FAILURES,
+    NUM_COUNTERS
+  };
+
+  PlannerMetrics();
+
+  /** Records the duration of a planning stage in seconds */
+  void recordStage(Stage stage, double seconds)
+  {
+    stages_[stage].record(seconds);
+  }
+
+  /** Increments a counter */
+  void increment(Counter counter)
+  {
+    ++counters_[counter];
+  }
+
+  /** Returns the latency summary of a planning stage */
+  LatencyHistogram::Summary getStageSummary(Stage stage) const
+  {
+    return stages_[stage].getSummary();
+  }
+
+  /** Returns the current value of a counter */
+  uint64_t getCount(Counter counter) const
+  {
+    return counters_[counter];
+  }
+
+  /** Fills a diagnostic status with p50/p99/max of all stages in milliseconds, counters and the cache hit rate */
+  void getDiagnosticStatus(diagnostic_msgs::DiagnosticStatus& status) const;
+
+  /** Resets all histograms and counters */
+  void reset();
+
+  static const char* getStageName(Stage stage);
+  static const char* getCounterName(Counter counter);
+
+private:
+  std::array<LatencyHistogram, NUM_STAGES> stages_;
+  std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters_;
+};
+typedef std::shared_ptr<PlannerMetrics> PlannerMetricsPtr;
+
+/** Records the lifetime of the timer as duration of a planning stage, does nothing if metrics is null */
+class ScopedStageTimer
+{
+public:
+  ScopedStageTimer(const PlannerMetricsPtr& metrics, PlannerMetrics::Stage stage)
+    : metrics_(metrics.get()), stage_(stage), start_(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~ScopedStageTimer()
+  {
+    if (metrics_)
+      metrics_->recordStage(stage_,
+                            std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+  }
+
+private:
+  PlannerMetrics* metrics_;
+  PlannerMetrics::Stage stage_;
+  std::chrono::steady_clock::time_point start_;
+};
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_PLANNER_METRICS_H
@@ -0,0 +1,166 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: A thread-safe cache of immutable roadmap data that is shared between planning contexts
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_CACHE_H
+#define RTR_MOVEIT_ROADMAP_CACHE_H
+
+// C++
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// MoveIt!
+#include <moveit/macros/class_forward.h>
+
+// rtr_moveit
+#include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/roadmap_data.h>
+#include <rtr_moveit/roadmap_coverage.h>
+#include <rtr_moveit/roadmap_swept_volumes.h>
+
+namespace rtr_moveit
+{
+MOVEIT_CLASS_FORWARD(RoadmapCache);
+
+typedef std::shared_ptr<const RoadmapData> RoadmapDataConstPtr;
+
+class RoadmapCache
+{
+public:
+  /** Constructor
+   * @param snapshot_directory - Directory for memory mapped roadmap snapshot files. If empty, roadmap data is read
+   *                             from the .og files into memory.
+   */
+  RoadmapCache(const std::string& snapshot_directory = "");
+
+  /** Returns the cached data of the given roadmap, the roadmap file is loaded on first use.
+   * @param roadmap_spec - The roadmap specification with roadmap_id and og_file
+   * @param roadmap_data - The returned roadmap data
+   * @return true on success, false if the roadmap file could not be loaded
+   */
+  bool getRoadmapData(const RoadmapSpecification& roadmap_spec, RoadmapDataConstPtr& roadmap_data);
+
+  /** Loads the given roadmap into the cache if it is not already cached
+   * @param roadmap_spec - The roadmap specification with roadmap_id and og_file
+   * @return true on success
+   */
+  bool loadRoadmap(const RoadmapSpecification& roadmap_spec);
+
+  /** Returns the cached coverage map of the given roadmap and cell size. It's read from the coverage file next to the
+   *  .og file if that has been created from the current .og file with the same cell size, otherwise it's built from
+   *  the roadmap data.
+   * @param roadmap_spec - The roadmap specification with roadmap_id and og_file
+   * @param cell_size - The edge length of the workspace grid cells in meters
+   * @param use_coverage_file - If true, the coverage file is read and written if outdated
+   * @param coverage - The returned coverage map
+   * @return true on success, false if the roadmap file could not be loaded
+   */
+  bool getRoadmapCoverage(const RoadmapSpecification& roadmap_spec, double cell_size, bool use_coverage_file,
+                          RoadmapCoverageConstPtr& coverage);
+
+  /** Returns the cached swept volumes of all edges of the given roadmap and group. They are read from the swept
+   *  volumes file of the group next to the .og file if that has been created from the current .og file with the
+   *  same robot geometry and interpolation step, otherwise they are built from the roadmap data.
+   * @param roadmap_spec - The roadmap specification with roadmap_id and og_file
+   * @param default_state - The robot state used for all joints that are not part of the group
+   * @param group_name - The planning group of the roadmap configs
+   * @param max_step - The maximum joint distance of interpolated states along an edge
+   * @param num_threads - The number of threads for building the swept volumes
+   * @param use_swept_volumes_file - If true, the swept volumes file is read and written if outdated
+   * @param swept_volumes - The returned swept volumes
+   * @return true on success, false if the roadmap file could not be loaded or doesn't match the group
+   */
+  bool getRoadmapSweptVolumes(const RoadmapSpecification& roadmap_spec, const robot_state::RobotState& default_state,
+                              const std::string& group_name, double max_step, std::size_t num_threads,
+                              bool use_swept_volumes_file, RoadmapSweptVolumesConstPtr& swept_volumes);
+
+  /** Removes a roadmap from the cache. Planning contexts holding its data keep it until they are destroyed. */
+  void removeRoadmap(const std::string& roadmap_id);
+
+  /** Removes all roadmaps from the cache */
+  void clear();
+
+private:
+  /** Loads the roadmap data from a valid snapshot file or the .og file and builds the search indices
+   * @param roadmap_spec - The roadmap specification with roadmap_id and og_file
+   * @param roadmap_data - The populated roadmap data
+   * @return true on success
+   */
+  bool loadRoadmapData(const RoadmapSpecification& roadmap_spec, RoadmapData& roadmap_data) const;
+
+  /** Maps the roadmap snapshot file if it has been created from the current version of the .og file
+   * @param roadmap_spec - The roadmap specification with roadmap_id and og_file
+   * @param stamp - The file stamp of the .og file
+   * @param roadmap_data - The populated roadmap data
+   * @return true on success
+   */
+  bool mapSnapshotFile(const RoadmapSpecification& roadmap_spec, const RoadmapFileStamp& stamp,
+                       RoadmapData& roadmap_data) const;
+
+  /** Reads all roadmap data from the .og file into a buffer in snapshot layout
+   * @param roadmap_spec - The roadmap specification with roadmap_id and og_file
+   * @param stamp - The file stamp of the .og file
+   * @param buffer - The returned buffer
+   * @return true on success
+   */
+  bool readRoadmapFile(const RoadmapSpecification& roadmap_spec, const RoadmapFileStamp& stamp,
+                       std::vector<char>& buffer) const;
+
+  /** Returns the path of the snapshot file of a roadmap */
+  std::string getSnapshotFile(const std::string& roadmap_id) const;
+
+  /** Returns the path of the coverage file of a roadmap, which is the .og file with extension .coverage */
+  std::string getCoverageFile(const RoadmapSpecification& roadmap_spec) const;
+
+  /** Returns the path of the swept volumes file of a roadmap and group, the .og file with extension .<group>.swept */
+  std::string getSweptVolumesFile(const RoadmapSpecification& roadmap_spec, const std::string& group_name) const;
+
+  const std::string snapshot_directory_;
+
+  // cached roadmaps by roadmap_id
+  std::map<std::string, RoadmapDataConstPtr> roadmaps_;
+  // cached coverage maps by roadmap_id and cell size, maps of other cell sizes are never reused
+  std::map<std::pair<std::string, double>, RoadmapCoverageConstPtr> coverages_;
+  // cached swept volumes by group name and roadmap_id
+  std::map<std::pair<std::string, std::string>, RoadmapSweptVolumesConstPtr> swept_volumes_;
+  std::mutex mutex_;
+};
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_CACHE_H
@@ -0,0 +1,140 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Compact workspace and joint space coverage maps of roadmaps for checking requests without loading roadmaps
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_COVERAGE_H
+#define RTR_MOVEIT_ROADMAP_COVERAGE_H
+
+// C++
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+
+// rtr_moveit
+#include <rtr_moveit/roadmap_data.h>
+
+namespace rtr_moveit
+{
+/** Coverage map of a roadmap. The tool positions of all roadmap states are marked in a voxel grid in the roadmap
+ *  base link frame and the joint space is bounded by the limits of all roadmap configs. Both are conservative, a
+ *  region that isn't covered can't contain any roadmap state. */
+class RoadmapCoverage
+{
+public:
+  /** Builds the coverage map from roadmap data
+   * @param roadmap_data - The roadmap data with configs and tool poses
+   * @param cell_size - The edge length of the workspace grid cells in meters
+   */
+  void build(const RoadmapData& roadmap_data, double cell_size);
+
+  /** Returns the L1 distance between a joint space box and the bounds of all roadmap configs. This is a lower bound
+   *  of the distance of any config inside the box to the closest roadmap config.
+   * @param lower, upper - The bounds of the joint space box, infinite bounds are allowed
+   * @return the distance or 0.0 if the dimension doesn't match
+   */
+  double getJointDistance(const std::vector<double>& lower, const std::vector<double>& upper) const;
+
+  /** Checks if a grid cell with roadmap tool positions is within a distance to a given position
+   * @param position - The position in the roadmap base link frame
+   * @param distance - The allowed distance of roadmap tool positions
+   * @return false if no roadmap tool position is within distance to position
+   */
+  bool coversPosition(const Eigen::Vector3d& position, double distance) const;
+
+  /** Serializes the coverage map
+   * @param stamp - The file stamp of the .og file the roadmap data was read from
+   * @param buffer - The returned buffer
+   */
+  void serialize(const RoadmapFileStamp& stamp, std::vector<char>& buffer) const;
+
+  /** Initializes the coverage map from a serialized buffer
+   * @param data, size - The buffer created by serialize()
+   * @param stamp - The expected file stamp of the .og file, buffers of other file versions are rejected
+   * @param cell_size - The expected cell size, buffers with other cell sizes are rejected
+   * @return true on success
+   */
+  bool deserialize(const char* data, std::size_t size, const RoadmapFileStamp& stamp, double cell_size);
+
+  const std::string& getBaseLinkFrame() const
+  {
+    return base_link_frame_;
+  }
+
+  const std::string& getEndEffectorFrame() const
+  {
+    return end_effector_frame_;
+  }
+
+  std::size_t getDimension() const
+  {
+    return joint_lower_.size();
+  }
+
+  double getCellSize() const
+  {
+    return cell_size_;
+  }
+
+private:
+  bool isCovered(std::size_t x, std::size_t y, std::size_t z) const
+  {
+    const std::size_t index = (x * grid_size_[1] + y) * grid_size_[2] + z;
+    return (cells_[index / 64] >> (index % 64)) & 1;
+  }
+
+  std::string base_link_frame_;
+  std::string end_effector_frame_;
+
+  // bounds of all roadmap configs
+  std::vector<float> joint_lower_;
+  std::vector<float> joint_upper_;
+
+  // voxel grid of roadmap tool positions as bit field
+  double cell_size_ = 0.0;
+  Eigen::Vector3d grid_origin_ = Eigen::Vector3d::Zero();
+  std::array<uint32_t, 3> grid_size_ = { { 0, 0, 0 } };
+  std::vector<uint64_t> cells_;
+};
+typedef std::shared_ptr<const RoadmapCoverage> RoadmapCoverageConstPtr;
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_COVERAGE_H
@@ -0,0 +1,157 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: Immutable roadmap data in a flat memory layout that can be mapped from a snapshot file
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_DATA_H
+#define RTR_MOVEIT_ROADMAP_DATA_H
+
+// C++
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// RapidPlan
+#include <rtr-api/RapidPlanDataTypes.hpp>
+
+// rtr_moveit
+#include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/roadmap_index.h>
+
+namespace rtr_moveit
+{
+// number of floats of a tool pose (x, y, z, roll, pitch, yaw)
+const std::size_t POSE_SIZE = 6;
+
+// Identifies the version of an .og file that a roadmap snapshot was created from
+struct RoadmapFileStamp
+{
+  uint64_t size;
+  int64_t modification_time;  // nanoseconds since epoch
+};
+
+// Roadmap data loaded from an .og file. Configs, poses and edges are views into a contiguous buffer which is either
+// a memory mapped snapshot file or a heap allocation owned by storage. Instances are never modified after loading.
+struct RoadmapData
+{
+  // roadmap specification with volume region and kinematic frames read from the .og file
+  RoadmapSpecification spec;
+
+  std::size_t dimension = 0;        // joint count of roadmap configs
+  std::size_t num_states = 0;       // number of roadmap configs and poses
+  std::size_t num_edges = 0;        // number of roadmap edges
+  const float* configs = nullptr;   // num_states rows of dimension joint values
+  const float* poses = nullptr;     // num_states rows of POSE_SIZE tool pose values
+  const uint32_t* edges = nullptr;  // num_edges pairs of start and end state ids
+
+  // search indices for start and goal state candidates
+  RoadmapConfigIndex config_index;
+  RoadmapPoseIndex pose_index;
+
+  // keeps the buffer of configs, poses and edges alive
+  std::shared_ptr<const void> storage;
+
+  const float* getConfig(std::size_t state_id) const
+  {
+    return configs + state_id * dimension;
+  }
+
+  const float* getPose(std::size_t state_id) const
+  {
+    return poses + state_id * POSE_SIZE;
+  }
+
+  std::size_t getEdgeStart(std::size_t edge_id) const
+  {
+    return edges[2 * edge_id];
+  }
+
+  std::size_t getEdgeEnd(std::size_t edge_id) const
+  {
+    return edges[2 * edge_id + 1];
+  }
+};
+
+/** Reads size and modification time of a file
+ * @param file - The file path
+ * @param stamp - The returned file stamp
+ * @return true on success, false if the file doesn't exist
+ */
+bool getRoadmapFileStamp(const std::string& file, RoadmapFileStamp& stamp);
+
+/** Serializes roadmap data into the flat layout of roadmap snapshot files
+ * @param spec - The roadmap specification with volume region and kinematic frames
+ * @param configs - The roadmap configs, all of the same dimension
+ * @param poses - The tool poses of all roadmap configs
+ * @param edges - The roadmap edges
+ * @param stamp - The file stamp of the .og file the data was read from
+ * @param buffer - The returned buffer
+ */
+void writeRoadmapBuffer(const RoadmapSpecification& spec, const std::vector<rtr::Config>& configs,
+                        const std::vector<rtr::ToolPose>& poses, const std::vector<rtr::EdgeInfo>& edges,
+                        const RoadmapFileStamp& stamp, std::vector<char>& buffer);
+
+/** Initializes roadmap data as views into a buffer created by writeRoadmapBuffer(). Search indices are not built.
+ * @param storage - Owner of the buffer, stored in roadmap_data
+ * @param data - The start of the buffer, needs to be aligned to 8 bytes
+ * @param size - The buffer size in bytes
+ * @param stamp - The expected file stamp of the .og file, buffers of other file versions are rejected
+ * @param roadmap_data - The populated roadmap data, roadmap_id and og_file of spec are not modified
+ * @return true on success, false if the buffer is invalid or doesn't match the stamp
+ */
+bool readRoadmapBuffer(const std::shared_ptr<const void>& storage, const char* data, std::size_t size,
+                       const RoadmapFileStamp& stamp, RoadmapData& roadmap_data);
+
+/** Maps a file read-only into memory
+ * @param file - The file path
+ * @param storage - The returned mapping, the file is unmapped when the last reference is destroyed
+ * @param data - The returned start of the mapped file
+ * @param size - The returned file size in bytes
+ * @return true on success
+ */
+bool mapRoadmapFile(const std::string& file, std::shared_ptr<const void>& storage, const char*& data,
+                    std::size_t& size);
+
+/** Writes a buffer to a file. The data is written to a temporary file first that replaces the file when complete,
+ * so that concurrent readers never map partially written files.
+ * @param file - The file path
+ * @param buffer - The data to write
+ * @return true on success
+ */
+bool writeRoadmapFile(const std::string& file, const std::vector<char>& buffer);
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_DATA_H
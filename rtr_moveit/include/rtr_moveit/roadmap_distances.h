@@ -0,0 +1,158 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Batched distance kernels for roadmap states stored in structure-of-arrays layout
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_DISTANCES_H
+#define RTR_MOVEIT_ROADMAP_DISTANCES_H
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace rtr_moveit
+{
+/** Computes the L1 joint distances of a query config to a batch of configs. The batch stores one column of joint
+ * values per joint, so that all loops run over contiguous memory and are vectorized with OpenMP SIMD.
+ * The summation order is the same as in getConfigDistance() which yields exactly the same distances.
+ * @param query - The joint values of the query config
+ * @param columns - The joint columns, joint j of item i is at columns[j * stride + i]
+ * @param stride - The offset between two joint columns
+ * @param dimension - The number of joints
+ * @param count - The number of configs in the batch
+ * @param distances - The resulting distances of all configs, needs to have space for count elements
+ */
+void computeConfigDistances(const float* query, const float* columns, std::size_t stride, std::size_t dimension,
+                            std::size_t count, float* distances);
+
+/** Computes the L2 position distances of a query position to a batch of tool poses. The batch stores the x, y and z
+ * coordinates in separate columns. Squares are accumulated the same way as in getPositionDistance() which yields
+ * exactly the same distances.
+ * @param query - The x/y/z coordinates of the query position
+ * @param columns - The coordinate columns, coordinate d of item i is at columns[d * stride + i]
+ * @param stride - The offset between two coordinate columns
+ * @param count - The number of tool poses in the batch
+ * @param distances - The resulting distances of all tool poses, needs to have space for count elements
+ */
+void computePositionDistances(const float* query, const float* columns, std::size_t stride, std::size_t count,
+                              float* distances);
+
+/** Selects the k closest items of a stream of candidates using a bounded max-heap.
+ *  Items with equal distances are ordered by index.
+ */
+class ClosestItemSelector
+{
+public:
+  /** Constructor
+   * @param max_results - The maximum number of selected items
+   * @param distance_threshold - Only items with smaller distances are selected
+   */
+  ClosestItemSelector(std::size_t max_results, float distance_threshold)
+    : max_results_(max_results), distance_threshold_(distance_threshold)
+  {
+  }
+
+  /** Returns the distance an item needs to fall below in order to be selected */
+  float getMaxDistance() const
+  {
+    return candidates_.size() < max_results_ ? distance_threshold_ : candidates_.front().first;
+  }
+
+  /** Adds a batch of candidates
+   * @param ids - The item indices
+   * @param distances - The item distances
+   * @param count - The number of candidates
+   */
+  void add(const std::size_t* ids, const float* distances, std::size_t count)
+  {
+    // most candidates are rejected by comparing with the current bound only
+    float max_distance = getMaxDistance();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      if (distances[i] > max_distance)
+        continue;
+      add(ids[i], distances[i]);
+      max_distance = getMaxDistance();
+    }
+  }
+
+  /** Adds a single candidate */
+  void add(std::size_t id, float distance)
+  {
+    if (distance >= distance_threshold_ || max_results_ == 0)
+      return;
+    const Candidate candidate(distance, id);
+    if (candidates_.size() < max_results_)
+    {
+      candidates_.push_back(candidate);
+      std::push_heap(candidates_.begin(), candidates_.end());
+    }
+    else if (candidate < candidates_.front())
+    {
+      std::pop_heap(candidates_.begin(), candidates_.end());
+      candidates_.back() = candidate;
+      std::push_heap(candidates_.begin(), candidates_.end());
+    }
+  }
+
+  /** Returns the selected items in increasing order of distance, the selector is empty afterwards
+   * @param result_ids - The indices of the selected items
+   * @param result_distances - The distances of the selected items
+   */
+  void getResults(std::vector<std::size_t>& result_ids, std::vector<float>& result_distances)
+  {
+    std::sort_heap(candidates_.begin(), candidates_.end());
+    result_ids.resize(candidates_.size());
+    result_distances.resize(candidates_.size());
+    for (std::size_t i = 0; i < candidates_.size(); ++i)
+    {
+      result_distances[i] = candidates_[i].first;
+      result_ids[i] = candidates_[i].second;
+    }
+    candidates_.clear();
+  }
+
+private:
+  typedef std::pair<float, std::size_t> Candidate;
+
+  std::size_t max_results_;
+  float distance_threshold_;
+  std::vector<Candidate> candidates_;
+};
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_DISTANCES_H
@@ -0,0 +1,130 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: KD-tree index for nearest neighbor queries on roadmap states and tool poses
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_INDEX_H
+#define RTR_MOVEIT_ROADMAP_INDEX_H
+
+#include <cfloat>
+#include <utility>
+#include <vector>
+
+#include <rtr_moveit/roadmap_distances.h>
+
+#include <rtr-api/RapidPlanDataTypes.hpp>  // contains rtr::Config, rtr::ToolPose
+
+namespace rtr_moveit
+{
+/** KD-tree over roadmap items of type T (rtr::Config or rtr::ToolPose) that answers the same queries as
+ * findClosest<T>() in roadmap_search.h with identical results. Configs are indexed over all joints using the
+ * L1 joint distance, tool poses are indexed by position using the L2 distance.
+ * The index stores a copy of the item coordinates in structure-of-arrays layout sorted by KD-tree leaves, so that
+ * the distances of all items in a leaf are computed with the batched kernels of roadmap_distances.h.
+ */
+template <class T>
+class RoadmapIndex
+{
+public:
+  /** Builds the KD-tree for a list of items
+   * @param items - The list of items to index
+   * @param leaf_size - The maximum number of items in a KD-tree leaf
+   */
+  void build(const std::vector<T>& items, std::size_t leaf_size = 16);
+
+  /** Builds the KD-tree for a list of items that are stored contiguously as rows of floats
+   * @param rows - The item coordinates, row i starts at rows + i * stride
+   * @param count - The number of items
+   * @param stride - The number of floats per row (joint count of configs, 6 for tool poses)
+   * @param leaf_size - The maximum number of items in a KD-tree leaf
+   */
+  void build(const float* rows, std::size_t count, std::size_t stride, std::size_t leaf_size = 16);
+
+  /** Removes all items from the index */
+  void clear();
+
+  /** Returns true if the index doesn't contain any items */
+  bool empty() const
+  {
+    return ids_.empty();
+  }
+
+  /** Find indices and distances of n closest items within a distance threshold to a given item.
+   * @param item - The item to compare
+   * @param result_ids - The indices of the closest items with distances in increasing order
+   * @param result_distances - The distances of the result items in increasing order
+   * @param max_results - The maximum size of the result set
+   * @param distance_threshold - The allowed distance of result items from item
+   */
+  void findClosest(const T& item, std::vector<std::size_t>& result_ids, std::vector<float>& result_distances,
+                   const std::size_t max_results = 1, const float& distance_threshold = FLT_MAX) const;
+
+  /** Same as findClosest(), but computes the distances of all items without the KD-tree. The distances are computed
+   *  in blocks of the structure-of-arrays coordinates with the batched kernels, which is faster than traversing the
+   *  KD-tree if most leaves need to be visited, for instance with large distance thresholds or many results.
+   */
+  void findClosestLinear(const T& item, std::vector<std::size_t>& result_ids, std::vector<float>& result_distances,
+                         const std::size_t max_results = 1, const float& distance_threshold = FLT_MAX) const;
+
+private:
+  // KD-tree node, leaves have no children and contain the item ids in [begin, end)
+  struct Node
+  {
+    std::size_t begin;
+    std::size_t end;
+    std::size_t split_dimension;
+    float split_value;
+    std::size_t children[2];
+  };
+
+  std::size_t buildNode(const float* rows, std::size_t stride, std::size_t begin, std::size_t end);
+  void searchNode(std::size_t node_id, const T& item, ClosestItemSelector& selector,
+                  std::vector<float>& leaf_distances) const;
+
+  std::size_t dimension_ = 0;
+  std::size_t leaf_size_ = 0;
+  // item ids in KD-tree order
+  std::vector<std::size_t> ids_;
+  // item coordinates in KD-tree order, one column of ids_.size() values per dimension
+  std::vector<float> coordinates_;
+  std::vector<Node> nodes_;
+};
+
+typedef RoadmapIndex<rtr::Config> RoadmapConfigIndex;
+typedef RoadmapIndex<rtr::ToolPose> RoadmapPoseIndex;
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_INDEX_H
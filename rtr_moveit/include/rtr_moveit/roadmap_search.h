@@ -42,6 +42,8 @@
 #include <string>
 #include <vector>
 
+#include <rtr_moveit/roadmap_distances.h>
+
 #include <rtr-api/RapidPlanDataTypes.hpp>  // contains rtr::Config, rtr::ToolPose
 
 namespace rtr_moveit
@@ -117,34 +119,11 @@ void findClosest(const T& item, const std::vector<T>& items, std::vector<std::si
   result_distances.clear();
   if (!items.empty() && max_results != 0 && distance_threshold > 0.0)
   {
-    // iterate items
+    // iterate items and keep the closest ones in a bounded heap
+    ClosestItemSelector selector(max_results, distance_threshold);
     for (std::size_t item_id = 0; item_id < items.size(); ++item_id)
-    {
-      float distance = getDistance<T>(item, items[item_id]);
-      int insert_position = 0;
-      bool add_to_results = result_ids.empty();  // if empty, we don't need to compare
-      if (!add_to_results)
-      {
-        for (insert_position = result_distances.size(); insert_position > 0; insert_position--)
-        {
-          if (distance < result_distances[insert_position - 1])
-            add_to_results = true;
-          else
-            break;
-        }
-      }
-      // add to results
-      if (add_to_results && distance < distance_threshold)
-      {
-        result_distances.insert(result_distances.begin() + insert_position, distance);
-        result_ids.insert(result_ids.begin() + insert_position, item_id);
-        if (result_distances.size() > max_results)
-        {
-          result_ids.pop_back();
-          result_distances.pop_back();
-        }
-      }
-    }
+      selector.add(item_id, getDistance<T>(item, items[item_id]));
+    selector.getResults(result_ids, result_distances);
   }
 }
 
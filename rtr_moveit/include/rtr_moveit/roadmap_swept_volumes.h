@@ -0,0 +1,123 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Precomputed swept voxels of roadmap edges for collision checking roadmaps without the MPA
+ */
+
+#ifndef RTR_MOVEIT_ROADMAP_SWEPT_VOLUMES_H
+#define RTR_MOVEIT_ROADMAP_SWEPT_VOLUMES_H
+
+// C++
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// MoveIt!
+#include <moveit/robot_state/robot_state.h>
+
+// rtr_moveit
+#include <rtr_moveit/roadmap_data.h>
+#include <rtr_moveit/rtr_datatypes.h>
+
+namespace rtr_moveit
+{
+/** Swept volumes of all edges of a roadmap. The collision geometry of the planning group links is voxelized along
+ *  each edge in the voxel grid of the roadmap volume region. Checking occupancy data only requires testing the swept
+ *  voxels against an occupancy bitset, so that roadmaps can be collision checked on the CPU with the same results
+ *  format as RapidPlanInterface::CheckScene(). */
+class RoadmapSweptVolumes
+{
+public:
+  /** Computes the swept voxels of all roadmap edges
+   * @param roadmap_data - The roadmap data with configs, edges and volume region
+   * @param default_state - The robot state used for all joints that are not part of the group
+   * @param group_name - The planning group of the roadmap configs
+   * @param max_step - The maximum joint distance of interpolated states along an edge
+   * @param num_threads - The number of threads for voxelizing edges
+   * @return false if the group doesn't match the roadmap or the volume frame is not a fixed frame of the robot
+   */
+  bool build(const RoadmapData& roadmap_data, const robot_state::RobotState& default_state,
+             const std::string& group_name, double max_step, std::size_t num_threads);
+
+  /** Checks collisions of all roadmap edges with occupancy data
+   * @param occupancy_data - The occupancy data in the roadmap volume region, point clouds are voxelized
+   * @param collisions - Returns one flag per roadmap edge, 1 if the edge is in collision
+   * @param num_threads - The number of threads for checking edges
+   * @return false if the occupancy data doesn't match the volume region
+   */
+  bool checkScene(const OccupancyData& occupancy_data, std::vector<uint8_t>& collisions,
+                  std::size_t num_threads) const;
+
+  /** Returns a hash of the robot geometry and parameters the swept volumes are built from. Serialized swept volumes
+   *  of other robot models, groups or interpolation steps are rejected by deserialize().
+   */
+  static uint64_t getFingerprint(const robot_state::RobotState& default_state, const std::string& group_name,
+                                 double max_step);
+
+  /** Serializes the swept volumes
+   * @param stamp - The file stamp of the .og file the roadmap data was read from
+   * @param buffer - The returned buffer
+   */
+  void serialize(const RoadmapFileStamp& stamp, std::vector<char>& buffer) const;
+
+  /** Initializes the swept volumes from a serialized buffer
+   * @param data, size - The buffer created by serialize()
+   * @param stamp - The expected file stamp of the .og file
+   * @param fingerprint - The expected result of getFingerprint()
+   * @return true on success, false if the buffer is invalid or outdated
+   */
+  bool deserialize(const char* data, std::size_t size, const RoadmapFileStamp& stamp, uint64_t fingerprint);
+
+  std::size_t getNumEdges() const
+  {
+    return edge_offsets_.empty() ? 0 : edge_offsets_.size() - 1;
+  }
+
+  /** Returns the swept voxels of an edge as index ranges [begin, end) of the occupancy grid */
+  void getEdgeVoxelRanges(std::size_t edge_id, std::vector<std::pair<uint32_t, uint32_t>>& ranges) const;
+
+private:
+  RoadmapVolume volume_;
+  uint64_t fingerprint_ = 0;
+
+  // voxel index ranges [begin, end) of all edges, the ranges of edge i are at edge_offsets_[i] to edge_offsets_[i+1]
+  std::vector<uint64_t> edge_offsets_;
+  std::vector<uint32_t> voxel_ranges_;
+};
+typedef std::shared_ptr<const RoadmapSweptVolumes> RoadmapSweptVolumesConstPtr;
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_ROADMAP_SWEPT_VOLUMES_H
@@ -39,6 +39,13 @@
 #ifndef RTR_MOVEIT_ROADMAP_VISUALIZATION_H
 #define RTR_MOVEIT_ROADMAP_VISUALIZATION_H
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <ros/ros.h>
 #include <moveit/macros/class_forward.h>
 
@@ -46,6 +53,7 @@
 #include <geometry_msgs/Pose.h>
 #include <geometry_msgs/Point.h>
 #include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/roadmap_cache.h>
 
 namespace rtr_moveit
 {
@@ -54,7 +62,9 @@ class RoadmapVisualization
 {
 public:
   RoadmapVisualization(const ros::NodeHandle& nh);
+  ~RoadmapVisualization();
 
+  /** Publishes roadmap states and edges as latched marker array, every n-th state and edge with decimation n */
   void visualizeRoadmap(const std::string& frame_id, const geometry_msgs::Pose& marker_pose,
                         const std::vector<geometry_msgs::Point>& state_positions,
                         const std::vector<geometry_msgs::Point>& state_edges = {});
@@ -64,12 +74,53 @@ public:
 
   void visualizeVolumeRegion(const RoadmapVolume& volume);
 
+  /** Publishes occupancy voxels, every n-th voxel with decimation n */
   void visualizeOccupancy(const RoadmapVolume& volume, const OccupancyData& occupancy_data);
 
+  /** Queues volume region, occupancy voxels and solution path of a planning request for publishing on a background
+   *  thread. A pending plan that hasn't been published yet is replaced, so that publishing is limited to
+   *  planner_config/visualization_max_rate. The latched roadmap markers are only rebuilt if the roadmap changes.
+   * @param roadmap_data - The roadmap of the request
+   * @param occupancy_data - The occupancy data to visualize
+   * @param waypoint_ids - The roadmap indices of the solution path
+   * @param plan_success - If set to false, the solution path is not being visualized
+   */
+  void visualizePlanContext(const RoadmapDataConstPtr& roadmap_data, const OccupancyData& occupancy_data,
+                            const std::deque<std::size_t>& waypoint_ids, bool plan_success);
+
 private:
+  // Data of a planning request that is visualized by the publisher thread
+  struct PlanVisualization
+  {
+    RoadmapDataConstPtr roadmap_data;
+    OccupancyData occupancy_data;
+    std::deque<std::size_t> waypoint_ids;
+    bool plan_success;
+  };
+
+  /** Publishes pending plan visualizations until the visualization is destroyed */
+  void publishPlanVisualizations();
+
+  /** Publishes the markers of a single plan, roadmap markers are published if the roadmap changed */
+  void publishPlanVisualization(const PlanVisualization& plan);
+
   ros::Publisher marker_pub_;
+  ros::Publisher roadmap_pub_;
   double marker_lifetime_;
+  std::size_t decimation_ = 1;
+  std::chrono::duration<double> min_publish_period_;
   ros::NodeHandle nh_;
+
+  // publisher thread, started with the first plan visualization
+  std::thread publisher_thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::unique_ptr<PlanVisualization> pending_plan_;
+  bool stopped_ = false;
+
+  // only accessed by the publisher thread
+  std::weak_ptr<const RoadmapData> published_roadmap_;
+  std::chrono::steady_clock::time_point last_publish_time_;
 };
 }  // namespace rtr_moveit
 
@@ -49,6 +49,8 @@
 #include <pcl/point_types.h>
 #include <rtr-occupancy/Voxel.hpp>
 
+#include <rtr_moveit/occupancy_grid.h>
+
 namespace rtr_moveit
 {
 struct RoadmapVolume
@@ -69,6 +71,10 @@ struct RoadmapSpecification
 
   std::string base_link_frame;
   std::string end_effector_frame;
+
+  // planning group the roadmap is used with, set by the planning context. Roadmaps can be configured for multiple
+  // groups, the swept volumes of the roadmap depend on the group.
+  std::string group_name;
 };
 
 struct OccupancyData
@@ -76,11 +82,14 @@ struct OccupancyData
   enum Type
   {
     POINT_CLOUD,
-    VOXELS
+    VOXELS,
+    GRID
   };
   Type type;
   pcl::PointCloud<pcl::PointXYZ>::ConstPtr point_cloud;
   std::vector<rtr::Voxel> voxels;
+  // dense voxel representation, converted to a voxel list for collision checking
+  OccupancyGrid grid;
 };
 
 // Configuration for a MoveIt! planning group
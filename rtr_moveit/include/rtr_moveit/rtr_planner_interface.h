@@ -40,10 +40,16 @@
 #define RTR_MOVEIT_RTR_PLANNER_INTERFACE_H
 
 // C++
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 // ROS
@@ -60,6 +66,8 @@
 
 // rtr_moveit
 #include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/planner_metrics.h>
+#include <rtr_moveit/roadmap_swept_volumes.h>
 
 namespace rtr_moveit
 {
@@ -84,27 +92,127 @@ struct RapidPlanGoal
   rtr::ToolPose tolerance;  // pose tolerance of the target state
   rtr::ToolPose weights;    // pose distance weights for ranking multiple solutions
 };
+
+// A start state and goal pair for batch planning
+struct PlanningQuery
+{
+  std::size_t start_state_id;
+  RapidPlanGoal goal;
+};
+
+// The solution of a PlanningQuery
+struct PlanningQueryResult
+{
+  bool success = false;
+  std::vector<rtr::Config> waypoint_configs;
+  std::deque<std::size_t> waypoints;
+  std::deque<std::size_t> edges;
+  // summed joint distance of the waypoint configs
+  float cost = 0.0;
+};
+
+// PathPlanners loaded with the same roadmap. Each planner is used by one request at a time so that graph searches
+// of concurrent requests can run in parallel. All planners are loaded together with the roadmap.
+struct PathPlannerPool
+{
+  std::mutex mutex;
+  // notified whenever a planner is returned to the pool
+  std::condition_variable idle_condition;
+  std::vector<std::unique_ptr<rtr::PathPlanner>> idle_planners;
+  // number of roadmap edges, available without acquiring a planner
+  std::size_t num_edges = 0;
+};
+typedef std::shared_ptr<PathPlannerPool> PathPlannerPoolPtr;
+
+// The result of a collision check of all roadmap edges, can be used for planning multiple goals
+struct RoadmapCollisions
+{
+  std::string roadmap_id;
+  // collision flags of all roadmap edges
+  std::vector<uint8_t> collisions;
+  // PathPlanners of the checked roadmap
+  PathPlannerPoolPtr planners;
+};
+
 class RTRPlannerInterface
 {
 public:
   RTRPlannerInterface(const ros::NodeHandle& nh);
   virtual ~RTRPlannerInterface();
 
-  /** \brief Initialize the RapidPlanInterface */
+  /** \brief Initialize all MPAs of the device pool that are not ready yet and start the background health checks
+   * @return true if at least one MPA is ready
+   */
   bool initialize();
 
-  /** \brief Check if the RapidPlanInterface is available and the planner can receive requests */
+  /** \brief Check if an MPA is available and the planner can receive requests. The MPAs are only queried if
+   *  background health checks are disabled. */
   bool isReady() const;
 
   /** \brief Run planning attempt and generate a solution path */
   bool solve(const RoadmapSpecification& roadmap_spec, const std::size_t start_state_id, const RapidPlanGoal& goal,
              const OccupancyData& occupancy_data, const double& timeout, std::vector<rtr::Config>& solution_path);
 
-  /** \brief Run planning attempt and generate solution waypoints and edges */
+  /** \brief Run planning attempt and generate solution waypoints and edges.
+   *  waypoint_configs contains the config of each waypoint in the same order, not the complete roadmap. */
   bool solve(const RoadmapSpecification& roadmap_spec, const std::size_t start_state_id, const RapidPlanGoal& goal,
-             const OccupancyData& occupancy_data, const double& timeout, std::vector<rtr::Config>& roadmap_states,
+             const OccupancyData& occupancy_data, const double& timeout, std::vector<rtr::Config>& waypoint_configs,
              std::deque<std::size_t>& waypoints, std::deque<std::size_t>& edges);
 
+  /** \brief Plan many start/goal queries with a single collision check. The graph searches run in parallel on the
+   *  shared collision result.
+   * @param roadmap_spec - The roadmap to plan with
+   * @param occupancy_data - The occupancy data to check collisions with
+   * @param queries - The start/goal pairs to plan
+   * @param timeout - The total time budget in milliseconds
+   * @param results - Returns one result for each query in the same order
+   * @param num_threads - The number of parallel graph searches, 0 uses all hardware threads. Threads beyond the
+   *                      PathPlanners of the roadmap wait for a free planner.
+   * @return false if the collision check failed, otherwise true even if single queries failed
+   */
+  bool solveBatch(const RoadmapSpecification& roadmap_spec, const OccupancyData& occupancy_data,
+                  const std::vector<PlanningQuery>& queries, const double& timeout,
+                  std::vector<PlanningQueryResult>& results, std::size_t num_threads = 0);
+
+  /** \brief Check collisions of all roadmap edges with the given occupancy data using the MPA. The result can be used
+   *  for planning any number of goals with findPath(). */
+  bool checkScene(const RoadmapSpecification& roadmap_spec, const OccupancyData& occupancy_data,
+                  RoadmapCollisions& roadmap_collisions);
+
+  /** \brief Run a graph search for a goal using the result of checkScene(), no MPA access is required.
+   *  waypoint_configs contains the config of each waypoint in the same order. */
+  bool findPath(const RoadmapCollisions& roadmap_collisions, const std::size_t start_state_id,
+                const RapidPlanGoal& goal, const double& timeout, std::vector<rtr::Config>& waypoint_configs,
+                std::deque<std::size_t>& waypoints, std::deque<std::size_t>& edges);
+
+  // Hit and miss counts of collision checks that could be served from the collision cache
+  struct CollisionCacheStatistics
+  {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+  };
+
+  /** \brief Get the hit and miss counts of the collision cache */
+  CollisionCacheStatistics getCollisionCacheStatistics() const;
+
+  /** \brief Remove all cached collision check results */
+  void clearCollisionCache();
+
+  /** \brief Set the metrics that record MPA round-trips, graph searches and cache lookups, disabled if null */
+  void setPlannerMetrics(const PlannerMetricsPtr& metrics);
+
+  /** \brief Set the swept volumes of a roadmap for checking collisions on the CPU if the MPA is disabled. Without
+   *  swept volumes, roadmaps are planned without collision checks.
+   * @param group_name - The planning group the swept volumes are built for, see RoadmapSpecification::group_name
+   * @param roadmap_id - The roadmap of the swept volumes
+   * @param swept_volumes - The swept volumes of all roadmap edges
+   */
+  void setSweptVolumes(const std::string& group_name, const std::string& roadmap_id,
+                       const RoadmapSweptVolumesConstPtr& swept_volumes);
+
+  /** \brief Load a roadmap to a PathPlanner and the MPAs in advance so that planning requests don't need to */
+  bool loadRoadmap(const RoadmapSpecification& roadmap_spec);
+
   /** \brief Get the configs of the given roadmap */
   bool getRoadmapConfigs(const RoadmapSpecification& roadmap_spec, std::vector<rtr::Config>& configs);
 
@@ -115,43 +223,170 @@ public:
   bool getRoadmapTransforms(const RoadmapSpecification& roadmap_spec, std::vector<rtr::ToolPose>& transforms);
 
 private:
-  /** \brief load roadmap file to PathPlanner and store roadmap specification */
-  bool loadRoadmapToPathPlanner(const RoadmapSpecification& roadmap_spec);
+  // A roadmap that is loaded into PathPlanners and written to the MPAs it is assigned to
+  struct ResidentRoadmap
+  {
+    RoadmapSpecification spec;
+    PathPlannerPoolPtr planners;
+    // usage counter value of the last access, used for LRU eviction
+    uint64_t last_used = 0;
+  };
 
-  /** \brief Initialize PathPlanner and RapidPlanInterface with a given roadmap identifier */
-  bool prepareRoadmap(const RoadmapSpecification& roadmap_spec, size_t& roadmap_index);
+  // An MPA of the device pool. Collision checks on different devices run in parallel.
+  struct MPADevice
+  {
+    std::size_t device_id = 0;
+    // mutex lock for exclusive access to the MPA and its roadmap storage
+    std::mutex mutex;
+    rtr::MPAInterface interface;
+    // false until the MPA is initialized and after failed handshakes or collision checks
+    std::atomic<bool> healthy{ false };
+    // number of collision checks that have been assigned to the MPA and are not finished yet
+    std::atomic<std::size_t> pending_checks{ 0 };
+    // MPA storage indices of the written roadmaps by roadmap_id, guarded by mutex
+    std::map<std::string, std::size_t> roadmap_indices;
+    // roadmap_ids of the resident roadmaps that are checked on this MPA, guarded by mpa_mutex_
+    std::set<std::string> assigned_roadmaps;
+    // time of the last initialization attempt, limits the retries without health checks, guarded by mutex
+    std::chrono::steady_clock::time_point last_initialization;
+  };
 
-  /** \brief Find the roadmap index for a given roadmap name */
-  bool findRoadmapIndex(const std::string& roadmap_name, size_t& roadmap_index)
+  // An evicted roadmap that still needs to be removed from an MPA, collected while holding mpa_mutex_
+  struct DeviceEviction
   {
-    for (auto it = roadmap_indices_.begin(); it != roadmap_indices_.end(); it++)
-    {
-      if (it->second == roadmap_name)
-      {
-        roadmap_index = it->first;
-        return true;
-      }
-    }
-    return false;
-  }
+    MPADevice* device;
+    std::string roadmap_id;
+    // roadmaps that remain assigned to the device and are written again after clearing its storage
+    std::vector<RoadmapSpecification> remaining_roadmaps;
+  };
+
+  // A collision check result of the MPA together with the occupancy data it was computed from
+  struct CollisionCacheEntry
+  {
+    // empty for MPA checks, which don't depend on the group
+    std::string group_name;
+    std::string roadmap_id;
+    std::size_t fingerprint;
+    OccupancyData::Type type;
+    std::vector<rtr::Voxel> voxels;
+    OccupancyGrid grid;
+    std::vector<uint8_t> collisions;
+    // cache counter value of the last access, used for LRU eviction
+    uint64_t last_used;
+  };
+
+  /** \brief Look up the collisions of a roadmap for occupancy data that has been checked before. Swept volume checks
+   *  are cached by group_name, MPA checks use an empty group_name.
+   * @return true on a cache hit, false if the occupancy data needs to be checked
+   */
+  bool findCachedCollisions(const std::string& group_name, const std::string& roadmap_id, std::size_t fingerprint,
+                            const OccupancyData& occupancy_data, std::vector<uint8_t>& collisions);
+
+  /** \brief Store the collisions of a roadmap for the checked occupancy data, evicts the least recently used entry if
+   *  the cache is full */
+  void addCachedCollisions(const std::string& group_name, const std::string& roadmap_id, std::size_t fingerprint,
+                           const OccupancyData& occupancy_data, const std::vector<uint8_t>& collisions);
+
+  /** \brief Load roadmap file to a PathPlanner unless it is already resident, may evict the least recently used
+   *  roadmap. The roadmap file is loaded and evicted roadmaps are removed from the MPAs without holding mpa_mutex_,
+   *  so that it must not be locked by the caller.
+   * @param roadmap_spec - The roadmap to load
+   * @param roadmap - Returns the resident roadmap
+   * @return false if the roadmap file could not be loaded
+   */
+  bool loadRoadmapToPathPlanner(const RoadmapSpecification& roadmap_spec, ResidentRoadmap& roadmap);
+
+  /** \brief Load a roadmap to a PathPlanner and acquire a planner for reading roadmap data */
+  std::shared_ptr<rtr::PathPlanner> acquireRoadmapPlanner(const RoadmapSpecification& roadmap_spec);
+
+  /** \brief Take an idle PathPlanner from the pool, waits until a planner is returned if all are busy. The planner
+   *  is returned to the pool when the last reference is destroyed. */
+  std::shared_ptr<rtr::PathPlanner> acquirePathPlanner(const PathPlannerPoolPtr& pool);
+
+  /** \brief Connect, initialize and clear an MPA, the device mutex must be locked */
+  bool initializeDevice(MPADevice& device) const;
+
+  /** \brief Select the healthy MPA with the fewest pending collision checks for a roadmap. Devices that already
+   *  store the roadmap are preferred, others are only selected while the roadmap has less than
+   *  mpa_roadmap_replicas_ devices. The roadmap is assigned to the selected device if it's still resident and the
+   *  check is counted as pending. mpa_mutex_ must be locked.
+   * @param roadmap_id - The roadmap to check
+   * @param excluded_devices - Devices that must not be selected
+   * @return the selected device or nullptr if no device is available
+   */
+  MPADevice* selectDevice(const std::string& roadmap_id, const std::vector<const MPADevice*>& excluded_devices);
+
+  /** \brief Write roadmap to the MPA unless it is already stored there, the device mutex must be locked
+   * @return true on success, roadmap_index returns the MPA storage index of the roadmap
+   */
+  bool prepareDeviceRoadmap(MPADevice& device, const RoadmapSpecification& roadmap_spec, std::size_t& roadmap_index);
+
+  /** \brief Write a roadmap to the MPA, the device mutex must be locked */
+  bool writeRoadmap(MPADevice& device, const RoadmapSpecification& roadmap_spec);
+
+  /** \brief Remove the least recently used roadmap from host storage and its MPA assignments. mpa_mutex_ must be
+   *  locked.
+   * @param evictions - Returns the devices that still store the roadmap, see clearEvictedRoadmaps()
+   */
+  void evictLeastRecentlyUsedRoadmap(std::vector<DeviceEviction>& evictions);
+
+  /** \brief Remove evicted roadmaps from the MPAs and write the remaining roadmaps again. Waits for running
+   *  collision checks of the devices, so mpa_mutex_ must not be locked. */
+  void clearEvictedRoadmaps(const std::vector<DeviceEviction>& evictions);
+
+  /** \brief Clear the MPA storage, all roadmaps need to be rewritten before they can be used again. The device
+   *  mutex must be locked. */
+  bool clearMPARoadmaps(MPADevice& device);
+
+  /** \brief Mark an MPA as unhealthy so that it is initialized again by the health checks */
+  void setDeviceFailed(MPADevice& device);
+
+  /** \brief Periodically run handshakes with all idle MPAs and initialize failed MPAs again */
+  void runHealthChecks();
 
   ros::NodeHandle nh_;
   bool debug_ = false;
 
-  // mutex lock for thread-safe RapidPlan calls
-  std::mutex mutex_;
+  // mutex lock for the resident roadmaps and the roadmap assignments of the MPAs, graph searches, collision checks,
+  // roadmap file loading and MPA writes run without it. Device mutexes may be locked while holding it, but not the
+  // other way round.
+  std::mutex mpa_mutex_;
 
-  // RapidPlan interfaces
-  rtr::MPAInterface rapidplan_interface_;
-  rtr::PathPlanner planner_;
+  // RapidPlan MPA device pool
+  std::vector<std::unique_ptr<MPADevice>> mpa_devices_;
   bool rapidplan_interface_enabled_ = true;
+  // maximum number of MPAs a roadmap is written to, equals the number of devices if all roadmaps are replicated
+  std::size_t mpa_roadmap_replicas_ = 1;
+
+  // swept volumes by group name and roadmap_id for collision checks without the MPA, guarded by mpa_mutex_
+  std::map<std::pair<std::string, std::string>, RoadmapSweptVolumesConstPtr> swept_volumes_;
+  std::size_t software_collision_threads_ = 0;
+  // if disabled, roadmaps are planned without collision checks when the MPA is disabled
+  bool software_collision_checks_ = true;
+
+  // background health checks of the MPAs
+  double health_check_period_ = 1.0;
+  std::thread health_check_thread_;
+  std::mutex health_check_mutex_;
+  std::condition_variable health_check_condition_;
+  bool stopped_ = false;
+
+  // roadmaps loaded into PathPlanners by roadmap_id
+  std::map<std::string, ResidentRoadmap> resident_roadmaps_;
+  // maximum number of resident roadmaps
+  std::size_t max_resident_roadmaps_ = 4;
+  // number of PathPlanners loaded for each resident roadmap, limits the parallel graph searches of a roadmap
+  std::size_t path_planners_per_roadmap_ = 1;
+  uint64_t usage_counter_ = 0;
+
+  // collision check results for voxel and grid occupancy data, point clouds are not cached
+  mutable std::mutex collision_cache_mutex_;
+  std::vector<CollisionCacheEntry> collision_cache_;
+  std::size_t collision_cache_size_ = 8;
+  uint64_t collision_cache_counter_ = 0;
+  CollisionCacheStatistics collision_cache_statistics_;
 
-  // available roadmap specifications
-  std::map<std::string, RoadmapSpecification> roadmaps_;
-  // name of roadmap loaded by the planner
-  std::string loaded_roadmap_;
-  // indices of roadmaps written to the board
-  std::map<uint16_t, std::string> roadmap_indices_;
+  PlannerMetricsPtr metrics_;
 };
 }  // namespace rtr_moveit
 
@@ -40,25 +40,51 @@
 #define RTR_MOVEIT_RTR_PLANNING_CONTEXT_H
 
 // C++
+#include <atomic>
+#include <deque>
 #include <string>
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
 
 // MoveIt
 #include <moveit/macros/class_forward.h>
+#include <moveit/constraint_samplers/constraint_sampler.h>
+#include <moveit/constraint_samplers/default_constraint_samplers.h>
 #include <moveit/planning_interface/planning_interface.h>
+#include <shape_msgs/SolidPrimitive.h>
 
 // rtr_moveit
 #include <rtr_moveit/rtr_planner_interface.h>
 #include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/roadmap_cache.h>
 #include <rtr_moveit/roadmap_visualization.h>
-
-// RapidPlan file reader API
-#include <rtr-api/OGFileReader.hpp>
 #include <rtr_moveit/occupancy_handler.h>
+#include <rtr_moveit/planner_metrics.h>
 
 namespace rtr_moveit
 {
 MOVEIT_CLASS_FORWARD(RTRPlanningContext);
 
+/** Returns the interpolation steps 0..step_count in bisection order. The end points come first, followed by the
+ *  midpoints of all intervals of the previous level, so that collisions anywhere on the segment are found early.
+ *  Every step is contained exactly once.
+ */
+std::vector<std::size_t> getBisectionOrder(std::size_t step_count);
+
+/** Computes the radius of a sphere that fits inside a position constraint region independent of its orientation
+ * @param  region - the constraint region, only spheres, boxes and cylinders are supported
+ * @param  tolerance - the returned radius
+ * @return false if the region type is not supported or has invalid dimensions
+ */
+bool getRegionTolerance(const shape_msgs::SolidPrimitive& region, double& tolerance);
+
+/** Converts a rotation to roll/pitch/yaw around the fixed x/y/z axes, the convention of the roadmap tool poses.
+ *  Roll and yaw are in [-pi, pi], pitch is in [-pi/2, pi/2].
+ */
+void getRollPitchYaw(const Eigen::Matrix3d& rotation, double& roll, double& pitch, double& yaw);
+
 class RTRPlanningContext : public planning_interface::PlanningContext
 {
 public:
@@ -88,20 +114,53 @@ public:
    */
   virtual bool solve(planning_interface::MotionPlanDetailedResponse& res);
 
-  /** Configures the planning context which includes extracting a goal from the MotionPlanRequest
+  /** Configures the planning context for the current MotionPlanRequest and planning scene. Parameters, joint
+   *  model group and roadmap data are only loaded on the first call, reused contexts keep them.
    * @param error_code - the result code
    */
   void configure(moveit_msgs::MoveItErrorCodes& error_code);
 
-  /** Clear the planning context data */
+  /** Clear the planning context data of the last request, so that the context can be reused */
   virtual void clear();
 
-  /** Terminate the planning context - NOTE: this is not supported */
+  /** Terminate a running planning attempt. The attempt is aborted with PREEMPTED before the next planning step,
+   *  in-flight voxelization, point cloud waiting, goal sampling and connection checks are abandoned.
+   *  A running MPA collision check or graph search can't be interrupted and finishes first.
+   * @return true
+   */
   virtual bool terminate();
 
   void setOccupancyHandler(std::shared_ptr<OccupancyHandler> occupancy_handler);
 
+  /** Sets the cache that provides the roadmap data of the configured roadmap */
+  void setRoadmapCache(const RoadmapCachePtr& roadmap_cache);
+
+  /** Sets the metrics that record stage latencies and request counters, nothing is recorded if null */
+  void setPlannerMetrics(const PlannerMetricsPtr& metrics);
+
+  /** Returns the roadmap specification of the context, including the volume and frames of the loaded roadmap */
+  const RoadmapSpecification& getRoadmapSpecification() const
+  {
+    return roadmap_;
+  }
+
 private:
+  /** A solution path found for a single goal */
+  struct GoalCandidate
+  {
+    std::size_t goal_pos;
+    std::vector<rtr::Config> solution_path;
+    std::deque<std::size_t> waypoints;
+    float cost;  // summed joint distance of the solution path
+  };
+
+  /** Constraint samplers used by a single goal sampling thread */
+  struct GoalSamplers
+  {
+    constraint_samplers::JointConstraintSamplerPtr joint_sampler;
+    constraint_samplers::IKConstraintSamplerPtr ik_sampler;
+  };
+
   /** Runs a planning attempt on the configured context and initializes results as RobotTrajectory and planning time
    * @param  trajectory - the result RobotTrajectory
    * @param  planning_time - the elapsed planning time
@@ -109,6 +168,11 @@ private:
    */
   moveit_msgs::MoveItErrorCodes solve(robot_trajectory::RobotTrajectoryPtr& trajectory);
 
+  /** Loads planner parameters, the joint model group and the roadmap data of the context
+   * @return true on success
+   */
+  bool loadConfiguration();
+
   /** Converts the given goal Constraints vector to a vector of valid RapidPlanGoals that can be used with the
    *  RTRPlannerInterface. Failed Constraints are left out of the result vector.
    * @param  goal_constraints - the Constraints vector
@@ -120,7 +184,9 @@ private:
 
   /** Converts the given goal constraints to a valid RapidPlanGoal that can be used with the RTRPlannerInterface.
    *  If the RapidPlanGoal does not fully meet the constraints, the robot state goal_state is initialized as the
-   *  actual goal.
+   *  actual goal. States are sampled on goal_sampling_threads_ threads until goal_sample_matches_ samples have
+   *  roadmap states within the allowed joint distance, max_goal_samples_ is reached or the planning time is up.
+   *  The sample with the closest roadmap state is used.
    * @param  goal_constraints - the goal constraints to extract
    * @param  goal - the returned RapidPlanGoal
    * @param  goal_state - the robot state that fulfills the constraints in case the RapidPlanGoal doesn't
@@ -129,6 +195,28 @@ private:
   bool getRapidPlanGoal(const moveit_msgs::Constraints& goal_constraint, RapidPlanGoal& goal,
                         robot_state::RobotStatePtr& goal_state);
 
+  /** Returns true if the goal constraint only constrains the end effector pose of the roadmap with a single
+   *  position and an optional orientation constraint, so that it can be solved as TOOL_POSE goal. Position regions
+   *  that aren't supported by getRegionTolerance() are rejected and sampled instead.
+   */
+  bool isToolPoseConstraint(const moveit_msgs::Constraints& goal_constraint) const;
+
+  /** Converts an end effector pose constraint to a TOOL_POSE goal in the roadmap base frame without IK sampling.
+   *  The position tolerance is the radius of a sphere inside the constraint region. Roadmap poses are prefiltered
+   *  with the pose index of the roadmap, so that unreachable goals fail immediately.
+   * @param  goal_constraint - the pose constraint, isToolPoseConstraint() must be true
+   * @param  goal - the returned RapidPlanGoal
+   * @param  goal_state - is reset since the goal is reached by the roadmap state itself
+   * @return true if a roadmap state is within the position tolerance
+   */
+  bool getToolPoseGoal(const moveit_msgs::Constraints& goal_constraint, RapidPlanGoal& goal,
+                       robot_state::RobotStatePtr& goal_state);
+
+  /** Creates a sampler for robot states that satisfy the joint, position and orientation goal constraints.
+   *  The joint and IK samplers of goal_samplers are created on first use and reconfigured afterwards. */
+  constraint_samplers::ConstraintSamplerPtr createGoalSampler(const moveit_msgs::Constraints& goal_constraint,
+                                                              GoalSamplers& goal_samplers);
+
   /** Extracts the start state from the MotionPlanRequest and searches for a start state candidate in the roadmap.
    *  If the joint values in the MotionPlanRequest are not populated, the current state of the planning scene is used.
    *  @param start_state_id - the returned state id of the start state candidate
@@ -137,35 +225,48 @@ private:
    */
   bool initStartState(std::size_t& start_state_id);
 
+  /** Searches solution paths for all goals in parallel using the same roadmap collisions.
+   * @param roadmap_collisions - The result of checking the roadmap against the current scene
+   * @param start_state_id - The roadmap index of the start state
+   * @param candidates - Returns the non-empty solution paths sorted by increasing cost
+   */
+  void findGoalCandidates(const RoadmapCollisions& roadmap_collisions, const std::size_t start_state_id,
+                          std::vector<GoalCandidate>& candidates);
+
+  /** Converts goal candidates to trajectories and connects them to start and goal states in parallel.
+   *  The cheapest candidate that connects without collisions is accepted, evaluations of more expensive
+   *  candidates are cancelled as soon as a cheaper one succeeds.
+   * @param candidates - The goal candidates sorted by increasing cost
+   * @param trajectory - Returns the trajectory of the accepted candidate
+   * @param accepted - Returns the position of the accepted candidate
+   * @return true if a candidate could be connected
+   */
+  bool connectGoalCandidates(const std::vector<GoalCandidate>& candidates,
+                             robot_trajectory::RobotTrajectoryPtr& trajectory, std::size_t& accepted);
+
   /**
-   * Converts a path of rtr::Config waypoints to a robot trajectory.
-   * An assertion is thrown If joint_names and waypoints in solution_path have different sizes.
+   * Converts a path of rtr::Config waypoints to a robot trajectory. The joint values are written with the joint
+   * models resolved in configure(), without looking up joints by name.
+   * An assertion is thrown If the group joints and waypoints in solution_path have different sizes.
    * @param solution_path - the waypoints of type rtr::Config
    * @param reference_state - the reference robot state to use for the trajectory
-   * @param joint_names - the joint model names of reference_state matching to the waypoints in solution_path
    * @param trajectory - returns the populated result trajectory
    */
   void processSolutionPath(const std::vector<rtr::Config>& solution_path,
-                           const robot_state::RobotState& reference_state, const std::vector<std::string>& joint_names,
+                           const robot_state::RobotState& reference_state,
                            robot_trajectory::RobotTrajectory& trajectory);
 
   /** Connect a waypoint state to a robot trajectory using interpolation and collision checks in the
-   *  planning scene.
+   *  planning scene. The interpolation steps are checked in bisection order on connection_check_threads_ threads.
    * @param trajectory - The trajectory to connect the waypoint to
    * @param waypoint_state - The waypoint that should be connected to the trajectory
    * @param connect_to_front - if true the waypoint is prepended, if false appended to the trajectory
-   * @return true on success, false if collisions have occured
+   * @param cancelled - optional flag that aborts the collision checks if set
+   * @return true on success, false if collisions have occured or the connection was cancelled
    */
   bool connectWaypointToTrajectory(const robot_trajectory::RobotTrajectoryPtr& trajectory,
-                                   const robot_state::RobotStatePtr& waypoint_state, bool connect_to_front = false);
-
-  /** Visualizes volume region, roadmap and solution path using the RoadmapVisualization class.
-   * @param occupancy_data - The occupancy data to visualize
-   * @param waypoint_ids - The roadmap indices of the solution path
-   * @param plan_success - If set to false, the solution path is not being visualized
-   */
-  void visualizePlanContext(const OccupancyData& occupancy_data, const std::deque<std::size_t>& waypoint_ids,
-                            bool plan_success);
+                                   const robot_state::RobotStatePtr& waypoint_state, bool connect_to_front = false,
+                                   const std::atomic<bool>* cancelled = nullptr);
 
   /** Log a planning event with a timestamp
    * @param description - Specifies the logged event
@@ -173,28 +274,42 @@ private:
    */
   void addDetailedTime(const std::string& description, const ros::Time& time);
 
-  /** Return the remaining planning time in seconds */
+  /** Return the remaining planning time in seconds, 0 if the planning attempt has been terminated */
   double getRemainingPlanningTime();
 
+  /** Sets error_code to PREEMPTED if the planning attempt has been terminated
+   * @return true if the planning attempt has been terminated
+   */
+  bool checkPreempted(moveit_msgs::MoveItErrorCodes& error_code);
+
   robot_state::RobotStatePtr start_state_;
   std::vector<robot_state::RobotStatePtr> goal_states_;
 
   const RTRPlannerInterfacePtr planner_interface_;
   const moveit::core::JointModelGroup* jmg_;
   std::vector<std::string> joint_model_names_;
+  std::vector<const moveit::core::JointModel*> joint_models_;  // in roadmap config order
+  bool use_group_positions_ = false;  // roadmap configs match the variables of jmg_
   RoadmapSpecification roadmap_;
-  std::vector<rtr::Config> roadmap_configs_;
-  std::vector<rtr::ToolPose> roadmap_poses_;
-  std::vector<rtr::EdgeInfo> roadmap_edges_;
+  RoadmapDataConstPtr roadmap_data_;  // shared, immutable roadmap configs, poses, edges and search indices
   std::vector<RapidPlanGoal> goals_;
-  std::shared_ptr<rtr::OGFileReader> og_file_;
+  OccupancyData occupancy_data_;  // reused by all requests of the context
+  std::vector<GoalSamplers> goal_samplers_;  // one per goal sampling thread
+  planning_scene::PlanningSceneConstPtr goal_sampler_scene_;
   bool configured_ = false;
+  std::atomic<bool> terminated_{ false };
 
   // parameters
   double max_waypoint_distance_ = 0.01;
   double allowed_joint_distance_;
   double allowed_position_distance_;
   int max_goal_states_;
+  std::size_t goal_evaluation_threads_ = 1;
+  std::size_t goal_sampling_threads_ = 1;
+  std::size_t connection_check_threads_ = 1;
+  int max_goal_samples_ = 0;  // unlimited if < 1
+  int goal_sample_matches_ = 1;
+  bool use_tool_pose_goals_ = false;
 
   // visualization
   bool visualization_enabled_;
@@ -210,6 +325,8 @@ private:
   std::vector<std::pair<std::string, ros::Time>> detailed_times_;
 
   std::shared_ptr<OccupancyHandler> occupancy_handler_;
+  RoadmapCachePtr roadmap_cache_;
+  PlannerMetricsPtr metrics_;
 };
 }  // namespace rtr_moveit
 
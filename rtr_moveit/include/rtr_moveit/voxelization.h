@@ -0,0 +1,131 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: Object-local voxelization of collision shapes inside a roadmap volume
+ */
+
+#ifndef RTR_MOVEIT_VOXELIZATION_H
+#define RTR_MOVEIT_VOXELIZATION_H
+
+// C++
+#include <array>
+#include <vector>
+
+// Eigen
+#include <Eigen/Geometry>
+
+// MoveIt!
+#include <geometric_shapes/shapes.h>
+
+// rtr_moveit
+#include <rtr_moveit/rtr_datatypes.h>
+
+// RapidPlan
+#include <rtr-occupancy/Voxel.hpp>
+
+namespace rtr_moveit
+{
+// Index range [min, max) of voxels along the X/Y/Z axes of a volume region
+struct VoxelRange
+{
+  std::array<uint16_t, 3> min;
+  std::array<uint16_t, 3> max;
+};
+
+class ShapeVoxelizer
+{
+public:
+  /* @brief Constructor
+   * @param  volume - the volume region that defines dimensions and resolution of the voxel grid
+   */
+  ShapeVoxelizer(const RoadmapVolume& volume);
+
+  /* @brief Check if a shape type can be voxelized with one of the exact shape tests
+   * @param  shape - the collision shape
+   * @return true for boxes, spheres, cylinders, cones, meshes, planes and octrees
+   */
+  static bool isSupported(const shapes::Shape& shape);
+
+  /* @brief Appends all voxels that intersect with the given shape. Only voxels inside the shape's bounding box are
+   *        tested, the tests are exact for boxes, spheres, cylinders, cones and mesh triangles. Planes occupy the
+   *        voxels their surface intersects, octrees occupy the voxels of their occupied leaf cubes.
+   * @param  shape - the collision shape
+   * @param  pose - the shape pose relative to the volume origin corner (0,0,0)
+   * @param  voxels - the occupied voxels are appended to this list, duplicates are possible for meshes and octrees
+   * @return false if the shape type is not supported
+   */
+  bool voxelizeShape(const shapes::Shape& shape, const Eigen::Affine3d& pose, std::vector<rtr::Voxel>& voxels) const;
+
+  /* @brief Computes the range of voxels that overlap with an axis-aligned bounding box in volume coordinates
+   * @param  aabb_min, aabb_max - the bounding box corners relative to the volume origin corner
+   * @param  range - the resulting voxel range
+   * @return false if the bounding box does not overlap with the volume
+   */
+  bool getVoxelRange(const Eigen::Vector3d& aabb_min, const Eigen::Vector3d& aabb_max, VoxelRange& range) const;
+
+  /* @brief Returns the voxel range that spans the complete volume */
+  VoxelRange getVolumeRange() const;
+
+  /* @brief Returns the center of a voxel relative to the volume origin corner */
+  Eigen::Vector3d getVoxelCenter(uint16_t x, uint16_t y, uint16_t z) const
+  {
+    return Eigen::Vector3d((x + 0.5) * voxel_dimension_[0], (y + 0.5) * voxel_dimension_[1],
+                           (z + 0.5) * voxel_dimension_[2]);
+  }
+
+  /* @brief Returns the edge lengths of a single voxel */
+  const Eigen::Vector3d& getVoxelDimension() const
+  {
+    return voxel_dimension_;
+  }
+
+private:
+  void voxelizeBox(const shapes::Box& box, const Eigen::Affine3d& pose, std::vector<rtr::Voxel>& voxels) const;
+  void voxelizeSphere(const shapes::Sphere& sphere, const Eigen::Affine3d& pose,
+                      std::vector<rtr::Voxel>& voxels) const;
+  void voxelizeCylinder(const shapes::Cylinder& cylinder, const Eigen::Affine3d& pose,
+                        std::vector<rtr::Voxel>& voxels) const;
+  void voxelizeCone(const shapes::Cone& cone, const Eigen::Affine3d& pose, std::vector<rtr::Voxel>& voxels) const;
+  void voxelizeMesh(const shapes::Mesh& mesh, const Eigen::Affine3d& pose, std::vector<rtr::Voxel>& voxels) const;
+  void voxelizePlane(const shapes::Plane& plane, const Eigen::Affine3d& pose, std::vector<rtr::Voxel>& voxels) const;
+  void voxelizeOcTree(const shapes::OcTree& octree, const Eigen::Affine3d& pose,
+                      std::vector<rtr::Voxel>& voxels) const;
+
+  std::array<uint16_t, 3> resolution_;
+  Eigen::Vector3d voxel_dimension_;
+  Eigen::Vector3d voxel_half_extents_;
+};
+}  // namespace rtr_moveit
+
+#endif  // RTR_MOVEIT_VOXELIZATION_H
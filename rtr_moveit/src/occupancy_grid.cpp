@@ -0,0 +1,181 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Dense bitset representation of occupancy voxels
+ */
+
+#include <rtr_moveit/occupancy_grid.h>
+
+#include <algorithm>
+#include <string>
+
+#include <ros/console.h>
+
+namespace rtr_moveit
+{
+const std::string LOGNAME = "occupancy_grid";
+
+constexpr std::size_t OccupancyGrid::WORD_BITS;
+
+OccupancyGrid::OccupancyGrid(const std::array<uint16_t, 3>& resolution)
+{
+  resize(resolution);
+}
+
+void OccupancyGrid::resize(const std::array<uint16_t, 3>& resolution)
+{
+  resolution_ = resolution;
+  const std::size_t bits = static_cast<std::size_t>(resolution[0]) * resolution[1] * resolution[2];
+  words_.assign((bits + WORD_BITS - 1) / WORD_BITS, 0);
+}
+
+void OccupancyGrid::clear()
+{
+  std::fill(words_.begin(), words_.end(), 0);
+}
+
+std::size_t OccupancyGrid::count() const
+{
+  std::size_t count = 0;
+  for (uint64_t word : words_)
+    count += __builtin_popcountll(word);
+  return count;
+}
+
+bool OccupancyGrid::empty() const
+{
+  for (uint64_t word : words_)
+    if (word)
+      return false;
+  return true;
+}
+
+std::size_t OccupancyGrid::hash() const
+{
+  uint64_t hash = (uint64_t(resolution_[0]) << 32) ^ (uint64_t(resolution_[1]) << 16) ^ resolution_[2];
+  for (uint64_t word : words_)
+    hash ^= word + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+  return hash;
+}
+
+bool OccupancyGrid::isAnyOccupied(std::size_t begin, std::size_t end) const
+{
+  if (begin >= end)
+    return false;
+  const std::size_t first_word = begin / WORD_BITS;
+  const std::size_t last_word = (end - 1) / WORD_BITS;
+  const uint64_t first_mask = ~uint64_t(0) << (begin % WORD_BITS);
+  const uint64_t last_mask = ~uint64_t(0) >> (WORD_BITS - 1 - (end - 1) % WORD_BITS);
+  if (first_word == last_word)
+    return words_[first_word] & first_mask & last_mask;
+  if (words_[first_word] & first_mask || words_[last_word] & last_mask)
+    return true;
+  for (std::size_t word = first_word + 1; word < last_word; ++word)
+    if (words_[word])
+      return true;
+  return false;
+}
+
+bool OccupancyGrid::setOccupied(const std::vector<rtr::Voxel>& voxels)
+{
+  bool success = true;
+  for (const rtr::Voxel& voxel : voxels)
+  {
+    if (voxel.x >= resolution_[0] || voxel.y >= resolution_[1] || voxel.z >= resolution_[2])
+    {
+      success = false;
+      continue;
+    }
+    setOccupied(voxel.x, voxel.y, voxel.z);
+  }
+  if (!success)
+    ROS_WARN_NAMED(LOGNAME, "Skipped voxels outside of the occupancy grid");
+  return success;
+}
+
+void OccupancyGrid::toVoxels(std::vector<rtr::Voxel>& voxels) const
+{
+  voxels.reserve(voxels.size() + count());
+  const std::size_t yz_size = static_cast<std::size_t>(resolution_[1]) * resolution_[2];
+  for (std::size_t i = 0; i < words_.size(); ++i)
+  {
+    // iterate over set bits, starting with the lowest one
+    uint64_t word = words_[i];
+    while (word)
+    {
+      const std::size_t index = i * WORD_BITS + __builtin_ctzll(word);
+      const std::size_t yz = index % yz_size;
+      voxels.push_back(rtr::Voxel(index / yz_size, yz / resolution_[2], yz % resolution_[2]));
+      word &= word - 1;
+    }
+  }
+}
+
+bool OccupancyGrid::merge(const OccupancyGrid& other)
+{
+  if (resolution_ != other.resolution_)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to merge occupancy grids with different resolutions");
+    return false;
+  }
+  for (std::size_t i = 0; i < words_.size(); ++i)
+    words_[i] |= other.words_[i];
+  return true;
+}
+
+bool OccupancyGrid::intersect(const OccupancyGrid& other)
+{
+  if (resolution_ != other.resolution_)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to intersect occupancy grids with different resolutions");
+    return false;
+  }
+  for (std::size_t i = 0; i < words_.size(); ++i)
+    words_[i] &= other.words_[i];
+  return true;
+}
+
+bool OccupancyGrid::subtract(const OccupancyGrid& other)
+{
+  if (resolution_ != other.resolution_)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to subtract occupancy grids with different resolutions");
+    return false;
+  }
+  for (std::size_t i = 0; i < words_.size(); ++i)
+    words_[i] &= ~other.words_[i];
+  return true;
+}
+}  // namespace rtr_moveit
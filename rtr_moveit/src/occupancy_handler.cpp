@@ -39,9 +39,15 @@
 #include <rtr_moveit/occupancy_handler.h>
 #include <pcl_conversions/pcl_conversions.h>
 #include <pcl_ros/transforms.h>
+#include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <exception>
 #include <stdexcept>
+#include <thread>
+
+// Boost
+#include <boost/bind.hpp>
 
 // Eigen
 #include <Eigen/Geometry>
@@ -51,20 +57,120 @@
 #include <moveit/collision_detection/world.h>
 #include <moveit/collision_detection_fcl/collision_world_fcl.h>
 #include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
 
 // RapidPlan
 #include <rtr-occupancy/Voxel.hpp>
 
 namespace rtr_moveit
 {
+namespace
+{
+bool isSameVolume(const RoadmapVolume& a, const RoadmapVolume& b)
+{
+  const geometry_msgs::Pose& pa = a.pose.pose;
+  const geometry_msgs::Pose& pb = b.pose.pose;
+  return a.pose.header.frame_id == b.pose.header.frame_id && a.dimension == b.dimension &&
+         a.voxel_resolution == b.voxel_resolution && pa.position.x == pb.position.x &&
+         pa.position.y == pb.position.y && pa.position.z == pb.position.z && pa.orientation.x == pb.orientation.x &&
+         pa.orientation.y == pb.orientation.y && pa.orientation.z == pb.orientation.z &&
+         pa.orientation.w == pb.orientation.w;
+}
+
+// poses are compared exactly, since any change may result in different voxels
+template <typename PoseVector>
+bool isSamePoses(const PoseVector& a, const PoseVector& b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (std::size_t i = 0; i < a.size(); ++i)
+    if (a[i].matrix() != b[i].matrix())
+      return false;
+  return true;
+}
+
+// Octrees are updated in place by the octomap monitor, keeping the same shape pointer and pose. Their content is
+// compared by hashing the keys of the occupied leaves, objects without octree shapes have the fingerprint 0.
+uint64_t getOctreeFingerprint(const collision_detection::World::Object& object)
+{
+  uint64_t fingerprint = 0;
+  for (const shapes::ShapeConstPtr& shape : object.shapes_)
+  {
+    if (shape->type != shapes::OCTREE)
+      continue;
+    const std::shared_ptr<const octomap::OcTree>& tree = static_cast<const shapes::OcTree&>(*shape).octree;
+    if (!tree)
+      continue;
+    for (auto leaf = tree->begin_leafs(), end = tree->end_leafs(); leaf != end; ++leaf)
+    {
+      if (!tree->isNodeOccupied(*leaf))
+        continue;
+      const octomap::OcTreeKey key = leaf.getKey();
+      const uint64_t value =
+          (uint64_t(key[0]) << 40) ^ (uint64_t(key[1]) << 24) ^ (uint64_t(key[2]) << 8) ^ leaf.getDepth();
+      fingerprint ^= value + 0x9e3779b97f4a7c15ull + (fingerprint << 6) + (fingerprint >> 2);
+    }
+  }
+  return fingerprint;
+}
+
+// Computes the transform of a cloud frame relative to the volume origin corner
+Eigen::Isometry3d getVolumeToCloud(const RoadmapVolume& volume, const tf::Transform& base_to_cloud)
+{
+  const tf::Vector3& origin = base_to_cloud.getOrigin();
+  const tf::Quaternion rotation = base_to_cloud.getRotation();
+  Eigen::Affine3d base_to_cloud_eigen(Eigen::Translation3d(origin.x(), origin.y(), origin.z()) *
+                                      Eigen::Quaterniond(rotation.w(), rotation.x(), rotation.y(), rotation.z()));
+  Eigen::Affine3d base_to_volume;
+  tf::poseMsgToEigen(volume.pose.pose, base_to_volume);
+  return Eigen::Isometry3d((base_to_volume.inverse() * base_to_cloud_eigen).matrix());
+}
+bool isCancelled(const std::atomic<bool>* cancelled)
+{
+  return cancelled && *cancelled;
+}
+
+// Waits on the condition until the predicate is satisfied, the timeout expired or the flag cancelled is set.
+// The condition is not notified on cancellation, so the timeout is split into short wait periods.
+template <class Predicate>
+bool waitForCondition(std::condition_variable& condition, std::unique_lock<std::mutex>& lock, double timeout,
+                      const std::atomic<bool>* cancelled, Predicate predicate)
+{
+  const std::chrono::duration<double> poll_period(0.01);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout);
+  while (!predicate())
+  {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline || isCancelled(cancelled))
+      return false;
+    condition.wait_for(lock, std::min<std::chrono::duration<double>>(poll_period, deadline - now));
+  }
+  return true;
+}
+}  // namespace
+
 const std::string LOGNAME = "occupancy_handler";
 OccupancyHandler::OccupancyHandler(const ros::NodeHandle& nh) : nh_(nh)
 {
+  std::string voxelization_method = nh_.param<std::string>("planner_config/voxelization_method", "OBJECT_LOCAL");
+  if (voxelization_method == "FULL_SWEEP")
+    voxelization_method_ = FULL_SWEEP;
+  else if (voxelization_method != "OBJECT_LOCAL")
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Voxelization method is set to unknown type '"
+                                       << voxelization_method << "'. Proceeding with default 'OBJECT_LOCAL'.");
+  setVoxelizationThreads(nh_.param("planner_config/voxelization_threads", 1));
+  nh_.param("planner_config/voxelize_point_clouds", voxelize_point_clouds_, false);
+  nh_.param("planner_config/pcl_max_age", pcl_max_age_, 0.1);
 }
 
-void OccupancyHandler::setVolumeRegion(const RoadmapVolume& roadmap_volume)
+void OccupancyHandler::setVoxelizationMethod(const VoxelizationMethod& method)
 {
-  volume_region_ = roadmap_volume;
+  voxelization_method_ = method;
+}
+
+void OccupancyHandler::setVoxelizationThreads(int threads)
+{
+  voxelization_threads_ = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
 }
 
 void OccupancyHandler::setPointCloudTopic(const std::string& pcl_topic)
@@ -77,45 +183,50 @@ void OccupancyHandler::setPointCloudTopic(const std::string& pcl_topic)
   }
 }
 
-bool OccupancyHandler::fromPointCloud(OccupancyData& occupancy_data, double timeout)
+bool OccupancyHandler::fromPointCloud(const RoadmapVolume& volume, OccupancyData& occupancy_data, double timeout,
+                                      const std::atomic<bool>* cancelled)
 {
-  // wait for new point cloud message
-  const auto start_time = ros::Time::now();
-  while (true)
+  // wait until the callback receives a point cloud that is young enough
+  const ros::Time start_time = ros::Time::now();
+  pcl::PCLPointCloud2ConstPtr cloud_pcl2;
   {
-    if ((ros::Time::now() - start_time).toSec() > timeout)
-    {
-      ROS_WARN_STREAM_NAMED(LOGNAME, "Timeout waiting for point cloud data on topic: " << pcl_topic_);
-      return false;
-    }
-    if (next_cloud_)
-    {
-      // only use point cloud if it's younger than 100ms, otherwise wait for a new one
+    std::unique_lock<std::mutex> lock(pcl_mutex_);
+    const bool received_cloud = waitForCondition(pcl_condition_, lock, timeout, cancelled, [&]() {
+      if (!next_cloud_)
+        return false;
       ros::Time pcl_stamp;
       pcl_conversions::fromPCL(next_cloud_->header.stamp, pcl_stamp);
-      if ((start_time - pcl_stamp).toNSec() > (100 * 1e+6))
-        ROS_WARN_THROTTLE_NAMED(10, LOGNAME, "Point cloud data is too far in the past");
+      return (start_time - pcl_stamp).toSec() <= pcl_max_age_;
+    });
+    if (!received_cloud)
+    {
+      if (isCancelled(cancelled))
+        ROS_DEBUG_NAMED(LOGNAME, "Waiting for point cloud data has been cancelled");
+      else if (next_cloud_)
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Point cloud data on topic " << pcl_topic_ << " is too far in the past");
       else
-        break;  // success
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Timeout waiting for point cloud data on topic: " << pcl_topic_);
+      return false;
     }
+    cloud_pcl2 = next_cloud_;
   }
 
-  // convert cloud to pcl::PointCloud
-  pcl::PCLPointCloud2ConstPtr cloud_pcl2 = next_cloud_;
-  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
-  pcl::fromPCLPointCloud2(*cloud_pcl2, *cloud);
   // lookup cloud_to_volume transform
   tf::StampedTransform cloud_to_volume;
-  try
-  {
-    tf_listener_.lookupTransform(volume_region_.pose.header.frame_id, cloud->header.frame_id, ros::Time(0),
-                                 cloud_to_volume);
-  }
-  catch (const tf2::TransformException& e)
-  {
-    ROS_ERROR_STREAM_NAMED(LOGNAME, "Exception when trying to to lookup transform: " << e.what());
+  if (!lookupCloudTransform(volume, cloud_pcl2->header.frame_id, cloud_to_volume))
     return false;
+
+  // voxelize the serialized cloud data directly without converting or transforming all points
+  if (voxelize_point_clouds_)
+  {
+    occupancy_data.type = OccupancyData::Type::GRID;
+    occupancy_data.grid.clear();
+    return voxelizePointCloud(*cloud_pcl2, volume, getVolumeToCloud(volume, cloud_to_volume), occupancy_data.grid);
   }
+
+  // convert cloud to pcl::PointCloud
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+  pcl::fromPCLPointCloud2(*cloud_pcl2, *cloud);
   // transform cloud to volume frame
   pcl_ros::transformPointCloud(*cloud, *cloud, cloud_to_volume);
   occupancy_data.point_cloud = cloud;
@@ -125,85 +236,441 @@ bool OccupancyHandler::fromPointCloud(OccupancyData& occupancy_data, double time
   return occupancy_data.point_cloud != NULL;
 }
 
+bool OccupancyHandler::voxelizePointCloud(const pcl::PCLPointCloud2& cloud, const RoadmapVolume& volume,
+                                          const Eigen::Isometry3d& volume_to_cloud, OccupancyGrid& grid) const
+{
+  // lookup byte offsets of the x/y/z coordinates
+  int offsets[3] = { -1, -1, -1 };
+  const std::string field_names[3] = { "x", "y", "z" };
+  for (const pcl::PCLPointField& field : cloud.fields)
+    for (std::size_t i = 0; i < 3; ++i)
+      if (field.name == field_names[i] && field.datatype == pcl::PCLPointField::FLOAT32)
+        offsets[i] = field.offset;
+  if (offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to voxelize point cloud without float32 fields 'x', 'y' and 'z'");
+    return false;
+  }
+  const uint32_t max_offset = *std::max_element(offsets, offsets + 3) + sizeof(float);
+  if (cloud.is_bigendian || max_offset > cloud.point_step || cloud.width * cloud.point_step > cloud.row_step ||
+      static_cast<std::size_t>(cloud.height) * cloud.row_step > cloud.data.size())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to voxelize point cloud with invalid data layout");
+    return false;
+  }
+
+  // reuse the grid buffer if possible
+  if (grid.getResolution() != volume.voxel_resolution)
+    grid.resize(volume.voxel_resolution);
+
+  // fuse transform and voxel scaling so that each point maps to voxel coordinates with a single affine transform
+  Eigen::Vector3f voxels_per_meter;
+  Eigen::Vector3f resolution;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    resolution[i] = volume.voxel_resolution[i];
+    voxels_per_meter[i] = resolution[i] / volume.dimension[i];
+  }
+  const Eigen::Matrix3f rotation = voxels_per_meter.asDiagonal() * volume_to_cloud.linear().cast<float>();
+  const Eigen::Vector3f translation = voxels_per_meter.cwiseProduct(volume_to_cloud.translation().cast<float>());
+
+  Eigen::Vector3f point;
+  for (uint32_t row = 0; row < cloud.height; ++row)
+  {
+    const uint8_t* point_data = cloud.data.data() + row * cloud.row_step;
+    for (uint32_t column = 0; column < cloud.width; ++column, point_data += cloud.point_step)
+    {
+      std::memcpy(&point[0], point_data + offsets[0], sizeof(float));
+      std::memcpy(&point[1], point_data + offsets[1], sizeof(float));
+      std::memcpy(&point[2], point_data + offsets[2], sizeof(float));
+      const Eigen::Vector3f voxel = rotation * point + translation;
+      // drop points outside of the volume, NaN points fail all comparisons
+      if (!(voxel[0] >= 0 && voxel[1] >= 0 && voxel[2] >= 0 && voxel[0] < resolution[0] &&
+            voxel[1] < resolution[1] && voxel[2] < resolution[2]))
+        continue;
+      grid.setOccupied(static_cast<uint16_t>(voxel[0]), static_cast<uint16_t>(voxel[1]),
+                       static_cast<uint16_t>(voxel[2]));
+    }
+  }
+  return true;
+}
+
 void OccupancyHandler::pclCallback(const pcl::PCLPointCloud2ConstPtr& cloud_pcl2)
 {
-  next_cloud_ = cloud_pcl2;
+  {
+    std::lock_guard<std::mutex> lock(pcl_mutex_);
+    next_cloud_ = cloud_pcl2;
+  }
+  pcl_condition_.notify_all();
+}
+
+bool OccupancyHandler::lookupCloudTransform(const RoadmapVolume& volume, const std::string& cloud_frame,
+                                            tf::StampedTransform& cloud_to_volume)
+{
+  try
+  {
+    tf_listener_.lookupTransform(volume.pose.header.frame_id, cloud_frame, ros::Time(0), cloud_to_volume);
+  }
+  catch (const tf2::TransformException& e)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Exception when trying to to lookup transform: " << e.what());
+    return false;
+  }
+  return true;
+}
+
+void OccupancyHandler::addPointCloudSensor(const std::string& name, const std::string& pcl_topic, double max_age)
+{
+  // subscribe outside of the lock, since shutting down a subscriber waits for running callbacks
+  ros::Subscriber subscriber = nh_.subscribe<pcl::PCLPointCloud2>(
+      pcl_topic, 1, boost::bind(&OccupancyHandler::sensorCallback, this, _1, name));
+  std::lock_guard<std::mutex> lock(pcl_mutex_);
+  PointCloudSensor& sensor = pcl_sensors_[name];
+  sensor.topic = pcl_topic;
+  sensor.max_age = max_age;
+  sensor.cloud.reset();
+  std::swap(sensor.subscriber, subscriber);
+}
+
+void OccupancyHandler::sensorCallback(const pcl::PCLPointCloud2ConstPtr& cloud_pcl2, const std::string& name)
+{
+  {
+    std::lock_guard<std::mutex> lock(pcl_mutex_);
+    auto sensor = pcl_sensors_.find(name);
+    if (sensor == pcl_sensors_.end())
+      return;
+    sensor->second.cloud = cloud_pcl2;
+  }
+  pcl_condition_.notify_all();
+}
+
+bool OccupancyHandler::fromFusedSources(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                        const RoadmapVolume& volume, OccupancyData& occupancy_data, double timeout,
+                                        const std::atomic<bool>* cancelled)
+{
+  // the planning scene voxels are the base of the fused grid, the voxel list of occupancy_data is reused for them
+  const ros::Time start_time = ros::Time::now();
+  if (!fromPlanningScene(planning_scene, volume, occupancy_data, cancelled))
+    return false;
+  OccupancyGrid& grid = occupancy_data.grid;
+  if (grid.getResolution() != volume.voxel_resolution)
+    grid.resize(volume.voxel_resolution);
+  else
+    grid.clear();
+  grid.setOccupied(occupancy_data.voxels);
+
+  // wait until all sensors received point clouds that are young enough
+  std::vector<pcl::PCLPointCloud2ConstPtr> clouds;
+  {
+    auto is_fresh = [&start_time](const PointCloudSensor& sensor) {
+      if (!sensor.cloud)
+        return false;
+      ros::Time pcl_stamp;
+      pcl_conversions::fromPCL(sensor.cloud->header.stamp, pcl_stamp);
+      return (start_time - pcl_stamp).toSec() <= sensor.max_age;
+    };
+    std::unique_lock<std::mutex> lock(pcl_mutex_);
+    const bool received_clouds = waitForCondition(pcl_condition_, lock, timeout, cancelled, [&]() {
+      for (const auto& sensor : pcl_sensors_)
+        if (!is_fresh(sensor.second))
+          return false;
+      return true;
+    });
+    if (!received_clouds)
+    {
+      if (isCancelled(cancelled))
+      {
+        ROS_DEBUG_NAMED(LOGNAME, "Waiting for point cloud data has been cancelled");
+        return false;
+      }
+      for (const auto& sensor : pcl_sensors_)
+        if (!is_fresh(sensor.second))
+          ROS_WARN_STREAM_NAMED(LOGNAME, "No recent point cloud data from sensor '" << sensor.first << "' on topic: "
+                                                                                    << sensor.second.topic);
+      return false;
+    }
+    for (const auto& sensor : pcl_sensors_)
+      clouds.push_back(sensor.second.cloud);
+  }
+
+  // add the voxels of all clouds to the grid
+  for (const pcl::PCLPointCloud2ConstPtr& cloud : clouds)
+  {
+    tf::StampedTransform cloud_to_volume;
+    if (!lookupCloudTransform(volume, cloud->header.frame_id, cloud_to_volume) ||
+        !voxelizePointCloud(*cloud, volume, getVolumeToCloud(volume, cloud_to_volume), grid))
+      return false;
+  }
+  occupancy_data.type = OccupancyData::Type::GRID;
+  return true;
 }
 
 bool OccupancyHandler::fromPlanningScene(const planning_scene::PlanningSceneConstPtr& planning_scene,
-                                         OccupancyData& occupancy_data)
+                                         const RoadmapVolume& volume, OccupancyData& occupancy_data,
+                                         const std::atomic<bool>* cancelled)
+{
+  // Compute transform: world->volume
+  // world_to_volume points at the corner of the volume origin (x=0,y=0,z=0)
+  // we use auto to support Affine3d and Isometry3d (kinetic + melodic)
+  auto world_to_base(planning_scene->getFrameTransform(volume.pose.header.frame_id));
+  auto base_to_volume = world_to_base;
+  tf::poseMsgToEigen(volume.pose.pose, base_to_volume);
+  Eigen::Isometry3d world_to_volume((world_to_base * base_to_volume).matrix());
+
+  // clear scene boxes vector
+  occupancy_data.type = OccupancyData::Type::VOXELS;
+  occupancy_data.voxels.resize(0);
+
+  if (voxelization_method_ == FULL_SWEEP)
+    sweepVolume(planning_scene, volume, world_to_volume, occupancy_data.voxels, cancelled);
+  else if (!voxelizeCollisionObjects(planning_scene, volume, world_to_volume, occupancy_data.voxels, cancelled))
+    return false;
+  if (isCancelled(cancelled))
+  {
+    ROS_DEBUG_NAMED(LOGNAME, "Planning scene voxelization has been cancelled");
+    return false;
+  }
+  return true;
+}
+
+void OccupancyHandler::clearOccupancyCache()
+{
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  occupancy_cache_.clear();
+}
+
+OccupancyHandler::VolumeOccupancyCache&
+OccupancyHandler::getVolumeOccupancyCache(const RoadmapVolume& volume, const Eigen::Isometry3d& world_to_volume)
+{
+  auto cache = std::find_if(occupancy_cache_.begin(), occupancy_cache_.end(),
+                            [&volume](const VolumeOccupancyCache& c) { return isSameVolume(c.volume, volume); });
+  if (cache == occupancy_cache_.end())
+  {
+    occupancy_cache_.emplace_back();
+    cache = occupancy_cache_.end() - 1;
+    cache->volume = volume;
+    cache->world_to_volume = world_to_volume;
+  }
+  else if (cache->world_to_volume.matrix() != world_to_volume.matrix())
+  {
+    // all cached voxels are invalid if the volume has moved in the planning frame
+    cache->world_to_volume = world_to_volume;
+    cache->objects.clear();
+    cache->voxels.clear();
+  }
+  return *cache;
+}
+
+bool OccupancyHandler::voxelizeCollisionObjects(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                                const RoadmapVolume& volume, const Eigen::Isometry3d& world_to_volume,
+                                                std::vector<rtr::Voxel>& voxels, const std::atomic<bool>* cancelled)
+{
+  std::lock_guard<std::mutex> lock(cache_mutex_);
+  VolumeOccupancyCache& cache = getVolumeOccupancyCache(volume, world_to_volume);
+
+  // revoxelize objects that have been added or moved since the last call
+  ShapeVoxelizer voxelizer(volume);
+  const collision_detection::World& world = *planning_scene->getWorld();
+  std::size_t updated_objects = 0;
+  for (const auto& object_item : world)
+  {
+    const collision_detection::World::Object& object = *object_item.second;
+    ObjectVoxels& object_voxels = cache.objects[object.id_];
+    const bool same_shapes =
+        object_voxels.shapes == object.shapes_ && isSamePoses(object_voxels.shape_poses, object.shape_poses_);
+    const uint64_t octree_fingerprint = getOctreeFingerprint(object);
+    if (same_shapes && object_voxels.octree_fingerprint == octree_fingerprint)
+      continue;
+    object_voxels.shapes = object.shapes_;
+    object_voxels.shape_poses = object.shape_poses_;
+    object_voxels.octree_fingerprint = octree_fingerprint;
+    object_voxels.voxels.clear();
+    voxelizeCollisionObject(voxelizer, object, world_to_volume, object_voxels.voxels, cancelled);
+    ++updated_objects;
+    if (isCancelled(cancelled))
+    {
+      // drop the incomplete object, it's voxelized again on the next call like all objects that haven't been visited
+      cache.objects.erase(object.id_);
+      break;
+    }
+  }
+
+  // remove objects that are no longer part of the world
+  std::size_t removed_objects = 0;
+  for (auto object_voxels = cache.objects.begin(); object_voxels != cache.objects.end();)
+  {
+    if (world.hasObject(object_voxels->first))
+    {
+      ++object_voxels;
+      continue;
+    }
+    object_voxels = cache.objects.erase(object_voxels);
+    ++removed_objects;
+  }
+
+  // merge object voxels only if anything changed
+  if (updated_objects > 0 || removed_objects > 0)
+  {
+    ROS_DEBUG_STREAM_NAMED(LOGNAME, "Updated " << updated_objects << " and removed " << removed_objects
+                                               << " collision objects in occupancy cache");
+    // the union grid removes duplicates and yields the voxels in X/Y/Z order without sorting
+    cache.grid.resize(volume.voxel_resolution);
+    for (const auto& object_voxels : cache.objects)
+      cache.grid.setOccupied(object_voxels.second.voxels);
+    cache.voxels.clear();
+    cache.grid.toVoxels(cache.voxels);
+  }
+  if (isCancelled(cancelled))
+    return false;
+  voxels = cache.voxels;
+  return true;
+}
+
+void OccupancyHandler::voxelizeCollisionObject(const ShapeVoxelizer& voxelizer,
+                                               const collision_detection::World::Object& object,
+                                               const Eigen::Isometry3d& world_to_volume,
+                                               std::vector<rtr::Voxel>& voxels, const std::atomic<bool>* cancelled)
+{
+  // The voxels of each shape are only generated inside the shape's bounding box, so that the runtime depends on the
+  // size of the collision objects and not on the resolution of the whole volume.
+  const Eigen::Isometry3d volume_to_world = world_to_volume.inverse();
+  std::vector<std::size_t> unsupported_shapes;
+  for (std::size_t i = 0; i < object.shapes_.size() && !isCancelled(cancelled); ++i)
+    if (!voxelizer.voxelizeShape(*object.shapes_[i], volume_to_world * object.shape_poses_[i], voxels))
+      unsupported_shapes.push_back(i);
+
+  // shapes without voxelization support are checked with an FCL voxel box in the complete volume
+  if (!unsupported_shapes.empty() && !isCancelled(cancelled))
+  {
+    ROS_DEBUG_STREAM_NAMED(LOGNAME, "Collision object '" << object.id_ << "' contains shapes that can't be voxelized "
+                                                                          "directly, checking complete volume");
+    probeCollisionObject(object, unsupported_shapes, voxelizer, world_to_volume, voxelizer.getVolumeRange(), voxels,
+                         cancelled);
+  }
+}
+
+void OccupancyHandler::probeCollisionObject(const collision_detection::World::Object& object,
+                                            const std::vector<std::size_t>& shape_ids,
+                                            const ShapeVoxelizer& voxelizer, const Eigen::Isometry3d& world_to_volume,
+                                            const VoxelRange& range, std::vector<rtr::Voxel>& voxels,
+                                            const std::atomic<bool>* cancelled)
+{
+  // collision world that only contains the given object shapes
+  collision_detection::CollisionWorldFCL object_world;
+  for (std::size_t shape_id : shape_ids)
+    object_world.getWorld()->addToObject(object.id_, object.shapes_[shape_id], object.shape_poses_[shape_id]);
+
+  // voxel box that is placed at the voxel centers
+  const Eigen::Vector3d& voxel_dimension = voxelizer.getVoxelDimension();
+  shapes::ShapeConstPtr box =
+      std::make_shared<const shapes::Box>(voxel_dimension[0], voxel_dimension[1], voxel_dimension[2]);
+  const std::string box_id = "rapidplan_collision_box";
+
+  processVoxelSlabs(range,
+                    [&](const VoxelRange& slab, std::vector<rtr::Voxel>& slab_voxels) {
+                      // each worker moves its own probe box, the object world is only read
+                      collision_detection::CollisionWorldFCL probe_world;
+                      probe_world.getWorld()->addToObject(box_id, box, world_to_volume);
+                      collision_detection::CollisionRequest request;
+                      collision_detection::CollisionResult result;
+                      for (uint16_t x = slab.min[0]; x < slab.max[0] && !isCancelled(cancelled); ++x)
+                      {
+                        for (uint16_t y = slab.min[1]; y < slab.max[1]; ++y)
+                        {
+                          for (uint16_t z = slab.min[2]; z < slab.max[2]; ++z)
+                          {
+                            Eigen::Translation3d voxel_center(voxelizer.getVoxelCenter(x, y, z));
+                            probe_world.getWorld()->moveShapeInObject(box_id, box, world_to_volume * voxel_center);
+                            object_world.checkWorldCollision(request, result, probe_world);
+                            if (result.collision)
+                            {
+                              slab_voxels.push_back(rtr::Voxel(x, y, z));
+                              result.clear();
+                            }
+                          }
+                        }
+                      }
+                    },
+                    voxels);
+}
+
+void OccupancyHandler::sweepVolume(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                   const RoadmapVolume& volume, const Eigen::Isometry3d& world_to_volume,
+                                   std::vector<rtr::Voxel>& voxels, const std::atomic<bool>* cancelled)
+{
+  ShapeVoxelizer voxelizer(volume);
+  processVoxelSlabs(voxelizer.getVolumeRange(),
+                    [&](const VoxelRange& slab, std::vector<rtr::Voxel>& slab_voxels) {
+                      sweepVoxelRange(planning_scene, volume, world_to_volume, slab, slab_voxels, cancelled);
+                    },
+                    voxels);
+}
+
+void OccupancyHandler::sweepVoxelRange(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                       const RoadmapVolume& volume, const Eigen::Isometry3d& world_to_volume,
+                                       const VoxelRange& range, std::vector<rtr::Voxel>& voxels,
+                                       const std::atomic<bool>* cancelled) const
 {
   // region volume dimensions
-  float x_length = volume_region_.dimension[0];
-  float y_length = volume_region_.dimension[1];
-  float z_length = volume_region_.dimension[2];
+  float x_length = volume.dimension[0];
+  float y_length = volume.dimension[1];
+  float z_length = volume.dimension[2];
 
   // voxel resolution
-  float x_voxels = volume_region_.voxel_resolution[0];
-  float y_voxels = volume_region_.voxel_resolution[1];
-  float z_voxels = volume_region_.voxel_resolution[2];
+  float x_voxels = volume.voxel_resolution[0];
+  float y_voxels = volume.voxel_resolution[1];
+  float z_voxels = volume.voxel_resolution[2];
 
   // voxel dimensions
   float x_voxel_dimension = x_length / x_voxels;
   float y_voxel_dimension = y_length / y_voxels;
   float z_voxel_dimension = z_length / z_voxels;
 
-  // Compute transform: world->volume
-  // world_to_volume points at the corner of the volume origin (x=0,y=0,z=0)
-  // we use auto to support Affine3d and Isometry3d (kinetic + melodic)
-  auto world_to_base(planning_scene->getFrameTransform(volume_region_.pose.header.frame_id));
-  auto base_to_volume = world_to_base;
-  tf::poseMsgToEigen(volume_region_.pose.pose, base_to_volume);
-  auto world_to_volume = world_to_base * base_to_volume;
+  // number of voxels to check in each dimension
+  uint16_t y_steps = range.max[1] - range.min[1];
+  uint16_t z_steps = range.max[2] - range.min[2];
 
-  // create collision world and add voxel box shape one step outside the volume grid
+  // create collision world and add voxel box shape one step outside the voxel range
   collision_detection::CollisionWorldFCL world;
   shapes::Box box(x_voxel_dimension, y_voxel_dimension, z_voxel_dimension);
-  Eigen::Translation3d box_start_position(-0.5 * x_voxel_dimension, -0.5 * y_voxel_dimension, -0.5 * z_voxel_dimension);
+  Eigen::Translation3d box_start_position((range.min[0] - 0.5) * x_voxel_dimension,
+                                          (range.min[1] - 0.5) * y_voxel_dimension,
+                                          (range.min[2] - 0.5) * z_voxel_dimension);
 
   // occupancy box id and dimensions
   // TODO(henningkayser): Check that box id is not present in planning scene - should be unique
   std::string box_id = "rapidplan_collision_box";
   world.getWorld()->addToObject(box_id, std::make_shared<const shapes::Box>(box), world_to_volume * box_start_position);
 
-  // clear scene boxes vector
-  occupancy_data.type = OccupancyData::Type::VOXELS;
-  occupancy_data.voxels.resize(0);
-
   // x/y/z translation steps, since relative movements are more efficient than repositioning the object
-  auto volume_orientation = world_to_volume.rotation();
-  auto x_step(volume_orientation * decltype(world_to_volume)(Eigen::Translation3d(x_voxel_dimension, 0, 0)));
-  auto y_step(volume_orientation * decltype(world_to_volume)(Eigen::Translation3d(0, y_voxel_dimension, 0)));
-  auto z_step(volume_orientation * decltype(world_to_volume)(Eigen::Translation3d(0, 0, z_voxel_dimension)));
+  auto volume_orientation = world_to_volume.linear();
+  auto x_step(volume_orientation * Eigen::Isometry3d(Eigen::Translation3d(x_voxel_dimension, 0, 0)));
+  auto y_step(volume_orientation * Eigen::Isometry3d(Eigen::Translation3d(0, y_voxel_dimension, 0)));
+  auto z_step(volume_orientation * Eigen::Isometry3d(Eigen::Translation3d(0, 0, z_voxel_dimension)));
 
   // x/y reset transforms
-  auto y_reset(volume_orientation *
-               decltype(world_to_volume)(Eigen::Translation3d(0, -y_voxels * y_voxel_dimension, 0)));
-  auto z_reset(volume_orientation *
-               decltype(world_to_volume)(Eigen::Translation3d(0, 0, -z_voxels * z_voxel_dimension)));
+  auto y_reset(volume_orientation * Eigen::Isometry3d(Eigen::Translation3d(0, -y_steps * y_voxel_dimension, 0)));
+  auto z_reset(volume_orientation * Eigen::Isometry3d(Eigen::Translation3d(0, 0, -z_steps * z_voxel_dimension)));
 
   // Loop over X/Y/Z voxel positions and check for box collisions in the collision scene
-  // NOTE: This implementation is a prototype and will be replaced by more efficient methods as described below
-  // TODO(RTR-57): More efficient implementations:
-  //                          * Iterate over collision objects and only sample local bounding boxes
-  //                          * Use octree search, since boxes can have variable sizes
+  // NOTE: This is the prototype implementation, it's only kept as reference for OBJECT_LOCAL voxelization
   // TODO(RTR-57): adjust grid to odd volume dimensions
   // TODO(RTR-57): Do we need extra Box padding here?
   collision_detection::CollisionRequest request;
   collision_detection::CollisionResult result;
-  for (uint16_t x = 0; x < x_voxels; ++x)
+  for (uint16_t x = range.min[0]; x < range.max[0] && !isCancelled(cancelled); ++x)
   {
     world.getWorld()->moveObject(box_id, x_step);
-    for (uint16_t y = 0; y < y_voxels; ++y)
+    for (uint16_t y = range.min[1]; y < range.max[1]; ++y)
     {
       world.getWorld()->moveObject(box_id, y_step);
-      for (uint16_t z = 0; z < z_voxels; ++z)
+      for (uint16_t z = range.min[2]; z < range.max[2]; ++z)
       {
         world.getWorld()->moveObject(box_id, z_step);
         planning_scene->getCollisionWorld()->checkWorldCollision(request, result, world);
         if (result.collision)
         {
-          occupancy_data.voxels.push_back(rtr::Voxel(x, y, z));
+          voxels.push_back(rtr::Voxel(x, y, z));
           result.clear();  // TODO(RTR-57): Is this really necessary?
         }
       }
@@ -213,6 +680,41 @@ bool OccupancyHandler::fromPlanningScene(const planning_scene::PlanningSceneCons
     // move object back to y start
     world.getWorld()->moveObject(box_id, y_reset);
   }
-  return true;
+}
+
+void OccupancyHandler::processVoxelSlabs(
+    const VoxelRange& range, const std::function<void(const VoxelRange&, std::vector<rtr::Voxel>&)>& process_slab,
+    std::vector<rtr::Voxel>& voxels) const
+{
+  // split the X range into slabs of equal size, at most one slab per thread
+  const std::size_t x_voxels = range.max[0] > range.min[0] ? range.max[0] - range.min[0] : 0;
+  const std::size_t slab_count = std::min<std::size_t>(voxelization_threads_, x_voxels);
+  if (slab_count <= 1)
+  {
+    process_slab(range, voxels);
+    return;
+  }
+  const std::size_t slab_size = (x_voxels + slab_count - 1) / slab_count;
+  std::vector<VoxelRange> slabs;
+  for (std::size_t x = range.min[0]; x < range.max[0]; x += slab_size)
+  {
+    VoxelRange slab = range;
+    slab.min[0] = x;
+    slab.max[0] = std::min<std::size_t>(x + slab_size, range.max[0]);
+    slabs.push_back(slab);
+  }
+
+  // process slabs in parallel, the first slab is processed by the calling thread
+  std::vector<std::vector<rtr::Voxel>> slab_voxels(slabs.size());
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < slabs.size(); ++i)
+    workers.emplace_back([&, i]() { process_slab(slabs[i], slab_voxels[i]); });
+  process_slab(slabs[0], slab_voxels[0]);
+  for (std::thread& worker : workers)
+    worker.join();
+
+  // merge voxels in slab order
+  for (const std::vector<rtr::Voxel>& slab : slab_voxels)
+    voxels.insert(voxels.end(), slab.begin(), slab.end());
 }
 }  // namespace rtr_moveit
@@ -0,0 +1,197 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Lock-free latency histograms and counters of the planning stages
+ */
+
+#include <rtr_moveit/planner_metrics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace rtr_moveit
+{
+namespace
+{
+// bucket i contains latencies in [2^(i/4), 2^((i+1)/4)) microseconds
+const double BUCKETS_PER_OCTAVE = 4.0;
+
+double getBucketUpperBound(std::size_t bucket)
+{
+  return 1e-6 * std::pow(2.0, (bucket + 1) / BUCKETS_PER_OCTAVE);
+}
+
+std::string formatMilliseconds(double seconds)
+{
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(3) << 1e3 * seconds;
+  return stream.str();
+}
+
+void addValue(diagnostic_msgs::DiagnosticStatus& status, const std::string& key, const std::string& value)
+{
+  diagnostic_msgs::KeyValue key_value;
+  key_value.key = key;
+  key_value.value = value;
+  status.values.push_back(key_value);
+}
+}  // namespace
+
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+void LatencyHistogram::record(double seconds)
+{
+  const double microseconds = std::max(seconds * 1e6, 1.0);
+  const std::size_t bucket =
+      std::min<std::size_t>(BUCKETS_PER_OCTAVE * std::log2(microseconds), NUM_BUCKETS - 1);
+  buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+
+  const uint64_t nanoseconds = std::max(seconds, 0.0) * 1e9;
+  uint64_t max_nanoseconds = max_nanoseconds_.load(std::memory_order_relaxed);
+  while (nanoseconds > max_nanoseconds &&
+         !max_nanoseconds_.compare_exchange_weak(max_nanoseconds, nanoseconds, std::memory_order_relaxed))
+    ;
+}
+
+LatencyHistogram::Summary LatencyHistogram::getSummary() const
+{
+  // buckets are read one by one, samples recorded meanwhile may be missing in the summary
+  Summary summary;
+  std::array<uint64_t, NUM_BUCKETS> buckets;
+  for (std::size_t i = 0; i < NUM_BUCKETS; ++i)
+  {
+    buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    summary.count += buckets[i];
+  }
+  if (summary.count == 0)
+    return summary;
+  summary.max = 1e-9 * max_nanoseconds_.load(std::memory_order_relaxed);
+
+  // percentiles are reported as upper bucket bounds, limited by the maximum
+  const uint64_t p50_rank = std::ceil(0.5 * summary.count);
+  const uint64_t p99_rank = std::ceil(0.99 * summary.count);
+  uint64_t rank = 0;
+  for (std::size_t i = 0; i < NUM_BUCKETS && rank < p99_rank; ++i)
+  {
+    if (rank < p50_rank && rank + buckets[i] >= p50_rank)
+      summary.p50 = std::min(getBucketUpperBound(i), summary.max);
+    rank += buckets[i];
+    if (rank >= p99_rank)
+      summary.p99 = std::min(getBucketUpperBound(i), summary.max);
+  }
+  return summary;
+}
+
+void LatencyHistogram::reset()
+{
+  for (std::atomic<uint64_t>& bucket : buckets_)
+    bucket = 0;
+  count_ = 0;
+  max_nanoseconds_ = 0;
+}
+
+PlannerMetrics::PlannerMetrics()
+{
+  reset();
+}
+
+void PlannerMetrics::getDiagnosticStatus(diagnostic_msgs::DiagnosticStatus& status) const
+{
+  status.level = diagnostic_msgs::DiagnosticStatus::OK;
+  status.name = "rtr_moveit: planner metrics";
+  status.message = "Latencies in milliseconds";
+  status.values.clear();
+  for (std::size_t i = 0; i < NUM_STAGES; ++i)
+  {
+    const LatencyHistogram::Summary summary = getStageSummary(Stage(i));
+    const std::string name = getStageName(Stage(i));
+    addValue(status, name + "/count", std::to_string(summary.count));
+    addValue(status, name + "/p50", formatMilliseconds(summary.p50));
+    addValue(status, name + "/p99", formatMilliseconds(summary.p99));
+    addValue(status, name + "/max", formatMilliseconds(summary.max));
+  }
+  for (std::size_t i = 0; i < NUM_COUNTERS; ++i)
+    addValue(status, getCounterName(Counter(i)), std::to_string(getCount(Counter(i))));
+
+  const uint64_t hits = getCount(COLLISION_CACHE_HITS);
+  const uint64_t lookups = hits + getCount(COLLISION_CACHE_MISSES);
+  std::ostringstream hit_rate;
+  hit_rate << std::fixed << std::setprecision(3) << (lookups > 0 ? double(hits) / lookups : 0.0);
+  addValue(status, "collision_cache_hit_rate", hit_rate.str());
+}
+
+void PlannerMetrics::reset()
+{
+  for (LatencyHistogram& stage : stages_)
+    stage.reset();
+  for (std::atomic<uint64_t>& counter : counters_)
+    counter = 0;
+}
+
+const char* PlannerMetrics::getStageName(Stage stage)
+{
+  static const char* names[NUM_STAGES] = { "solve",
+                                           "goal_sampling",
+                                           "occupancy",
+                                           "start_state",
+                                           "check_scene",
+                                           "mpa_check_scene",
+                                           "software_check_scene",
+                                           "find_path",
+                                           "goal_search",
+                                           "connect" };
+  return names[stage];
+}
+
+const char* PlannerMetrics::getCounterName(Counter counter)
+{
+  static const char* names[NUM_COUNTERS] = { "requests",
+                                             "successful_requests",
+                                             "preempted_requests",
+                                             "mpa_check_scene_calls",
+                                             "mpa_roadmap_writes",
+                                             "collision_cache_hits",
+                                             "collision_cache_misses",
+                                             "mpa_device_failures" };
+  return names[counter];
+}
+}  // namespace rtr_moveit
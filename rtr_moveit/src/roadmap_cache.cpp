@@ -0,0 +1,379 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: A thread-safe cache of immutable roadmap data that is shared between planning contexts
+ */
+
+#include <rtr_moveit/roadmap_cache.h>
+
+// C++
+#include <boost/filesystem.hpp>
+
+// ROS
+#include <ros/ros.h>
+#include <tf/transform_datatypes.h>
+
+// RapidPlan
+#include <rtr-api/OGFileReader.hpp>
+
+namespace rtr_moveit
+{
+static const std::string LOGNAME = "roadmap_cache";
+
+RoadmapCache::RoadmapCache(const std::string& snapshot_directory) : snapshot_directory_(snapshot_directory)
+{
+}
+
+bool RoadmapCache::getRoadmapData(const RoadmapSpecification& roadmap_spec, RoadmapDataConstPtr& roadmap_data)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto roadmap_search = roadmaps_.find(roadmap_spec.roadmap_id);
+    if (roadmap_search != roadmaps_.end())
+    {
+      roadmap_data = roadmap_search->second;
+      return true;
+    }
+  }
+
+  // read the roadmap file without holding the lock so that other roadmaps can still be accessed
+  std::shared_ptr<RoadmapData> new_roadmap_data = std::make_shared<RoadmapData>();
+  if (!loadRoadmapData(roadmap_spec, *new_roadmap_data))
+    return false;
+
+  // if the roadmap has been loaded concurrently, the first entry is kept
+  std::lock_guard<std::mutex> lock(mutex_);
+  roadmap_data = roadmaps_.emplace(roadmap_spec.roadmap_id, new_roadmap_data).first->second;
+  return true;
+}
+
+bool RoadmapCache::loadRoadmap(const RoadmapSpecification& roadmap_spec)
+{
+  RoadmapDataConstPtr roadmap_data;
+  return getRoadmapData(roadmap_spec, roadmap_data);
+}
+
+bool RoadmapCache::getRoadmapCoverage(const RoadmapSpecification& roadmap_spec, double cell_size,
+                                      bool use_coverage_file, RoadmapCoverageConstPtr& coverage)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto coverage_search = coverages_.find(std::make_pair(roadmap_spec.roadmap_id, cell_size));
+    if (coverage_search != coverages_.end())
+    {
+      coverage = coverage_search->second;
+      return true;
+    }
+  }
+
+  RoadmapFileStamp stamp;
+  if (!getRoadmapFileStamp(roadmap_spec.og_file, stamp))
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file not found '" << roadmap_spec.og_file << "'");
+    return false;
+  }
+
+  // read the coverage file if it's up to date, the roadmap data is only loaded otherwise
+  std::shared_ptr<RoadmapCoverage> new_coverage = std::make_shared<RoadmapCoverage>();
+  const std::string coverage_file = getCoverageFile(roadmap_spec);
+  std::shared_ptr<const void> storage;
+  const char* data;
+  std::size_t size;
+  if (!use_coverage_file || !boost::filesystem::exists(coverage_file) ||
+      !mapRoadmapFile(coverage_file, storage, data, size) ||
+      !new_coverage->deserialize(data, size, stamp, cell_size))
+  {
+    RoadmapDataConstPtr roadmap_data;
+    if (!getRoadmapData(roadmap_spec, roadmap_data))
+      return false;
+    new_coverage->build(*roadmap_data, cell_size);
+    ROS_INFO_STREAM_NAMED(LOGNAME, "Created coverage map of roadmap '" << roadmap_spec.roadmap_id << "'");
+    if (use_coverage_file)
+    {
+      std::vector<char> buffer;
+      new_coverage->serialize(stamp, buffer);
+      if (!writeRoadmapFile(coverage_file, buffer))
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to write roadmap coverage file " << coverage_file);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  coverage = coverages_.emplace(std::make_pair(roadmap_spec.roadmap_id, cell_size), new_coverage).first->second;
+  return true;
+}
+
+bool RoadmapCache::getRoadmapSweptVolumes(const RoadmapSpecification& roadmap_spec,
+                                          const robot_state::RobotState& default_state, const std::string& group_name,
+                                          double max_step, std::size_t num_threads, bool use_swept_volumes_file,
+                                          RoadmapSweptVolumesConstPtr& swept_volumes)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto swept_volumes_search = swept_volumes_.find(std::make_pair(group_name, roadmap_spec.roadmap_id));
+    if (swept_volumes_search != swept_volumes_.end())
+    {
+      swept_volumes = swept_volumes_search->second;
+      return true;
+    }
+  }
+
+  RoadmapFileStamp stamp;
+  if (!getRoadmapFileStamp(roadmap_spec.og_file, stamp))
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file not found '" << roadmap_spec.og_file << "'");
+    return false;
+  }
+
+  // read the swept volumes file if it's up to date, the roadmap data is only loaded otherwise
+  std::shared_ptr<RoadmapSweptVolumes> new_swept_volumes = std::make_shared<RoadmapSweptVolumes>();
+  const std::string swept_volumes_file = getSweptVolumesFile(roadmap_spec, group_name);
+  const uint64_t fingerprint = RoadmapSweptVolumes::getFingerprint(default_state, group_name, max_step);
+  std::shared_ptr<const void> storage;
+  const char* data;
+  std::size_t size;
+  if (!use_swept_volumes_file || !boost::filesystem::exists(swept_volumes_file) ||
+      !mapRoadmapFile(swept_volumes_file, storage, data, size) ||
+      !new_swept_volumes->deserialize(data, size, stamp, fingerprint))
+  {
+    RoadmapDataConstPtr roadmap_data;
+    if (!getRoadmapData(roadmap_spec, roadmap_data))
+      return false;
+    ROS_INFO_STREAM_NAMED(LOGNAME, "Computing swept volumes of " << roadmap_data->num_edges << " edges of roadmap '"
+                                                                 << roadmap_spec.roadmap_id << "' for group '"
+                                                                 << group_name << "'");
+    if (!new_swept_volumes->build(*roadmap_data, default_state, group_name, max_step, num_threads))
+      return false;
+    if (use_swept_volumes_file)
+    {
+      std::vector<char> buffer;
+      new_swept_volumes->serialize(stamp, buffer);
+      if (!writeRoadmapFile(swept_volumes_file, buffer))
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to write roadmap swept volumes file " << swept_volumes_file);
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  swept_volumes =
+      swept_volumes_.emplace(std::make_pair(group_name, roadmap_spec.roadmap_id), new_swept_volumes).first->second;
+  return true;
+}
+
+void RoadmapCache::removeRoadmap(const std::string& roadmap_id)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  roadmaps_.erase(roadmap_id);
+  for (auto coverage = coverages_.begin(); coverage != coverages_.end();)
+  {
+    if (coverage->first.first == roadmap_id)
+      coverage = coverages_.erase(coverage);
+    else
+      ++coverage;
+  }
+  for (auto swept_volumes = swept_volumes_.begin(); swept_volumes != swept_volumes_.end();)
+  {
+    if (swept_volumes->first.second == roadmap_id)
+      swept_volumes = swept_volumes_.erase(swept_volumes);
+    else
+      ++swept_volumes;
+  }
+}
+
+void RoadmapCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  roadmaps_.clear();
+  coverages_.clear();
+  swept_volumes_.clear();
+}
+
+bool RoadmapCache::loadRoadmapData(const RoadmapSpecification& roadmap_spec, RoadmapData& roadmap_data) const
+{
+  roadmap_data.spec = roadmap_spec;
+  RoadmapFileStamp stamp;
+  if (!getRoadmapFileStamp(roadmap_spec.og_file, stamp))
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file not found '" << roadmap_spec.og_file << "'");
+    return false;
+  }
+
+  // map existing snapshot or read .og file and create a new one
+  if (!mapSnapshotFile(roadmap_spec, stamp, roadmap_data))
+  {
+    std::vector<char> buffer;
+    if (!readRoadmapFile(roadmap_spec, stamp, buffer))
+      return false;
+    if (!snapshot_directory_.empty())
+    {
+      boost::system::error_code error;
+      boost::filesystem::create_directories(snapshot_directory_, error);
+      if (!writeRoadmapFile(getSnapshotFile(roadmap_spec.roadmap_id), buffer))
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to write roadmap snapshot to " << snapshot_directory_);
+    }
+    // fall back to keeping the buffer in memory if the snapshot can't be mapped
+    if (!mapSnapshotFile(roadmap_spec, stamp, roadmap_data))
+    {
+      std::shared_ptr<std::vector<char>> storage = std::make_shared<std::vector<char>>();
+      storage->swap(buffer);
+      if (!readRoadmapBuffer(storage, storage->data(), storage->size(), stamp, roadmap_data))
+      {
+        ROS_ERROR_NAMED(LOGNAME, "Failed to read roadmap data buffer");
+        return false;
+      }
+    }
+  }
+
+  // build search indices for start and goal state candidates
+  roadmap_data.config_index.build(roadmap_data.configs, roadmap_data.num_states, roadmap_data.dimension);
+  roadmap_data.pose_index.build(roadmap_data.poses, roadmap_data.num_states, POSE_SIZE);
+  return true;
+}
+
+bool RoadmapCache::mapSnapshotFile(const RoadmapSpecification& roadmap_spec, const RoadmapFileStamp& stamp,
+                                   RoadmapData& roadmap_data) const
+{
+  if (snapshot_directory_.empty())
+    return false;
+  const std::string snapshot_file = getSnapshotFile(roadmap_spec.roadmap_id);
+  std::shared_ptr<const void> storage;
+  const char* data;
+  std::size_t size;
+  if (!mapRoadmapFile(snapshot_file, storage, data, size))
+    return false;
+  if (!readRoadmapBuffer(storage, data, size, stamp, roadmap_data))
+  {
+    ROS_INFO_STREAM_NAMED(LOGNAME, "Roadmap snapshot " << snapshot_file << " is outdated or invalid");
+    return false;
+  }
+  ROS_INFO_STREAM_NAMED(LOGNAME, "Mapped roadmap data of '" << roadmap_spec.roadmap_id << "' from " << snapshot_file);
+  return true;
+}
+
+bool RoadmapCache::readRoadmapFile(const RoadmapSpecification& roadmap_spec, const RoadmapFileStamp& stamp,
+                                   std::vector<char>& buffer) const
+{
+  ROS_INFO_STREAM_NAMED(LOGNAME, "Loading roadmap data of '" << roadmap_spec.roadmap_id << "' from "
+                                                              << roadmap_spec.og_file);
+  rtr::OGFileReader og_file(roadmap_spec.og_file);
+  if (!og_file.IsValid())
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file invalid " << roadmap_spec.og_file << "'");
+    return false;
+  }
+
+  // get roadmap configs
+  std::vector<rtr::Config> configs;
+  if (!og_file.GetConfigs(configs) || configs.empty())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load config states from roadmap file");
+    return false;
+  }
+  for (const rtr::Config& config : configs)
+  {
+    if (config.size() != configs[0].size())
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Roadmap file contains config states of different dimensions");
+      return false;
+    }
+  }
+
+  // get roadmap poses
+  std::vector<rtr::ToolPose> poses;
+  if (!og_file.GetPoses(poses) || poses.size() != configs.size())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load state poses from roadmap file");
+    return false;
+  }
+
+  // get roadmap edges
+  std::vector<rtr::EdgeInfo> edges;
+  if (!og_file.GetEdges(edges) || edges.empty())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load state edges from roadmap file");
+    return false;
+  }
+
+  // load occupancy region volume
+  RoadmapSpecification spec;
+  RoadmapVolume& volume = spec.volume;
+  rtr::ToolPose volume_center_pose;
+  if (!og_file.GetVoxelRegion(volume.pose.header.frame_id, volume_center_pose, volume.dimension))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Unable to load voxel region from roadmap file");
+    return false;
+  }
+  volume.pose.pose.position.x = volume_center_pose[0];
+  volume.pose.pose.position.y = volume_center_pose[1];
+  volume.pose.pose.position.z = volume_center_pose[2];
+  volume.pose.pose.orientation =
+      tf::createQuaternionMsgFromRollPitchYaw(volume_center_pose[3], volume_center_pose[4], volume_center_pose[5]);
+  volume.pose.header.frame_id = "world";  // NOTE: GetVoxelRegion returns an empty frame - we fix this here
+  if (!og_file.GetResolution(volume.voxel_resolution))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Failed to read volume voxel resolution from roadmap file");
+    return false;
+  }
+  std::array<float, 6> start_link_transform;
+  if (!og_file.GetKinematicData(start_link_transform, spec.base_link_frame, spec.end_effector_frame))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Failed to read kinematic data roadmap file");
+    return false;
+  }
+
+  writeRoadmapBuffer(spec, configs, poses, edges, stamp, buffer);
+  return true;
+}
+
+std::string RoadmapCache::getSnapshotFile(const std::string& roadmap_id) const
+{
+  boost::filesystem::path snapshot_file(snapshot_directory_);
+  snapshot_file /= roadmap_id + ".rmap";
+  return snapshot_file.string();
+}
+
+std::string RoadmapCache::getCoverageFile(const RoadmapSpecification& roadmap_spec) const
+{
+  boost::filesystem::path coverage_file(roadmap_spec.og_file);
+  coverage_file.replace_extension(".coverage");
+  return coverage_file.string();
+}
+
+std::string RoadmapCache::getSweptVolumesFile(const RoadmapSpecification& roadmap_spec,
+                                              const std::string& group_name) const
+{
+  // the swept volumes depend on the link geometry of the group, so every group has its own file
+  boost::filesystem::path swept_volumes_file(roadmap_spec.og_file);
+  swept_volumes_file.replace_extension("." + group_name + ".swept");
+  return swept_volumes_file.string();
+}
+}  // namespace rtr_moveit
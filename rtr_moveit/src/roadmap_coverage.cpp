@@ -0,0 +1,242 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Compact workspace and joint space coverage maps of roadmaps for checking requests without loading roadmaps
+ */
+
+#include <rtr_moveit/roadmap_coverage.h>
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace rtr_moveit
+{
+namespace
+{
+const char ROADMAP_COVERAGE_MAGIC[8] = { 'R', 'T', 'R', 'C', 'O', 'V', 'R', '\0' };
+const uint32_t ROADMAP_COVERAGE_VERSION = 1;
+
+// Coverage file layout: header, frame names, joint lower bounds, joint upper bounds, grid cells
+struct RoadmapCoverageHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t dimension;
+  uint64_t source_size;
+  int64_t source_modification_time;
+  double cell_size;
+  double grid_origin[3];
+  uint32_t grid_size[3];
+  // lengths of base link frame and end effector frame
+  uint32_t frame_sizes[2];
+  uint32_t reserved;
+};
+}  // namespace
+
+void RoadmapCoverage::build(const RoadmapData& roadmap_data, double cell_size)
+{
+  base_link_frame_ = roadmap_data.spec.base_link_frame;
+  end_effector_frame_ = roadmap_data.spec.end_effector_frame;
+  cell_size_ = cell_size;
+  joint_lower_.assign(roadmap_data.dimension, std::numeric_limits<float>::max());
+  joint_upper_.assign(roadmap_data.dimension, std::numeric_limits<float>::lowest());
+  grid_size_ = { { 0, 0, 0 } };
+  cells_.clear();
+  if (roadmap_data.num_states == 0)
+    return;
+
+  // joint bounds and tool position bounds
+  Eigen::Vector3d position_lower = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+  Eigen::Vector3d position_upper = Eigen::Vector3d::Constant(std::numeric_limits<double>::lowest());
+  for (std::size_t state_id = 0; state_id < roadmap_data.num_states; ++state_id)
+  {
+    const float* config = roadmap_data.getConfig(state_id);
+    for (std::size_t i = 0; i < roadmap_data.dimension; ++i)
+    {
+      joint_lower_[i] = std::min(joint_lower_[i], config[i]);
+      joint_upper_[i] = std::max(joint_upper_[i], config[i]);
+    }
+    const float* pose = roadmap_data.getPose(state_id);
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      position_lower[i] = std::min<double>(position_lower[i], pose[i]);
+      position_upper[i] = std::max<double>(position_upper[i], pose[i]);
+    }
+  }
+
+  // mark the cells of all tool positions
+  grid_origin_ = position_lower;
+  for (std::size_t i = 0; i < 3; ++i)
+    grid_size_[i] = std::floor((position_upper[i] - position_lower[i]) / cell_size_) + 1;
+  cells_.assign((std::size_t(grid_size_[0]) * grid_size_[1] * grid_size_[2] + 63) / 64, 0);
+  for (std::size_t state_id = 0; state_id < roadmap_data.num_states; ++state_id)
+  {
+    const float* pose = roadmap_data.getPose(state_id);
+    std::size_t cell[3];
+    for (std::size_t i = 0; i < 3; ++i)
+      cell[i] = std::min<std::size_t>((pose[i] - grid_origin_[i]) / cell_size_, grid_size_[i] - 1);
+    const std::size_t index = (cell[0] * grid_size_[1] + cell[1]) * grid_size_[2] + cell[2];
+    cells_[index / 64] |= uint64_t(1) << (index % 64);
+  }
+}
+
+double RoadmapCoverage::getJointDistance(const std::vector<double>& lower, const std::vector<double>& upper) const
+{
+  if (lower.size() != joint_lower_.size() || upper.size() != joint_upper_.size())
+    return 0.0;
+  double distance = 0.0;
+  for (std::size_t i = 0; i < joint_lower_.size(); ++i)
+  {
+    if (lower[i] > joint_upper_[i])
+      distance += lower[i] - joint_upper_[i];
+    else if (upper[i] < joint_lower_[i])
+      distance += joint_lower_[i] - upper[i];
+  }
+  return distance;
+}
+
+bool RoadmapCoverage::coversPosition(const Eigen::Vector3d& position, double distance) const
+{
+  if (cells_.empty())
+    return false;
+
+  // range of cells that intersect the bounding box of the distance sphere
+  std::size_t begin[3], end[3];
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    const double lower = std::floor((position[i] - distance - grid_origin_[i]) / cell_size_);
+    const double upper = std::floor((position[i] + distance - grid_origin_[i]) / cell_size_);
+    if (upper < 0.0 || lower >= grid_size_[i])
+      return false;
+    begin[i] = std::max(lower, 0.0);
+    end[i] = std::min<double>(upper, grid_size_[i] - 1) + 1;
+  }
+
+  // look for a covered cell that isn't farther away than distance
+  const double squared_distance = distance * distance;
+  for (std::size_t x = begin[0]; x < end[0]; ++x)
+    for (std::size_t y = begin[1]; y < end[1]; ++y)
+      for (std::size_t z = begin[2]; z < end[2]; ++z)
+      {
+        if (!isCovered(x, y, z))
+          continue;
+        const std::size_t cell[3] = { x, y, z };
+        double cell_distance = 0.0;
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+          const double cell_lower = grid_origin_[i] + cell[i] * cell_size_;
+          const double offset = std::max({ cell_lower - position[i], position[i] - cell_lower - cell_size_, 0.0 });
+          cell_distance += offset * offset;
+        }
+        if (cell_distance <= squared_distance)
+          return true;
+      }
+  return false;
+}
+
+void RoadmapCoverage::serialize(const RoadmapFileStamp& stamp, std::vector<char>& buffer) const
+{
+  RoadmapCoverageHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, ROADMAP_COVERAGE_MAGIC, sizeof(header.magic));
+  header.version = ROADMAP_COVERAGE_VERSION;
+  header.dimension = joint_lower_.size();
+  header.source_size = stamp.size;
+  header.source_modification_time = stamp.modification_time;
+  header.cell_size = cell_size_;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    header.grid_origin[i] = grid_origin_[i];
+    header.grid_size[i] = grid_size_[i];
+  }
+  header.frame_sizes[0] = base_link_frame_.size();
+  header.frame_sizes[1] = end_effector_frame_.size();
+
+  buffer.clear();
+  auto append = [&buffer](const void* data, std::size_t size) {
+    buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+  };
+  append(&header, sizeof(header));
+  append(base_link_frame_.data(), base_link_frame_.size());
+  append(end_effector_frame_.data(), end_effector_frame_.size());
+  append(joint_lower_.data(), joint_lower_.size() * sizeof(float));
+  append(joint_upper_.data(), joint_upper_.size() * sizeof(float));
+  append(cells_.data(), cells_.size() * sizeof(uint64_t));
+}
+
+bool RoadmapCoverage::deserialize(const char* data, std::size_t size, const RoadmapFileStamp& stamp,
+                                  double cell_size)
+{
+  RoadmapCoverageHeader header;
+  if (size < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, ROADMAP_COVERAGE_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != ROADMAP_COVERAGE_VERSION || header.source_size != stamp.size ||
+      header.source_modification_time != stamp.modification_time || header.cell_size != cell_size)
+    return false;
+
+  const std::size_t num_cells = std::size_t(header.grid_size[0]) * header.grid_size[1] * header.grid_size[2];
+  const std::size_t num_words = (num_cells + 63) / 64;
+  if (size != sizeof(header) + header.frame_sizes[0] + header.frame_sizes[1] +
+                  2 * header.dimension * sizeof(float) + num_words * sizeof(uint64_t))
+    return false;
+
+  const char* position = data + sizeof(header);
+  base_link_frame_.assign(position, header.frame_sizes[0]);
+  position += header.frame_sizes[0];
+  end_effector_frame_.assign(position, header.frame_sizes[1]);
+  position += header.frame_sizes[1];
+  joint_lower_.resize(header.dimension);
+  std::memcpy(joint_lower_.data(), position, header.dimension * sizeof(float));
+  position += header.dimension * sizeof(float);
+  joint_upper_.resize(header.dimension);
+  std::memcpy(joint_upper_.data(), position, header.dimension * sizeof(float));
+  position += header.dimension * sizeof(float);
+  cells_.resize(num_words);
+  std::memcpy(cells_.data(), position, num_words * sizeof(uint64_t));
+
+  cell_size_ = header.cell_size;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    grid_origin_[i] = header.grid_origin[i];
+    grid_size_[i] = header.grid_size[i];
+  }
+  return true;
+}
+}  // namespace rtr_moveit
@@ -0,0 +1,249 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: Immutable roadmap data in a flat memory layout that can be mapped from a snapshot file
+ */
+
+#include <rtr_moveit/roadmap_data.h>
+
+// C++
+#include <cstring>
+#include <fstream>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rtr_moveit
+{
+namespace
+{
+const char ROADMAP_DATA_MAGIC[8] = { 'R', 'T', 'R', 'R', 'M', 'A', 'P', '\0' };
+const uint32_t ROADMAP_DATA_VERSION = 1;
+
+// Snapshot layout: header, frame names, padding to 8 bytes, configs, poses, edges
+struct RoadmapDataHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t dimension;
+  uint64_t num_states;
+  uint64_t num_edges;
+  uint64_t source_size;
+  int64_t source_modification_time;
+  double volume_position[3];
+  double volume_orientation[4];
+  float volume_dimension[3];
+  uint16_t voxel_resolution[3];
+  uint16_t reserved;
+  // lengths of volume frame, base link frame and end effector frame
+  uint32_t frame_sizes[3];
+};
+static_assert(sizeof(RoadmapDataHeader) % 8 == 0, "Roadmap data header needs to be aligned to 8 bytes");
+
+std::size_t alignSize(std::size_t size)
+{
+  return (size + 7) & ~std::size_t(7);
+}
+
+// byte offsets of the data arrays, returns the total buffer size
+std::size_t getDataOffsets(const RoadmapDataHeader& header, std::size_t& configs_offset, std::size_t& poses_offset,
+                           std::size_t& edges_offset)
+{
+  configs_offset =
+      alignSize(sizeof(RoadmapDataHeader) + header.frame_sizes[0] + header.frame_sizes[1] + header.frame_sizes[2]);
+  poses_offset = configs_offset + header.num_states * header.dimension * sizeof(float);
+  edges_offset = poses_offset + header.num_states * POSE_SIZE * sizeof(float);
+  return edges_offset + header.num_edges * 2 * sizeof(uint32_t);
+}
+}  // namespace
+
+bool getRoadmapFileStamp(const std::string& file, RoadmapFileStamp& stamp)
+{
+  struct stat file_stat;
+  if (stat(file.c_str(), &file_stat) != 0)
+    return false;
+  stamp.size = file_stat.st_size;
+  stamp.modification_time = int64_t(file_stat.st_mtim.tv_sec) * 1000000000 + file_stat.st_mtim.tv_nsec;
+  return true;
+}
+
+void writeRoadmapBuffer(const RoadmapSpecification& spec, const std::vector<rtr::Config>& configs,
+                        const std::vector<rtr::ToolPose>& poses, const std::vector<rtr::EdgeInfo>& edges,
+                        const RoadmapFileStamp& stamp, std::vector<char>& buffer)
+{
+  RoadmapDataHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, ROADMAP_DATA_MAGIC, sizeof(header.magic));
+  header.version = ROADMAP_DATA_VERSION;
+  header.dimension = configs.empty() ? 0 : configs[0].size();
+  header.num_states = configs.size();
+  header.num_edges = edges.size();
+  header.source_size = stamp.size;
+  header.source_modification_time = stamp.modification_time;
+  const geometry_msgs::Pose& volume_pose = spec.volume.pose.pose;
+  header.volume_position[0] = volume_pose.position.x;
+  header.volume_position[1] = volume_pose.position.y;
+  header.volume_position[2] = volume_pose.position.z;
+  header.volume_orientation[0] = volume_pose.orientation.x;
+  header.volume_orientation[1] = volume_pose.orientation.y;
+  header.volume_orientation[2] = volume_pose.orientation.z;
+  header.volume_orientation[3] = volume_pose.orientation.w;
+  std::copy(spec.volume.dimension.begin(), spec.volume.dimension.end(), header.volume_dimension);
+  std::copy(spec.volume.voxel_resolution.begin(), spec.volume.voxel_resolution.end(), header.voxel_resolution);
+  const std::string* frames[3] = { &spec.volume.pose.header.frame_id, &spec.base_link_frame,
+                                   &spec.end_effector_frame };
+  for (std::size_t i = 0; i < 3; ++i)
+    header.frame_sizes[i] = frames[i]->size();
+
+  std::size_t configs_offset, poses_offset, edges_offset;
+  buffer.assign(getDataOffsets(header, configs_offset, poses_offset, edges_offset), 0);
+  std::memcpy(buffer.data(), &header, sizeof(header));
+  std::size_t frame_offset = sizeof(header);
+  for (const std::string* frame : frames)
+  {
+    std::memcpy(buffer.data() + frame_offset, frame->data(), frame->size());
+    frame_offset += frame->size();
+  }
+  float* config_values = reinterpret_cast<float*>(buffer.data() + configs_offset);
+  for (const rtr::Config& config : configs)
+    config_values = std::copy(config.begin(), config.end(), config_values);
+  float* pose_values = reinterpret_cast<float*>(buffer.data() + poses_offset);
+  for (const rtr::ToolPose& pose : poses)
+    pose_values = std::copy(pose.begin(), pose.end(), pose_values);
+  uint32_t* edge_ids = reinterpret_cast<uint32_t*>(buffer.data() + edges_offset);
+  for (const rtr::EdgeInfo& edge : edges)
+  {
+    *edge_ids++ = edge.start_index;
+    *edge_ids++ = edge.end_index;
+  }
+}
+
+bool readRoadmapBuffer(const std::shared_ptr<const void>& storage, const char* data, std::size_t size,
+                       const RoadmapFileStamp& stamp, RoadmapData& roadmap_data)
+{
+  // validate header
+  if (size < sizeof(RoadmapDataHeader))
+    return false;
+  RoadmapDataHeader header;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, ROADMAP_DATA_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != ROADMAP_DATA_VERSION || header.source_size != stamp.size ||
+      header.source_modification_time != stamp.modification_time)
+    return false;
+  std::size_t configs_offset, poses_offset, edges_offset;
+  if (getDataOffsets(header, configs_offset, poses_offset, edges_offset) != size)
+    return false;
+
+  // validate edges
+  const uint32_t* edges = reinterpret_cast<const uint32_t*>(data + edges_offset);
+  for (std::size_t i = 0; i < 2 * header.num_edges; ++i)
+    if (edges[i] >= header.num_states)
+      return false;
+
+  // read specification
+  RoadmapSpecification& spec = roadmap_data.spec;
+  geometry_msgs::Pose& volume_pose = spec.volume.pose.pose;
+  volume_pose.position.x = header.volume_position[0];
+  volume_pose.position.y = header.volume_position[1];
+  volume_pose.position.z = header.volume_position[2];
+  volume_pose.orientation.x = header.volume_orientation[0];
+  volume_pose.orientation.y = header.volume_orientation[1];
+  volume_pose.orientation.z = header.volume_orientation[2];
+  volume_pose.orientation.w = header.volume_orientation[3];
+  std::copy(header.volume_dimension, header.volume_dimension + 3, spec.volume.dimension.begin());
+  std::copy(header.voxel_resolution, header.voxel_resolution + 3, spec.volume.voxel_resolution.begin());
+  std::string* frames[3] = { &spec.volume.pose.header.frame_id, &spec.base_link_frame, &spec.end_effector_frame };
+  const char* frame_data = data + sizeof(header);
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    frames[i]->assign(frame_data, header.frame_sizes[i]);
+    frame_data += header.frame_sizes[i];
+  }
+
+  // data views
+  roadmap_data.dimension = header.dimension;
+  roadmap_data.num_states = header.num_states;
+  roadmap_data.num_edges = header.num_edges;
+  roadmap_data.configs = reinterpret_cast<const float*>(data + configs_offset);
+  roadmap_data.poses = reinterpret_cast<const float*>(data + poses_offset);
+  roadmap_data.edges = edges;
+  roadmap_data.storage = storage;
+  return true;
+}
+
+bool mapRoadmapFile(const std::string& file, std::shared_ptr<const void>& storage, const char*& data,
+                    std::size_t& size)
+{
+  int fd = open(file.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size <= 0)
+  {
+    close(fd);
+    return false;
+  }
+  size = file_stat.st_size;
+  void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);  // the mapping remains valid
+  if (address == MAP_FAILED)
+    return false;
+  data = static_cast<const char*>(address);
+  storage.reset(address, [size](void* mapped_address) { munmap(mapped_address, size); });
+  return true;
+}
+
+bool writeRoadmapFile(const std::string& file, const std::vector<char>& buffer)
+{
+  const std::string tmp_file = file + ".tmp." + std::to_string(getpid());
+  {
+    std::ofstream stream(tmp_file, std::ios::binary | std::ios::trunc);
+    if (!stream.write(buffer.data(), buffer.size()) || !stream.flush())
+    {
+      stream.close();
+      unlink(tmp_file.c_str());
+      return false;
+    }
+  }
+  if (rename(tmp_file.c_str(), file.c_str()) != 0)
+  {
+    unlink(tmp_file.c_str());
+    return false;
+  }
+  return true;
+}
+}  // namespace rtr_moveit
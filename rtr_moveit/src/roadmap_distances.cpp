@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: Batched distance kernels for roadmap states stored in structure-of-arrays layout
+ */
+
+#include <rtr_moveit/roadmap_distances.h>
+
+namespace rtr_moveit
+{
+// The inner loops are marked as OpenMP SIMD loops, which the package compiles with -fopenmp-simd. This vectorizes
+// them independent of the optimization level and without runtime alias checks of distances and columns.
+
+void computeConfigDistances(const float* query, const float* columns, std::size_t stride, std::size_t dimension,
+                            std::size_t count, float* distances)
+{
+  std::fill(distances, distances + count, 0.0f);
+  for (std::size_t j = 0; j < dimension; ++j)
+  {
+    const float value = query[j];
+    const float* column = columns + j * stride;
+#pragma omp simd
+    for (std::size_t i = 0; i < count; ++i)
+      distances[i] += std::abs(value - column[i]);
+  }
+}
+
+void computePositionDistances(const float* query, const float* columns, std::size_t stride, std::size_t count,
+                              float* distances)
+{
+  std::fill(distances, distances + count, 0.0f);
+  for (std::size_t d = 0; d < 3; ++d)
+  {
+    const float value = query[d];
+    const float* column = columns + d * stride;
+#pragma omp simd
+    for (std::size_t i = 0; i < count; ++i)
+    {
+      const double difference = value - column[i];
+      distances[i] = distances[i] + difference * difference;
+    }
+  }
+  for (std::size_t i = 0; i < count; ++i)
+    distances[i] = std::sqrt(distances[i]);
+}
+}  // namespace rtr_moveit
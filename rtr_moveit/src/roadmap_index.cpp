@@ -0,0 +1,232 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: KD-tree index for nearest neighbor queries on roadmap states and tool poses
+ */
+
+#include <rtr_moveit/roadmap_index.h>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace rtr_moveit
+{
+namespace
+{
+// number of coordinates used for splitting the KD-tree
+std::size_t getIndexDimension(const rtr::Config&, std::size_t size)
+{
+  return size;
+}
+
+std::size_t getIndexDimension(const rtr::ToolPose&, std::size_t)
+{
+  return 3;  // position only
+}
+
+// batched distances of leaf items, identical to getDistance<T>()
+void computeLeafDistances(const rtr::Config& config, const float* columns, std::size_t stride, std::size_t count,
+                          float* distances)
+{
+  computeConfigDistances(config.data(), columns, stride, config.size(), count, distances);
+}
+
+void computeLeafDistances(const rtr::ToolPose& pose, const float* columns, std::size_t stride, std::size_t count,
+                          float* distances)
+{
+  computePositionDistances(pose.data(), columns, stride, count, distances);
+}
+
+// Relative tolerance for pruning KD-tree branches. The split distance is a lower bound of the per-item distance,
+// the tolerance compensates rounding errors of the distance functions so that no result is pruned by mistake.
+const float PRUNING_TOLERANCE = 1e-5;
+
+// number of items per batch of the linear search, the distances of a batch stay in the L1 cache
+const std::size_t LINEAR_SEARCH_BATCH_SIZE = 1024;
+}  // namespace
+
+template <class T>
+void RoadmapIndex<T>::build(const std::vector<T>& items, std::size_t leaf_size)
+{
+  if (items.empty())
+  {
+    clear();
+    return;
+  }
+  const std::size_t stride = items[0].size();
+  std::vector<float> rows(items.size() * stride);
+  for (std::size_t i = 0; i < items.size(); ++i)
+    std::copy(items[i].begin(), items[i].end(), rows.begin() + i * stride);
+  build(rows.data(), items.size(), stride, leaf_size);
+}
+
+template <class T>
+void RoadmapIndex<T>::build(const float* rows, std::size_t count, std::size_t stride, std::size_t leaf_size)
+{
+  clear();
+  if (count == 0)
+    return;
+  dimension_ = getIndexDimension(T(), stride);
+  leaf_size_ = std::max<std::size_t>(leaf_size, 1);
+  ids_.resize(count);
+  std::iota(ids_.begin(), ids_.end(), 0);
+  nodes_.reserve(2 * count / leaf_size_ + 1);
+  buildNode(rows, stride, 0, count);
+
+  // copy coordinates in leaf order
+  coordinates_.resize(dimension_ * count);
+  for (std::size_t d = 0; d < dimension_; ++d)
+    for (std::size_t i = 0; i < count; ++i)
+      coordinates_[d * count + i] = rows[ids_[i] * stride + d];
+}
+
+template <class T>
+void RoadmapIndex<T>::clear()
+{
+  dimension_ = 0;
+  leaf_size_ = 0;
+  ids_.clear();
+  coordinates_.clear();
+  nodes_.clear();
+}
+
+template <class T>
+std::size_t RoadmapIndex<T>::buildNode(const float* rows, std::size_t stride, std::size_t begin, std::size_t end)
+{
+  const std::size_t node_id = nodes_.size();
+  nodes_.push_back(Node{ begin, end, 0, 0.0, { 0, 0 } });
+  if (end - begin <= leaf_size_)
+    return node_id;
+
+  // split at the median of the dimension with the largest extent
+  float max_extent = -1.0;
+  std::size_t split_dimension = 0;
+  for (std::size_t d = 0; d < dimension_; ++d)
+  {
+    float min_value = FLT_MAX;
+    float max_value = -FLT_MAX;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+      min_value = std::min(min_value, rows[ids_[i] * stride + d]);
+      max_value = std::max(max_value, rows[ids_[i] * stride + d]);
+    }
+    if (max_value - min_value > max_extent)
+    {
+      max_extent = max_value - min_value;
+      split_dimension = d;
+    }
+  }
+  const std::size_t median = begin + (end - begin) / 2;
+  std::nth_element(ids_.begin() + begin, ids_.begin() + median, ids_.begin() + end,
+                   [&](std::size_t a, std::size_t b) {
+                     return rows[a * stride + split_dimension] < rows[b * stride + split_dimension];
+                   });
+
+  // children are appended later, so node references need to be refreshed after recursion
+  nodes_[node_id].split_dimension = split_dimension;
+  nodes_[node_id].split_value = rows[ids_[median] * stride + split_dimension];
+  const std::size_t left = buildNode(rows, stride, begin, median);
+  const std::size_t right = buildNode(rows, stride, median, end);
+  nodes_[node_id].children[0] = left;
+  nodes_[node_id].children[1] = right;
+  return node_id;
+}
+
+template <class T>
+void RoadmapIndex<T>::findClosest(const T& item, std::vector<std::size_t>& result_ids,
+                                  std::vector<float>& result_distances, const std::size_t max_results,
+                                  const float& distance_threshold) const
+{
+  result_ids.clear();
+  result_distances.clear();
+  if (nodes_.empty() || max_results == 0 || distance_threshold <= 0.0 ||
+      getIndexDimension(item, item.size()) != dimension_)
+    return;
+
+  ClosestItemSelector selector(max_results, distance_threshold);
+  std::vector<float> leaf_distances(leaf_size_);
+  searchNode(0, item, selector, leaf_distances);
+  selector.getResults(result_ids, result_distances);
+}
+
+template <class T>
+void RoadmapIndex<T>::findClosestLinear(const T& item, std::vector<std::size_t>& result_ids,
+                                        std::vector<float>& result_distances, const std::size_t max_results,
+                                        const float& distance_threshold) const
+{
+  result_ids.clear();
+  result_distances.clear();
+  if (ids_.empty() || max_results == 0 || distance_threshold <= 0.0 ||
+      getIndexDimension(item, item.size()) != dimension_)
+    return;
+
+  // items are visited in KD-tree order, the result doesn't depend on the order since ties are ordered by index
+  ClosestItemSelector selector(max_results, distance_threshold);
+  std::vector<float> batch_distances(std::min(LINEAR_SEARCH_BATCH_SIZE, ids_.size()));
+  for (std::size_t begin = 0; begin < ids_.size(); begin += LINEAR_SEARCH_BATCH_SIZE)
+  {
+    const std::size_t count = std::min(LINEAR_SEARCH_BATCH_SIZE, ids_.size() - begin);
+    computeLeafDistances(item, coordinates_.data() + begin, ids_.size(), count, batch_distances.data());
+    selector.add(ids_.data() + begin, batch_distances.data(), count);
+  }
+  selector.getResults(result_ids, result_distances);
+}
+
+template <class T>
+void RoadmapIndex<T>::searchNode(std::size_t node_id, const T& item, ClosestItemSelector& selector,
+                                 std::vector<float>& leaf_distances) const
+{
+  const Node& node = nodes_[node_id];
+  if (node.children[0] == 0)
+  {
+    // leaf, compute distances of all items in one batch
+    const std::size_t count = node.end - node.begin;
+    computeLeafDistances(item, coordinates_.data() + node.begin, ids_.size(), count, leaf_distances.data());
+    selector.add(ids_.data() + node.begin, leaf_distances.data(), count);
+    return;
+  }
+
+  // search the side of the query item first, then the other side if it can contain closer items
+  const float split_distance = item[node.split_dimension] - node.split_value;
+  const std::size_t near_side = split_distance < 0.0 ? 0 : 1;
+  searchNode(node.children[near_side], item, selector, leaf_distances);
+  if (std::abs(split_distance) <= selector.getMaxDistance() * (1.0 + PRUNING_TOLERANCE))
+    searchNode(node.children[1 - near_side], item, selector, leaf_distances);
+}
+
+template class RoadmapIndex<rtr::Config>;
+template class RoadmapIndex<rtr::ToolPose>;
+}  // namespace rtr_moveit
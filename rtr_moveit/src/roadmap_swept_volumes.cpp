@@ -0,0 +1,462 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Precomputed swept voxels of roadmap edges for collision checking roadmaps without the MPA
+ */
+
+#include <rtr_moveit/roadmap_swept_volumes.h>
+
+// C++
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+// ROS
+#include <eigen_conversions/eigen_msg.h>
+#include <ros/console.h>
+
+// rtr_moveit
+#include <rtr_moveit/occupancy_grid.h>
+#include <rtr_moveit/voxelization.h>
+
+namespace rtr_moveit
+{
+static const std::string LOGNAME = "roadmap_swept_volumes";
+
+namespace
+{
+const char ROADMAP_SWEPT_VOLUMES_MAGIC[8] = { 'R', 'T', 'R', 'S', 'W', 'E', 'P', '\0' };
+const uint32_t ROADMAP_SWEPT_VOLUMES_VERSION = 1;
+
+// Swept volumes file layout: header, volume frame, edge offsets, voxel ranges
+struct RoadmapSweptVolumesHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t frame_size;
+  uint64_t source_size;
+  int64_t source_modification_time;
+  uint64_t fingerprint;
+  uint64_t num_edges;
+  uint64_t num_ranges;
+  // volume region position x/y/z and orientation x/y/z/w, dimension and voxel resolution
+  double volume_pose[7];
+  float volume_dimension[3];
+  uint16_t volume_resolution[3];
+  uint16_t reserved;
+};
+
+void hashCombine(uint64_t& hash, uint64_t value)
+{
+  hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+}
+
+void hashCombine(uint64_t& hash, double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  hashCombine(hash, bits);
+}
+
+void hashCombine(uint64_t& hash, const std::string& value)
+{
+  // FNV-1a, the hash needs to be the same in every process using the file
+  uint64_t string_hash = 14695981039346656037ull;
+  for (char c : value)
+    string_hash = (string_hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+  hashCombine(hash, string_hash);
+}
+
+template <typename Transform>
+void hashCombine(uint64_t& hash, const Transform& transform)
+{
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 4; ++j)
+      hashCombine(hash, double(transform.matrix()(i, j)));
+}
+
+// Returns the pose of the volume origin corner in the model frame, the volume frame must not move with the group
+bool getModelToVolume(const robot_state::RobotState& default_state, const robot_model::JointModelGroup& group,
+                      const RoadmapVolume& volume, Eigen::Isometry3d& model_to_volume)
+{
+  const std::string& frame = volume.pose.header.frame_id;
+  const robot_model::RobotModel& robot_model = *default_state.getRobotModel();
+  Eigen::Isometry3d model_to_frame = Eigen::Isometry3d::Identity();
+  if (!frame.empty() && frame != robot_model.getModelFrame())
+  {
+    if (!robot_model.hasLinkModel(frame) || group.hasLinkModel(frame))
+      return false;
+    model_to_frame = Eigen::Isometry3d(default_state.getGlobalLinkTransform(frame).matrix());
+  }
+  Eigen::Isometry3d frame_to_volume;
+  tf::poseMsgToEigen(volume.pose.pose, frame_to_volume);
+  model_to_volume = model_to_frame * frame_to_volume;
+  return true;
+}
+
+std::size_t getNumThreads(std::size_t num_threads)
+{
+  return num_threads > 0 ? num_threads : std::max(1u, std::thread::hardware_concurrency());
+}
+}  // namespace
+
+bool RoadmapSweptVolumes::build(const RoadmapData& roadmap_data, const robot_state::RobotState& default_state,
+                                const std::string& group_name, double max_step, std::size_t num_threads)
+{
+  volume_ = roadmap_data.spec.volume;
+  fingerprint_ = getFingerprint(default_state, group_name, max_step);
+  edge_offsets_.assign(1, 0);
+  voxel_ranges_.clear();
+
+  const robot_model::JointModelGroup* group = default_state.getJointModelGroup(group_name);
+  if (!group)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unknown planning group '" << group_name << "'");
+    return false;
+  }
+  std::vector<const robot_model::JointModel*> joint_models;
+  for (const std::string& joint_name : group->getActiveJointModelNames())
+    joint_models.push_back(group->getJointModel(joint_name));
+  if (joint_models.size() != roadmap_data.dimension)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap dimension " << roadmap_data.dimension << " doesn't match the "
+                                                         << joint_models.size() << " joints of group " << group_name);
+    return false;
+  }
+  const std::array<uint16_t, 3>& resolution = volume_.voxel_resolution;
+  if (uint64_t(resolution[0]) * resolution[1] * resolution[2] > std::numeric_limits<uint32_t>::max())
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Voxel resolution of the roadmap volume is too large");
+    return false;
+  }
+  Eigen::Isometry3d model_to_volume;
+  if (!getModelToVolume(default_state, *group, volume_, model_to_volume))
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Volume frame '" << volume_.pose.header.frame_id
+                                                     << "' is not a static frame of the robot model");
+    return false;
+  }
+  const Eigen::Isometry3d volume_to_model = model_to_volume.inverse();
+  const std::vector<const robot_model::LinkModel*>& links = group->getUpdatedLinkModelsWithGeometry();
+  const bool use_group_positions = group->getVariableCount() == joint_models.size();
+  const ShapeVoxelizer voxelizer(volume_);
+
+  // voxelize the link geometries of interpolated states along all edges in parallel
+  std::vector<std::vector<uint32_t>> edge_ranges(roadmap_data.num_edges);
+  std::atomic<std::size_t> next_edge(0);
+  auto sweep_edges = [&]() {
+    robot_state::RobotState state(default_state);
+    std::vector<double> positions(roadmap_data.dimension);
+    std::vector<rtr::Voxel> voxels;
+    std::vector<uint32_t> indices;
+    for (std::size_t edge_id = next_edge++; edge_id < roadmap_data.num_edges; edge_id = next_edge++)
+    {
+      const float* start = roadmap_data.getConfig(roadmap_data.getEdgeStart(edge_id));
+      const float* end = roadmap_data.getConfig(roadmap_data.getEdgeEnd(edge_id));
+      double distance = 0.0;
+      for (std::size_t i = 0; i < roadmap_data.dimension; ++i)
+        distance += std::abs(end[i] - start[i]);
+      const std::size_t steps = std::max(1.0, std::ceil(distance / max_step));
+
+      voxels.clear();
+      for (std::size_t step = 0; step <= steps; ++step)
+      {
+        const double t = double(step) / steps;
+        for (std::size_t i = 0; i < roadmap_data.dimension; ++i)
+          positions[i] = start[i] + t * (end[i] - start[i]);
+        if (use_group_positions)
+        {
+          state.setJointGroupPositions(group, positions);
+        }
+        else
+        {
+          for (std::size_t i = 0; i < joint_models.size(); ++i)
+            state.setJointPositions(joint_models[i], &positions[i]);
+        }
+        state.update();
+        for (const robot_model::LinkModel* link : links)
+          for (std::size_t k = 0; k < link->getShapes().size(); ++k)
+            voxelizer.voxelizeShape(*link->getShapes()[k], volume_to_model * state.getCollisionBodyTransform(link, k),
+                                    voxels);
+      }
+
+      // store sorted voxel indices as ranges of consecutive indices, sweeps are mostly contiguous along Z
+      indices.clear();
+      for (const rtr::Voxel& voxel : voxels)
+        indices.push_back((uint32_t(voxel.x) * resolution[1] + voxel.y) * resolution[2] + voxel.z);
+      std::sort(indices.begin(), indices.end());
+      indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+      std::vector<uint32_t>& ranges = edge_ranges[edge_id];
+      for (uint32_t index : indices)
+      {
+        if (!ranges.empty() && ranges.back() == index)
+        {
+          ++ranges.back();
+        }
+        else
+        {
+          ranges.push_back(index);
+          ranges.push_back(index + 1);
+        }
+      }
+    }
+  };
+  num_threads = std::min(getNumThreads(num_threads), std::max<std::size_t>(1, roadmap_data.num_edges));
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(sweep_edges);
+  sweep_edges();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // flatten the ranges of all edges
+  edge_offsets_.reserve(roadmap_data.num_edges + 1);
+  for (const std::vector<uint32_t>& ranges : edge_ranges)
+  {
+    voxel_ranges_.insert(voxel_ranges_.end(), ranges.begin(), ranges.end());
+    edge_offsets_.push_back(voxel_ranges_.size() / 2);
+  }
+  return true;
+}
+
+bool RoadmapSweptVolumes::checkScene(const OccupancyData& occupancy_data, std::vector<uint8_t>& collisions,
+                                     std::size_t num_threads) const
+{
+  // collect the occupancy in a grid of the volume region
+  OccupancyGrid voxel_grid;
+  const OccupancyGrid* grid = &voxel_grid;
+  if (occupancy_data.type == OccupancyData::Type::GRID)
+  {
+    if (occupancy_data.grid.getResolution() != volume_.voxel_resolution)
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Occupancy grid resolution doesn't match the roadmap volume");
+      return false;
+    }
+    grid = &occupancy_data.grid;
+  }
+  else if (occupancy_data.type == OccupancyData::Type::VOXELS)
+  {
+    voxel_grid.resize(volume_.voxel_resolution);
+    voxel_grid.setOccupied(occupancy_data.voxels);
+  }
+  else if (occupancy_data.type == OccupancyData::Type::POINT_CLOUD && occupancy_data.point_cloud)
+  {
+    // point clouds are transformed into the volume frame, points outside of the volume are dropped
+    voxel_grid.resize(volume_.voxel_resolution);
+    Eigen::Isometry3d frame_to_volume;
+    tf::poseMsgToEigen(volume_.pose.pose, frame_to_volume);
+    const Eigen::Isometry3d volume_to_frame = frame_to_volume.inverse();
+    for (const pcl::PointXYZ& point : occupancy_data.point_cloud->points)
+    {
+      const Eigen::Vector3d position = volume_to_frame * Eigen::Vector3d(point.x, point.y, point.z);
+      std::array<uint16_t, 3> voxel;
+      bool is_inside = true;
+      for (std::size_t i = 0; i < 3 && is_inside; ++i)
+      {
+        const double index = std::floor(position[i] / volume_.dimension[i] * volume_.voxel_resolution[i]);
+        is_inside = index >= 0.0 && index < volume_.voxel_resolution[i];
+        voxel[i] = is_inside ? index : 0;
+      }
+      if (is_inside)
+        voxel_grid.setOccupied(voxel[0], voxel[1], voxel[2]);
+    }
+  }
+  else
+  {
+    ROS_ERROR_NAMED(LOGNAME, "No valid occupancy data for checking the roadmap");
+    return false;
+  }
+
+  // test the swept voxels of all edges in parallel
+  const std::size_t num_edges = getNumEdges();
+  collisions.assign(num_edges, 0);
+  std::atomic<std::size_t> next_block(0);
+  const std::size_t block_size = 1024;
+  auto check_edges = [&]() {
+    for (std::size_t begin = block_size * next_block++; begin < num_edges; begin = block_size * next_block++)
+    {
+      for (std::size_t edge_id = begin; edge_id < std::min(begin + block_size, num_edges); ++edge_id)
+      {
+        for (std::size_t range = edge_offsets_[edge_id]; range < edge_offsets_[edge_id + 1]; ++range)
+        {
+          if (grid->isAnyOccupied(voxel_ranges_[2 * range], voxel_ranges_[2 * range + 1]))
+          {
+            collisions[edge_id] = 1;
+            break;
+          }
+        }
+      }
+    }
+  };
+  num_threads = std::min(getNumThreads(num_threads), num_edges / block_size + 1);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(check_edges);
+  check_edges();
+  for (std::thread& thread : threads)
+    thread.join();
+  return true;
+}
+
+uint64_t RoadmapSweptVolumes::getFingerprint(const robot_state::RobotState& default_state,
+                                             const std::string& group_name, double max_step)
+{
+  uint64_t hash = ROADMAP_SWEPT_VOLUMES_VERSION;
+  const robot_model::RobotModel& robot_model = *default_state.getRobotModel();
+  hashCombine(hash, robot_model.getName());
+  hashCombine(hash, group_name);
+  hashCombine(hash, max_step);
+
+  // joint values of the default state and the collision geometry of the group links
+  for (std::size_t i = 0; i < robot_model.getVariableCount(); ++i)
+    hashCombine(hash, default_state.getVariablePosition(i));
+  const robot_model::JointModelGroup* group = default_state.getJointModelGroup(group_name);
+  if (!group)
+    return hash;
+  for (const robot_model::LinkModel* link : group->getUpdatedLinkModelsWithGeometry())
+  {
+    hashCombine(hash, link->getName());
+    const std::vector<shapes::ShapeConstPtr>& shapes = link->getShapes();
+    for (std::size_t k = 0; k < shapes.size(); ++k)
+    {
+      hashCombine(hash, uint64_t(shapes[k]->type));
+      hashCombine(hash, link->getCollisionOriginTransforms()[k]);
+      double dimensions[3] = { 0.0, 0.0, 0.0 };
+      if (shapes[k]->type == shapes::BOX)
+        std::memcpy(dimensions, static_cast<const shapes::Box&>(*shapes[k]).size, sizeof(dimensions));
+      else if (shapes[k]->type == shapes::SPHERE)
+        dimensions[0] = static_cast<const shapes::Sphere&>(*shapes[k]).radius;
+      else if (shapes[k]->type == shapes::CYLINDER)
+      {
+        dimensions[0] = static_cast<const shapes::Cylinder&>(*shapes[k]).radius;
+        dimensions[1] = static_cast<const shapes::Cylinder&>(*shapes[k]).length;
+      }
+      else if (shapes[k]->type == shapes::MESH)
+        dimensions[0] = static_cast<const shapes::Mesh&>(*shapes[k]).vertex_count;
+      for (double dimension : dimensions)
+        hashCombine(hash, dimension);
+    }
+  }
+  return hash;
+}
+
+void RoadmapSweptVolumes::getEdgeVoxelRanges(std::size_t edge_id,
+                                             std::vector<std::pair<uint32_t, uint32_t>>& ranges) const
+{
+  ranges.clear();
+  for (std::size_t range = edge_offsets_[edge_id]; range < edge_offsets_[edge_id + 1]; ++range)
+    ranges.emplace_back(voxel_ranges_[2 * range], voxel_ranges_[2 * range + 1]);
+}
+
+void RoadmapSweptVolumes::serialize(const RoadmapFileStamp& stamp, std::vector<char>& buffer) const
+{
+  RoadmapSweptVolumesHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, ROADMAP_SWEPT_VOLUMES_MAGIC, sizeof(header.magic));
+  header.version = ROADMAP_SWEPT_VOLUMES_VERSION;
+  header.source_size = stamp.size;
+  header.source_modification_time = stamp.modification_time;
+  header.fingerprint = fingerprint_;
+  header.num_edges = getNumEdges();
+  header.num_ranges = voxel_ranges_.size() / 2;
+  const geometry_msgs::Pose& pose = volume_.pose.pose;
+  const double volume_pose[7] = { pose.position.x,    pose.position.y,    pose.position.z,   pose.orientation.x,
+                                  pose.orientation.y, pose.orientation.z, pose.orientation.w };
+  std::memcpy(header.volume_pose, volume_pose, sizeof(volume_pose));
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    header.volume_dimension[i] = volume_.dimension[i];
+    header.volume_resolution[i] = volume_.voxel_resolution[i];
+  }
+  header.frame_size = volume_.pose.header.frame_id.size();
+
+  buffer.clear();
+  auto append = [&buffer](const void* data, std::size_t size) {
+    buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + size);
+  };
+  append(&header, sizeof(header));
+  append(volume_.pose.header.frame_id.data(), volume_.pose.header.frame_id.size());
+  append(edge_offsets_.data(), edge_offsets_.size() * sizeof(uint64_t));
+  append(voxel_ranges_.data(), voxel_ranges_.size() * sizeof(uint32_t));
+}
+
+bool RoadmapSweptVolumes::deserialize(const char* data, std::size_t size, const RoadmapFileStamp& stamp,
+                                      uint64_t fingerprint)
+{
+  RoadmapSweptVolumesHeader header;
+  if (size < sizeof(header))
+    return false;
+  std::memcpy(&header, data, sizeof(header));
+  if (std::memcmp(header.magic, ROADMAP_SWEPT_VOLUMES_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != ROADMAP_SWEPT_VOLUMES_VERSION || header.source_size != stamp.size ||
+      header.source_modification_time != stamp.modification_time || header.fingerprint != fingerprint)
+    return false;
+  if (size != sizeof(header) + header.frame_size + (header.num_edges + 1) * sizeof(uint64_t) +
+                  2 * header.num_ranges * sizeof(uint32_t))
+    return false;
+
+  const char* position = data + sizeof(header);
+  RoadmapVolume volume;
+  volume.pose.header.frame_id.assign(position, header.frame_size);
+  position += header.frame_size;
+  geometry_msgs::Pose& pose = volume.pose.pose;
+  pose.position.x = header.volume_pose[0];
+  pose.position.y = header.volume_pose[1];
+  pose.position.z = header.volume_pose[2];
+  pose.orientation.x = header.volume_pose[3];
+  pose.orientation.y = header.volume_pose[4];
+  pose.orientation.z = header.volume_pose[5];
+  pose.orientation.w = header.volume_pose[6];
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    volume.dimension[i] = header.volume_dimension[i];
+    volume.voxel_resolution[i] = header.volume_resolution[i];
+  }
+  edge_offsets_.resize(header.num_edges + 1);
+  std::memcpy(edge_offsets_.data(), position, edge_offsets_.size() * sizeof(uint64_t));
+  position += edge_offsets_.size() * sizeof(uint64_t);
+  voxel_ranges_.resize(2 * header.num_ranges);
+  std::memcpy(voxel_ranges_.data(), position, voxel_ranges_.size() * sizeof(uint32_t));
+  if (edge_offsets_.front() != 0 || edge_offsets_.back() != header.num_ranges ||
+      !std::is_sorted(edge_offsets_.begin(), edge_offsets_.end()))
+    return false;
+  volume_ = volume;
+  fingerprint_ = fingerprint;
+  return true;
+}
+}  // namespace rtr_moveit
@@ -37,6 +37,7 @@
  */
 
 #include <rtr_moveit/roadmap_visualization.h>
+#include <visualization_msgs/MarkerArray.h>
 
 namespace rtr_moveit
 {
@@ -56,10 +57,40 @@ RoadmapVisualization::RoadmapVisualization(const ros::NodeHandle& nh) : nh_(nh)
     ROS_WARN_NAMED(LOGNAME, "Invalid negative value in parameter visualization_marker_lifetime. Using default: 0.0");
     marker_lifetime_ = 0.0;
   }
+  int decimation = nh_.param("planner_config/visualization_decimation", 1);
+  if (decimation < 1)
+  {
+    ROS_WARN_NAMED(LOGNAME, "Invalid value in parameter visualization_decimation. Using default: 1");
+    decimation = 1;
+  }
+  decimation_ = decimation;
+  double max_rate = nh_.param("planner_config/visualization_max_rate", 0.0);
+  if (max_rate < 0.0)
+  {
+    ROS_WARN_NAMED(LOGNAME, "Invalid negative value in parameter visualization_max_rate. Using default: 0.0");
+    max_rate = 0.0;
+  }
+  min_publish_period_ = std::chrono::duration<double>(max_rate > 0.0 ? 1.0 / max_rate : 0.0);
+
   std::string marker_topic =
       nh_.param<std::string>("planner_config/visualization_marker_topic", "/rapidplan_visualization_markers");
   marker_pub_ = nh_.advertise<visualization_msgs::Marker>(marker_topic, 5, false);
   ROS_INFO_STREAM_NAMED(LOGNAME, "Publishing visualization markers to topic: " << marker_topic);
+  std::string roadmap_topic =
+      nh_.param<std::string>("planner_config/visualization_roadmap_topic", "/rapidplan_roadmap_markers");
+  roadmap_pub_ = nh_.advertise<visualization_msgs::MarkerArray>(roadmap_topic, 1, true);
+  ROS_INFO_STREAM_NAMED(LOGNAME, "Publishing latched roadmap markers to topic: " << roadmap_topic);
+}
+
+RoadmapVisualization::~RoadmapVisualization()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  condition_.notify_all();
+  if (publisher_thread_.joinable())
+    publisher_thread_.join();
 }
 
 void RoadmapVisualization::visualizeRoadmap(const std::string& frame_id, const geometry_msgs::Pose& marker_pose,
@@ -68,6 +99,8 @@ void RoadmapVisualization::visualizeRoadmap(const std::string& frame_id, const g
 {
   if (!state_positions.empty())
   {
+    // the roadmap is latched and only published once, so markers must not expire
+    visualization_msgs::MarkerArray roadmap_markers;
     visualization_msgs::Marker roadmap_states;
     roadmap_states.header.frame_id = frame_id;
     roadmap_states.header.stamp = ros::Time::now();
@@ -76,7 +109,8 @@ void RoadmapVisualization::visualizeRoadmap(const std::string& frame_id, const g
     roadmap_states.scale.x = 0.005;
     roadmap_states.scale.y = 0.005;
     roadmap_states.scale.z = 0.005;
-    roadmap_states.points = state_positions;
+    for (std::size_t i = 0; i < state_positions.size(); i += decimation_)
+      roadmap_states.points.push_back(state_positions[i]);
     roadmap_states.action = visualization_msgs::Marker::ADD;
     roadmap_states.pose = marker_pose;
     // States are gray
@@ -84,8 +118,7 @@ void RoadmapVisualization::visualizeRoadmap(const std::string& frame_id, const g
     roadmap_states.color.r = 0.6;
     roadmap_states.color.g = 0.6;
     roadmap_states.color.b = 0.6;
-    roadmap_states.lifetime = ros::Duration(marker_lifetime_);
-    marker_pub_.publish(roadmap_states);
+    roadmap_markers.markers.push_back(roadmap_states);
 
     if (!state_edges.empty())
     {
@@ -95,15 +128,19 @@ void RoadmapVisualization::visualizeRoadmap(const std::string& frame_id, const g
       roadmap_edges.id = ROADMAP_EDGES_ID;
       roadmap_edges.type = visualization_msgs::Marker::LINE_LIST;
       roadmap_edges.scale.x = 0.0005;
-      roadmap_edges.points = state_edges;
+      for (std::size_t i = 0; i + 1 < state_edges.size(); i += 2 * decimation_)
+      {
+        roadmap_edges.points.push_back(state_edges[i]);
+        roadmap_edges.points.push_back(state_edges[i + 1]);
+      }
       roadmap_edges.action = visualization_msgs::Marker::ADD;
       roadmap_edges.pose = marker_pose;
       // State edges are green
       roadmap_edges.color.a = 0.9;
       roadmap_edges.color.g = 0.6;
-      roadmap_edges.lifetime = ros::Duration(marker_lifetime_);
-      marker_pub_.publish(roadmap_edges);
+      roadmap_markers.markers.push_back(roadmap_edges);
     }
+    roadmap_pub_.publish(roadmap_markers);
   }
 }
 
@@ -153,12 +190,17 @@ void RoadmapVisualization::visualizeVolumeRegion(const RoadmapVolume& volume)
 
 void RoadmapVisualization::visualizeOccupancy(const RoadmapVolume& volume, const OccupancyData& occupancy_data)
 {
-  if (occupancy_data.type != OccupancyData::Type::VOXELS)
+  if (occupancy_data.type != OccupancyData::Type::VOXELS && occupancy_data.type != OccupancyData::Type::GRID)
   {
-    ROS_ERROR("Unable to visualize occupancy data other than VOXELS");
+    ROS_ERROR("Unable to visualize occupancy data other than VOXELS or GRID");
     return;
   }
-  if (!occupancy_data.voxels.empty())
+  std::vector<rtr::Voxel> grid_voxels;
+  if (occupancy_data.type == OccupancyData::Type::GRID)
+    occupancy_data.grid.toVoxels(grid_voxels);
+  const std::vector<rtr::Voxel>& occupancy_voxels =
+      occupancy_data.type == OccupancyData::Type::GRID ? grid_voxels : occupancy_data.voxels;
+  if (!occupancy_voxels.empty())
   {
     // visualize voxels
     visualization_msgs::Marker voxels;
@@ -178,14 +220,104 @@ void RoadmapVisualization::visualizeOccupancy(const RoadmapVolume& volume, const
     voxels.scale.z = volume.dimension[2] / volume.voxel_resolution[2];
 
     // generate voxel points in reference to volume region origin pose
-    voxels.points.resize(occupancy_data.voxels.size());
+    voxels.points.resize((occupancy_voxels.size() + decimation_ - 1) / decimation_);
     for (std::size_t i = 0; i < voxels.points.size(); i++)
     {
-      voxels.points[i].x = (occupancy_data.voxels[i].x + 0.5) * voxels.scale.x;
-      voxels.points[i].y = (occupancy_data.voxels[i].y + 0.5) * voxels.scale.y;
-      voxels.points[i].z = (occupancy_data.voxels[i].z + 0.5) * voxels.scale.z;
+      const rtr::Voxel& voxel = occupancy_voxels[i * decimation_];
+      voxels.points[i].x = (voxel.x + 0.5) * voxels.scale.x;
+      voxels.points[i].y = (voxel.y + 0.5) * voxels.scale.y;
+      voxels.points[i].z = (voxel.z + 0.5) * voxels.scale.z;
     }
     marker_pub_.publish(voxels);
   }
 }
+
+void RoadmapVisualization::visualizePlanContext(const RoadmapDataConstPtr& roadmap_data,
+                                                const OccupancyData& occupancy_data,
+                                                const std::deque<std::size_t>& waypoint_ids, bool plan_success)
+{
+  // copy the plan data while the planning thread continues, the roadmap data is shared
+  std::unique_ptr<PlanVisualization> plan(new PlanVisualization());
+  plan->roadmap_data = roadmap_data;
+  plan->occupancy_data = occupancy_data;
+  plan->waypoint_ids = waypoint_ids;
+  plan->plan_success = plan_success;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_plan_ = std::move(plan);
+    if (!publisher_thread_.joinable())
+      publisher_thread_ = std::thread(&RoadmapVisualization::publishPlanVisualizations, this);
+  }
+  condition_.notify_all();
+}
+
+void RoadmapVisualization::publishPlanVisualizations()
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true)
+  {
+    condition_.wait(lock, [this]() { return stopped_ || pending_plan_; });
+    // wait for the publish period, newer plans replace the pending one meanwhile
+    if (stopped_ ||
+        condition_.wait_until(lock, last_publish_time_ + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                             min_publish_period_),
+                              [this]() { return stopped_; }))
+      return;
+    std::unique_ptr<PlanVisualization> plan = std::move(pending_plan_);
+    lock.unlock();
+    publishPlanVisualization(*plan);
+    last_publish_time_ = std::chrono::steady_clock::now();
+    lock.lock();
+  }
+}
+
+void RoadmapVisualization::publishPlanVisualization(const PlanVisualization& plan)
+{
+  const RoadmapData& roadmap_data = *plan.roadmap_data;
+  const RoadmapSpecification& roadmap = roadmap_data.spec;
+
+  // visualize volume region
+  visualizeVolumeRegion(roadmap.volume);
+
+  // visualize voxels
+  // TODO(henningkayser): visualize all kinds of occupancy data
+  if (plan.occupancy_data.type == OccupancyData::Type::VOXELS)
+    visualizeOccupancy(roadmap.volume, plan.occupancy_data);
+
+  auto getPosition = [&roadmap_data](std::size_t state_id) {
+    const float* pose = roadmap_data.getPose(state_id);
+    geometry_msgs::Point position;
+    position.x = pose[0];
+    position.y = pose[1];
+    position.z = pose[2];
+    return position;
+  };
+  geometry_msgs::Pose pose;
+  pose.orientation.w = 1.0;
+
+  // roadmap states and edges are only published if the roadmap changed
+  if (published_roadmap_.lock() != plan.roadmap_data)
+  {
+    std::vector<geometry_msgs::Point> positions(roadmap_data.num_states);
+    for (std::size_t i = 0; i < roadmap_data.num_states; ++i)
+      positions[i] = getPosition(i);
+    std::vector<geometry_msgs::Point> edges(2 * roadmap_data.num_edges);
+    for (std::size_t i = 0; i < roadmap_data.num_edges; ++i)
+    {
+      edges[2 * i] = positions[roadmap_data.getEdgeStart(i)];
+      edges[2 * i + 1] = positions[roadmap_data.getEdgeEnd(i)];
+    }
+    visualizeRoadmap(roadmap.base_link_frame, pose, positions, edges);
+    published_roadmap_ = plan.roadmap_data;
+  }
+
+  // visualize solution
+  if (plan.plan_success)
+  {
+    std::vector<geometry_msgs::Point> solution_positions(plan.waypoint_ids.size());
+    for (std::size_t i = 0; i < plan.waypoint_ids.size(); ++i)
+      solution_positions[i] = getPosition(plan.waypoint_ids[i]);
+    visualizeSolutionPath(roadmap.base_link_frame, pose, solution_positions);
+  }
+}
 }
@@ -37,12 +37,16 @@
  */
 
 // C++
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <deque>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <sstream>
 #include <mutex>
+#include <thread>
 
 // ROS
 #include <ros/console.h>
@@ -55,13 +59,123 @@
 namespace rtr_moveit
 {
 static const std::string LOGNAME = "rtr_planner_interface";
+// minimum time between initialization attempts of failed MPAs if the background health checks are disabled
+static const std::chrono::seconds MPA_RETRY_INTERVAL(1);
+
+namespace
+{
+std::unique_ptr<rtr::PathPlanner> loadPathPlanner(const std::string& og_file)
+{
+  ROS_INFO_STREAM_NAMED(LOGNAME, "Loading roadmap: " << og_file);
+  std::unique_ptr<rtr::PathPlanner> planner(new rtr::PathPlanner());
+  if (!planner->LoadRoadmap(og_file))
+    return nullptr;
+
+  // set edge cost as simple joint distance - TODO(RTR-55): use weighted distance?
+  planner->SetEdgeCost(&getConfigDistance);
+  return planner;
+}
+
+bool isSameVoxel(const rtr::Voxel& a, const rtr::Voxel& b)
+{
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+// hash of voxel or grid occupancy data, returns false if the data can't be fingerprinted
+bool getOccupancyFingerprint(const OccupancyData& occupancy_data, std::size_t& fingerprint)
+{
+  if (occupancy_data.type == OccupancyData::Type::GRID)
+  {
+    fingerprint = occupancy_data.grid.hash();
+    return true;
+  }
+  if (occupancy_data.type == OccupancyData::Type::VOXELS)
+  {
+    uint64_t hash = occupancy_data.voxels.size();
+    for (const rtr::Voxel& voxel : occupancy_data.voxels)
+    {
+      const uint64_t value = (uint64_t(voxel.x) << 32) | (uint64_t(voxel.y) << 16) | voxel.z;
+      hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    }
+    fingerprint = hash;
+    return true;
+  }
+  return false;
+}
+}  // namespace
 
 RTRPlannerInterface::RTRPlannerInterface(const ros::NodeHandle& nh) : nh_(nh)
 {
   // Check if RapidPlan hardware should be used for collision checking
   rapidplan_interface_enabled_ = nh_.param("planner_config/rapidplan_interface_enabled", false);
-  if (!rapidplan_interface_enabled_)
-    ROS_WARN_NAMED(LOGNAME, "RapidPlanInterface is disabled - plans will be computed without collision checks");
+  software_collision_checks_ = nh_.param("planner_config/software_collision_checks", true);
+  if (!rapidplan_interface_enabled_ && !software_collision_checks_)
+    ROS_WARN_NAMED(LOGNAME, "RapidPlanInterface and software collision checks are disabled - roadmaps are planned "
+                            "without collision checks");
+
+  // number of roadmaps that are kept loaded in PathPlanners and on the MPA
+  int max_resident_roadmaps = nh_.param("planner_config/max_resident_roadmaps", 4);
+  if (max_resident_roadmaps < 1)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Invalid value " << max_resident_roadmaps
+                                                    << " for 'max_resident_roadmaps'. Proceeding with 1.");
+    max_resident_roadmaps = 1;
+  }
+  max_resident_roadmaps_ = max_resident_roadmaps;
+
+  // every PathPlanner of a roadmap holds a complete copy of the roadmap, a single planner serializes graph searches
+  int path_planners_per_roadmap = nh_.param("planner_config/path_planners_per_roadmap", 1);
+  if (path_planners_per_roadmap < 1)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Invalid value " << path_planners_per_roadmap
+                                                    << " for 'path_planners_per_roadmap'. Proceeding with 1.");
+    path_planners_per_roadmap = 1;
+  }
+  path_planners_per_roadmap_ = path_planners_per_roadmap;
+
+  // number of collision check results that are reused for unchanged occupancy data
+  int collision_cache_size = nh_.param("planner_config/collision_cache_size", 8);
+  if (collision_cache_size < 0)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Invalid value " << collision_cache_size
+                                                    << " for 'collision_cache_size'. Proceeding with 0.");
+    collision_cache_size = 0;
+  }
+  collision_cache_size_ = collision_cache_size;
+
+  // MPAs of the device pool, every MPAInterface instance connects to its own device
+  int mpa_devices = nh_.param("planner_config/mpa_devices", 1);
+  if (mpa_devices < 1)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Invalid value " << mpa_devices << " for 'mpa_devices'. Proceeding with 1.");
+    mpa_devices = 1;
+  }
+  if (rapidplan_interface_enabled_)
+  {
+    for (int i = 0; i < mpa_devices; ++i)
+    {
+      mpa_devices_.emplace_back(new MPADevice());
+      mpa_devices_.back()->device_id = i;
+    }
+  }
+
+  // roadmaps are replicated to all devices by default, smaller values shard the roadmaps
+  int mpa_roadmap_replicas = nh_.param("planner_config/mpa_roadmap_replicas", 0);
+  if (mpa_roadmap_replicas < 1 || mpa_roadmap_replicas > mpa_devices)
+    mpa_roadmap_replicas = mpa_devices;
+  mpa_roadmap_replicas_ = mpa_roadmap_replicas;
+
+  // number of threads for collision checking swept volumes on the CPU, values < 1 use all cores
+  int software_collision_threads = nh_.param("planner_config/software_collision_threads", 0);
+  software_collision_threads_ = std::max(0, software_collision_threads);
+
+  health_check_period_ = nh_.param("planner_config/mpa_health_check_period", 1.0);
+  if (health_check_period_ < 0.0)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Invalid value " << health_check_period_
+                                                    << " for 'mpa_health_check_period'. Proceeding with 1.0.");
+    health_check_period_ = 1.0;
+  }
 
   std::map<std::string, ros::console::levels::Level> loggers;
   if (ros::console::get_loggers(loggers))
@@ -74,61 +188,120 @@ RTRPlannerInterface::RTRPlannerInterface(const ros::NodeHandle& nh) : nh_(nh)
 
 RTRPlannerInterface::~RTRPlannerInterface()
 {
-  // TODO(RTR-52) implement destructor
+  {
+    std::lock_guard<std::mutex> lock(health_check_mutex_);
+    stopped_ = true;
+  }
+  health_check_condition_.notify_all();
+  if (health_check_thread_.joinable())
+    health_check_thread_.join();
 }
 
 bool RTRPlannerInterface::initialize()
 {
   if (rapidplan_interface_enabled_)
   {
-    // check if hardware is connected
-    if (!rapidplan_interface_.Connected())
+    std::size_t num_healthy_devices = 0;
+    for (std::unique_ptr<MPADevice>& device : mpa_devices_)
     {
-      ROS_ERROR_NAMED(LOGNAME, "Unable to initialize RapidPlan interface. Hardware is not connected.");
-      return false;
-    }
-
-    // try to initialize hardware
-    if (!rapidplan_interface_.Init())
-    {
-      ROS_ERROR_NAMED(LOGNAME, "Unable to initialize RapidPlan interface. Failed to initialize Hardware.");
-      return false;
+      if (!device->healthy)
+      {
+        std::lock_guard<std::mutex> device_lock(device->mutex);
+        device->last_initialization = std::chrono::steady_clock::now();
+        device->healthy = initializeDevice(*device);
+      }
+      num_healthy_devices += device->healthy;
     }
-
-    // perform handshake
-    if (!rapidplan_interface_.Handshake())
+    if (num_healthy_devices == 0)
     {
-      ROS_ERROR_NAMED(LOGNAME, "Unable to initialize RapidPlan interface. Handshake failed.");
+      ROS_ERROR_NAMED(LOGNAME, "Unable to initialize RapidPlan interface. No MPA is available.");
       return false;
     }
+    ROS_INFO_STREAM_NAMED(LOGNAME, "Initialized " << num_healthy_devices << " of " << mpa_devices_.size()
+                                                  << " RapidPlan MPAs");
 
-    // clear hardware if  there are still roadmaps stored
-    if (roadmap_indices_.empty())
-    {
-      size_t num_roadmaps;
-      if (!rapidplan_interface_.NumRoadmaps(num_roadmaps))
-      {
-        ROS_ERROR_NAMED(LOGNAME, "Unable to initialize RapidPlan interface. Reading hardware state failed.");
-        return false;
-      }
-      if (unsigned(num_roadmaps) > 0 && !rapidplan_interface_.ClearRoadmaps())
-      {
-        ROS_ERROR_NAMED(LOGNAME, "Unable to initialize RapidPlan interface. Clearing hardware storage failed.");
-        return false;
-      }
-    }
+    // failed devices are initialized again by the health checks
+    std::lock_guard<std::mutex> lock(health_check_mutex_);
+    if (health_check_period_ > 0.0 && !health_check_thread_.joinable())
+      health_check_thread_ = std::thread(&RTRPlannerInterface::runHealthChecks, this);
   }
 
   ROS_INFO_NAMED(LOGNAME, "RapidPlan interface initialized.");
   return true;
 }
 
+bool RTRPlannerInterface::initializeDevice(MPADevice& device) const
+{
+  rtr::MPAInterface& rapidplan_interface = device.interface;
+  // check if hardware is connected
+  if (!rapidplan_interface.Connected())
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to initialize MPA " << device.device_id << ". Hardware is not connected.");
+    return false;
+  }
+
+  // try to initialize hardware
+  if (!rapidplan_interface.Init())
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to initialize MPA " << device.device_id
+                                                                << ". Failed to initialize Hardware.");
+    return false;
+  }
+
+  // perform handshake
+  if (!rapidplan_interface.Handshake())
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to initialize MPA " << device.device_id << ". Handshake failed.");
+    return false;
+  }
+
+  // clear hardware if there are still roadmaps stored, the storage indices are unknown
+  size_t num_roadmaps;
+  if (!rapidplan_interface.NumRoadmaps(num_roadmaps))
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to initialize MPA " << device.device_id
+                                                                << ". Reading hardware state failed.");
+    return false;
+  }
+  device.roadmap_indices.clear();
+  if (unsigned(num_roadmaps) > 0 && !rapidplan_interface.ClearRoadmaps())
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to initialize MPA " << device.device_id
+                                                                << ". Clearing hardware storage failed.");
+    return false;
+  }
+  return true;
+}
+
 bool RTRPlannerInterface::isReady() const
 {
-  // try handshake
-  if (rapidplan_interface_enabled_ && !rapidplan_interface_.Handshake())
+  if (!rapidplan_interface_enabled_)
+    return true;
+
+  // without background health checks the MPAs are queried directly and failed MPAs are initialized again, but not
+  // more often than MPA_RETRY_INTERVAL so that requests don't wait for unavailable hardware every time
+  bool is_ready = false;
+  for (const std::unique_ptr<MPADevice>& device : mpa_devices_)
+  {
+    if (health_check_period_ <= 0.0)
+    {
+      std::lock_guard<std::mutex> device_lock(device->mutex);
+      const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+      if (device->healthy)
+        device->healthy = device->interface.Handshake();
+      else if (now - device->last_initialization >= MPA_RETRY_INTERVAL)
+      {
+        device->last_initialization = now;
+        device->healthy = initializeDevice(*device);
+        if (device->healthy)
+          ROS_INFO_STREAM_NAMED(LOGNAME, "MPA " << device->device_id << " is available again");
+      }
+    }
+    is_ready |= device->healthy;
+  }
+  if (!is_ready)
   {
-    ROS_WARN_NAMED(LOGNAME, "RapidPlan interface is not ready. Handshake failed.");
+    ROS_WARN_NAMED(LOGNAME, "RapidPlan interface is not ready. No healthy MPA available.");
     return false;
   }
 
@@ -136,36 +309,62 @@ bool RTRPlannerInterface::isReady() const
   return true;
 }
 
+void RTRPlannerInterface::runHealthChecks()
+{
+  std::unique_lock<std::mutex> lock(health_check_mutex_);
+  while (!health_check_condition_.wait_for(lock, std::chrono::duration<double>(health_check_period_),
+                                           [this]() { return stopped_; }))
+  {
+    lock.unlock();
+    for (std::unique_ptr<MPADevice>& device : mpa_devices_)
+    {
+      // devices that are busy with collision checks are not interrupted
+      std::unique_lock<std::mutex> device_lock(device->mutex, std::try_to_lock);
+      if (!device_lock.owns_lock())
+        continue;
+      if (device->healthy && !device->interface.Handshake())
+      {
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Handshake with MPA " << device->device_id << " failed");
+        setDeviceFailed(*device);
+      }
+      else if (!device->healthy && initializeDevice(*device))
+      {
+        ROS_INFO_STREAM_NAMED(LOGNAME, "MPA " << device->device_id << " is available again");
+        device->healthy = true;
+      }
+    }
+    lock.lock();
+  }
+}
+
+void RTRPlannerInterface::setDeviceFailed(MPADevice& device)
+{
+  device.healthy = false;
+  if (metrics_)
+    metrics_->increment(PlannerMetrics::MPA_DEVICE_FAILURES);
+}
+
 bool RTRPlannerInterface::solve(const RoadmapSpecification& roadmap_spec, const std::size_t start_state_id,
                                 const RapidPlanGoal& goal, const OccupancyData& occupancy_data, const double& timeout,
                                 std::vector<rtr::Config>& solution_path)
 {
   std::deque<std::size_t> waypoints, edges;
-  std::vector<rtr::Config> roadmap_states;
-  bool success = solve(roadmap_spec, start_state_id, goal, occupancy_data, timeout, roadmap_states, waypoints, edges);
+  bool success = solve(roadmap_spec, start_state_id, goal, occupancy_data, timeout, solution_path, waypoints, edges);
   // TODO(RTR-53): verify waypoints and states? This should already be done in the PathPlanner.
-  if (success)
+  if (success && debug_)
   {
-    // fill solution path
-    for (std::size_t waypoint : waypoints)
-      solution_path.push_back(roadmap_states[waypoint]);
-
-    // debug output
-    if (debug_)
+    ROS_DEBUG_STREAM_NAMED(LOGNAME, "Solution path:");
+    for (std::size_t i = 0; i < waypoints.size(); ++i)
     {
-      ROS_DEBUG_STREAM_NAMED(LOGNAME, "Solution path:");
-      for (std::size_t waypoint : waypoints)
+      std::string waypoint_debug_text = "waypoint ";
+      waypoint_debug_text += std::to_string(waypoints[i]);
+      waypoint_debug_text += ": ";
+      for (float joint_value : solution_path[i])
       {
-        std::string waypoint_debug_text = "waypoint ";
-        waypoint_debug_text += std::to_string(waypoint);
-        waypoint_debug_text += ": ";
-        for (float joint_value : roadmap_states[waypoint])
-        {
-          waypoint_debug_text += std::to_string(joint_value);
-          waypoint_debug_text += " ";
-        }
-        ROS_DEBUG_STREAM_NAMED(LOGNAME, waypoint_debug_text);
+        waypoint_debug_text += std::to_string(joint_value);
+        waypoint_debug_text += " ";
       }
+      ROS_DEBUG_STREAM_NAMED(LOGNAME, waypoint_debug_text);
     }
   }
   return success;
@@ -173,186 +372,638 @@ bool RTRPlannerInterface::solve(const RoadmapSpecification& roadmap_spec, const
 
 bool RTRPlannerInterface::solve(const RoadmapSpecification& roadmap_spec, const std::size_t start_state_id,
                                 const RapidPlanGoal& goal, const OccupancyData& occupancy_data, const double& timeout,
-                                std::vector<rtr::Config>& roadmap_states, std::deque<std::size_t>& waypoints,
+                                std::vector<rtr::Config>& waypoint_configs, std::deque<std::size_t>& waypoints,
                                 std::deque<std::size_t>& edges)
 {
-  {  // SCOPED MUTEX LOCK
-    // In solve() the RapidPlanInterface and PathPlanner are loaded with the same roadmap so that results from
-    // RapidPlanInterface::CheckScene() can be used with PathPlanner::FindPath().
-    // Calling prepareRoadmap() ensures that both are loaded with the same roadmap and the mutex lock prevents race
-    // conditions by restricting write access in the meantime.
-    // All functions that either write or load roadmaps should follow this behavior.
-    std::lock_guard<std::mutex> scoped_lock(mutex_);
-
-    // Load roadmap to PathPlanner and MPA and get roadmap storage index
-    size_t roadmap_index;
-    if (!prepareRoadmap(roadmap_spec, roadmap_index))
-      return false;
+  // Planning runs as a two-stage pipeline. Stage 1 holds the MPA mutex to prepare the roadmap and check collisions,
+  // stage 2 searches the graph with a PathPlanner of the same roadmap that is not shared with any other request.
+  // This way the collision check of one request can overlap with the graph search of another.
+  RoadmapCollisions roadmap_collisions;
+  return checkScene(roadmap_spec, occupancy_data, roadmap_collisions) &&
+         findPath(roadmap_collisions, start_state_id, goal, timeout, waypoint_configs, waypoints, edges);
+}
 
-    // Check collisions using the RapidPlanInterface
-    std::vector<uint8_t> collisions;
-    if (rapidplan_interface_enabled_)
-    {
-      bool check_scene_success = false;
-      if (occupancy_data.type == OccupancyData::Type::POINT_CLOUD)
-        check_scene_success = rapidplan_interface_.CheckScene(occupancy_data.point_cloud, roadmap_index, collisions);
-      else if (occupancy_data.type == OccupancyData::Type::VOXELS)
-        check_scene_success = rapidplan_interface_.CheckScene(occupancy_data.voxels, roadmap_index, collisions);
-      else
-        ROS_WARN_NAMED(LOGNAME, "No type specified in occupancy data");
-
-      if (!check_scene_success)
-      {
-        ROS_ERROR_NAMED(LOGNAME, "HardwareInterface failed to check collision scene.");
-        return false;
-      }
-    }
-    else
+bool RTRPlannerInterface::solveBatch(const RoadmapSpecification& roadmap_spec, const OccupancyData& occupancy_data,
+                                     const std::vector<PlanningQuery>& queries, const double& timeout,
+                                     std::vector<PlanningQueryResult>& results, std::size_t num_threads)
+{
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::microseconds(static_cast<int64_t>(timeout * 1000));
+  results.assign(queries.size(), PlanningQueryResult());
+  RoadmapCollisions roadmap_collisions;
+  if (!checkScene(roadmap_spec, occupancy_data, roadmap_collisions))
+    return false;
+
+  // run graph searches until all queries are processed or the time is up
+  std::atomic<std::size_t> next_query(0);
+  auto process_queries = [&]() {
+    for (std::size_t i = next_query++; i < queries.size(); i = next_query++)
     {
-      ROS_WARN_NAMED(LOGNAME, "RapidPlan called with disabled collision checks");
-      collisions.resize(planner_.GetNumEdges());  // dummy
+      const double remaining_time =
+          std::chrono::duration<double, std::milli>(deadline - std::chrono::steady_clock::now()).count();
+      if (remaining_time <= 0.0)
+        break;
+      PlanningQueryResult& result = results[i];
+      result.success = findPath(roadmap_collisions, queries[i].start_state_id, queries[i].goal, remaining_time,
+                                result.waypoint_configs, result.waypoints, result.edges);
+      for (std::size_t w = 1; result.success && w < result.waypoint_configs.size(); ++w)
+        result.cost += getConfigDistance(result.waypoint_configs[w - 1], result.waypoint_configs[w]);
     }
+  };
+  if (num_threads == 0)
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  num_threads = std::min(num_threads, queries.size());
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < num_threads; ++t)
+    threads.emplace_back(process_queries);
+  process_queries();
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::size_t num_solved =
+      std::count_if(results.begin(), results.end(), [](const PlanningQueryResult& result) { return result.success; });
+  ROS_INFO_STREAM_NAMED(LOGNAME, "RapidPlan solved " << num_solved << " of " << queries.size() << " batch queries");
+  return true;
+}
 
-    // Call PathPlanner
-    int result = -1;
-    if (goal.type == RapidPlanGoal::Type::TOOL_POSE)
+bool RTRPlannerInterface::checkScene(const RoadmapSpecification& roadmap_spec, const OccupancyData& occupancy_data,
+                                     RoadmapCollisions& roadmap_collisions)
+{
+  // CheckScene() only supports voxel lists, so occupancy grids are converted before locking the mutex
+  std::vector<rtr::Voxel> grid_voxels;
+  if (occupancy_data.type == OccupancyData::Type::GRID)
+    occupancy_data.grid.toVoxels(grid_voxels);
+
+  roadmap_collisions.roadmap_id = roadmap_spec.roadmap_id;
+  std::vector<uint8_t>& collisions = roadmap_collisions.collisions;
+  collisions.clear();
+
+  // without the MPA, roadmaps with swept volumes are checked on the CPU
+  RoadmapSweptVolumesConstPtr swept_volumes;
+  if (!rapidplan_interface_enabled_)
+  {
+    std::lock_guard<std::mutex> scoped_lock(mpa_mutex_);
+    auto swept_volumes_search =
+        swept_volumes_.find(std::make_pair(roadmap_spec.group_name, roadmap_spec.roadmap_id));
+    if (swept_volumes_search != swept_volumes_.end())
+      swept_volumes = swept_volumes_search->second;
+  }
+  if (!rapidplan_interface_enabled_ && software_collision_checks_ && !swept_volumes)
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "No swept volumes are available for roadmap '"
+                                        << roadmap_spec.roadmap_id << "' and group '" << roadmap_spec.group_name
+                                        << "', unable to check collision scene without the MPA");
+    return false;
+  }
+  // the swept volumes of each group are built from its own link geometry
+  const std::string cache_group_name = swept_volumes ? roadmap_spec.group_name : "";
+
+  // reuse the collisions of a previous check with the same occupancy data
+  std::size_t fingerprint = 0;
+  const bool cacheable = (rapidplan_interface_enabled_ || swept_volumes) && collision_cache_size_ > 0 &&
+                         getOccupancyFingerprint(occupancy_data, fingerprint);
+  ResidentRoadmap roadmap;
+  if (cacheable &&
+      findCachedCollisions(cache_group_name, roadmap_spec.roadmap_id, fingerprint, occupancy_data, collisions))
+  {
+    if (!loadRoadmapToPathPlanner(roadmap_spec, roadmap))
+      return false;
+    roadmap_collisions.planners = roadmap.planners;
+    ROS_DEBUG_NAMED(LOGNAME, "Reusing cached collision check result");
+    return true;
+  }
+
+  // Load roadmap to a PathPlanner
+  std::vector<const MPADevice*> failed_devices;
+  if (!loadRoadmapToPathPlanner(roadmap_spec, roadmap))
+    return false;
+  roadmap_collisions.planners = roadmap.planners;
+  const RoadmapSpecification& resident_spec = roadmap.spec;
+
+  // Check collisions on the least loaded MPA, the check is repeated on other MPAs if it fails
+  bool check_scene_success = !rapidplan_interface_enabled_;
+  while (!check_scene_success)
+  {
+    MPADevice* device;
+    {  // SCOPED MUTEX LOCK
+      std::lock_guard<std::mutex> scoped_lock(mpa_mutex_);
+      device = selectDevice(roadmap_spec.roadmap_id, failed_devices);
+    }  // SCOPED MUTEX UNLOCK
+    if (!device)
     {
-      result = planner_.FindPath(start_state_id, goal.tool_pose, collisions, goal.tolerance, goal.weights, waypoints,
-                                 edges, timeout);
+      ROS_ERROR_NAMED(LOGNAME, "HardwareInterface failed to check collision scene. No MPA is available.");
+      return false;
     }
-    else if (goal.type == RapidPlanGoal::Type::STATE_IDS)
+
+    {  // SCOPED DEVICE LOCK
+      // In solve() the RapidPlanInterface and PathPlanner are loaded with the same roadmap so that results from
+      // RapidPlanInterface::CheckScene() can be used with PathPlanner::FindPath().
+      // Calling prepareDeviceRoadmap() ensures that the MPA stores the same roadmap file and the device lock
+      // prevents race conditions by restricting write access in the meantime.
+      // All functions that write roadmaps to an MPA should follow this behavior.
+      std::lock_guard<std::mutex> device_lock(device->mutex);
+      std::size_t roadmap_index;
+      if (device->healthy && prepareDeviceRoadmap(*device, resident_spec, roadmap_index))
+      {
+        rtr::MPAInterface& rapidplan_interface = device->interface;
+        ScopedStageTimer mpa_timer(metrics_, PlannerMetrics::MPA_CHECK_SCENE);
+        if (metrics_)
+          metrics_->increment(PlannerMetrics::MPA_CHECK_SCENE_CALLS);
+        if (occupancy_data.type == OccupancyData::Type::POINT_CLOUD)
+          check_scene_success = rapidplan_interface.CheckScene(occupancy_data.point_cloud, roadmap_index, collisions);
+        else if (occupancy_data.type == OccupancyData::Type::VOXELS)
+          check_scene_success = rapidplan_interface.CheckScene(occupancy_data.voxels, roadmap_index, collisions);
+        else if (occupancy_data.type == OccupancyData::Type::GRID)
+          check_scene_success = rapidplan_interface.CheckScene(grid_voxels, roadmap_index, collisions);
+        else
+        {
+          ROS_WARN_NAMED(LOGNAME, "No type specified in occupancy data");
+          --device->pending_checks;
+          return false;
+        }
+        if (!check_scene_success)
+        {
+          ROS_ERROR_STREAM_NAMED(LOGNAME, "MPA " << device->device_id << " failed to check collision scene.");
+          setDeviceFailed(*device);
+        }
+      }
+      --device->pending_checks;
+    }  // SCOPED DEVICE UNLOCK
+    failed_devices.push_back(device);
+  }
+
+  // Check collisions of the swept volumes with the CPU
+  if (swept_volumes)
+  {
+    if (swept_volumes->getNumEdges() != roadmap_collisions.planners->num_edges)
     {
-      result = planner_.FindPath(start_state_id, goal.state_ids, collisions, waypoints, edges, timeout);
+      ROS_ERROR_STREAM_NAMED(LOGNAME, "Swept volumes don't match the edges of roadmap '" << roadmap_spec.roadmap_id
+                                                                                           << "'");
+      return false;
     }
-    else
+    ScopedStageTimer software_timer(metrics_, PlannerMetrics::SOFTWARE_CHECK_SCENE);
+    if (!swept_volumes->checkScene(occupancy_data, collisions, software_collision_threads_))
     {
-      ROS_ERROR_NAMED(LOGNAME, "RapidPlanGoal goal type missing - Should be TOOL_POSE or STATE_IDS");
+      ROS_ERROR_NAMED(LOGNAME, "Failed to check collision scene with roadmap swept volumes.");
       return false;
     }
+  }
 
-    // debug output
-    if (debug_)
-    {
-      std::string waypoints_debug_text = "Waypoint ids: ";
-      for (std::size_t waypoint : waypoints)
-      {
-        waypoints_debug_text += std::to_string(waypoint);
-        waypoints_debug_text += " ";
-      }
-      ROS_DEBUG_STREAM_NAMED(LOGNAME, waypoints_debug_text);
+  if (cacheable)
+    addCachedCollisions(cache_group_name, roadmap_spec.roadmap_id, fingerprint, occupancy_data, collisions);
 
-      std::string edges_debug_text = "Edges: ";
-      const std::vector<std::array<std::size_t, 2>>& roadmap_edges = planner_.GetEdges();
-      for (std::size_t edge_id : edges)
-      {
-        edges_debug_text += std::to_string(roadmap_edges[(int)edge_id][0]);
-        edges_debug_text += "-";
-        edges_debug_text += std::to_string((int)roadmap_edges[(int)edge_id][1]);
-        edges_debug_text += " ";
-      }
-      ROS_DEBUG_STREAM_NAMED(LOGNAME, edges_debug_text);
+  if (!rapidplan_interface_enabled_ && !software_collision_checks_)
+  {
+    ROS_WARN_NAMED(LOGNAME, "RapidPlan called with disabled collision checks");
+    collisions.resize(roadmap_collisions.planners->num_edges);  // dummy
+  }
+  return true;
+}
+
+bool RTRPlannerInterface::findPath(const RoadmapCollisions& roadmap_collisions, const std::size_t start_state_id,
+                                   const RapidPlanGoal& goal, const double& timeout,
+                                   std::vector<rtr::Config>& waypoint_configs, std::deque<std::size_t>& waypoints,
+                                   std::deque<std::size_t>& edges)
+{
+  if (!roadmap_collisions.planners)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Cannot find path without collision checked roadmap");
+    return false;
+  }
+
+  // Get a PathPlanner for this request, the roadmap data stays valid even if the roadmap is evicted meanwhile
+  std::shared_ptr<rtr::PathPlanner> planner_ptr = acquirePathPlanner(roadmap_collisions.planners);
+  if (!planner_ptr)
+    return false;
+  rtr::PathPlanner& planner = *planner_ptr;
+  const std::vector<uint8_t>& collisions = roadmap_collisions.collisions;
+
+  // Call PathPlanner
+  int result = -1;
+  ScopedStageTimer find_path_timer(metrics_, PlannerMetrics::FIND_PATH);
+  if (goal.type == RapidPlanGoal::Type::TOOL_POSE)
+  {
+    result = planner.FindPath(start_state_id, goal.tool_pose, collisions, goal.tolerance, goal.weights, waypoints,
+                              edges, timeout);
+  }
+  else if (goal.type == RapidPlanGoal::Type::STATE_IDS)
+  {
+    result = planner.FindPath(start_state_id, goal.state_ids, collisions, waypoints, edges, timeout);
+  }
+  else
+  {
+    ROS_ERROR_NAMED(LOGNAME, "RapidPlanGoal goal type missing - Should be TOOL_POSE or STATE_IDS");
+    return false;
+  }
+
+  // debug output
+  if (debug_)
+  {
+    std::string waypoints_debug_text = "Waypoint ids: ";
+    for (std::size_t waypoint : waypoints)
+    {
+      waypoints_debug_text += std::to_string(waypoint);
+      waypoints_debug_text += " ";
     }
+    ROS_DEBUG_STREAM_NAMED(LOGNAME, waypoints_debug_text);
 
-    if (result != 0)  // FAILURE
+    std::string edges_debug_text = "Edges: ";
+    const std::vector<std::array<std::size_t, 2>>& roadmap_edges = planner.GetEdges();
+    for (std::size_t edge_id : edges)
     {
-      ROS_ERROR_STREAM_NAMED(LOGNAME, "RapidPlan failed at finding a valid path - " << planner_.GetError(result));
-      return false;
+      edges_debug_text += std::to_string(roadmap_edges[(int)edge_id][0]);
+      edges_debug_text += "-";
+      edges_debug_text += std::to_string((int)roadmap_edges[(int)edge_id][1]);
+      edges_debug_text += " ";
     }
+    ROS_DEBUG_STREAM_NAMED(LOGNAME, edges_debug_text);
+  }
 
-    // SUCCESS
-    ROS_INFO_STREAM_NAMED(LOGNAME, "RapidPlan found solution path with " << waypoints.size() << " waypoints");
-    roadmap_states = planner_.GetConfigs();  // return state configs
-    return result == 0;
-  }  // SCOPED MUTEX UNLOCK
+  if (result != 0)  // FAILURE
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "RapidPlan failed at finding a valid path - " << planner.GetError(result));
+    return false;
+  }
+
+  // SUCCESS
+  ROS_INFO_STREAM_NAMED(LOGNAME, "RapidPlan found solution path with " << waypoints.size() << " waypoints");
+  // return only the waypoint configs, the roadmap storage is only valid while the PathPlanner is acquired
+  const std::vector<rtr::Config>& roadmap_configs = planner.GetConfigs();
+  waypoint_configs.clear();
+  waypoint_configs.reserve(waypoints.size());
+  for (std::size_t waypoint : waypoints)
+    waypoint_configs.push_back(roadmap_configs[waypoint]);
+  return true;
+}
+
+std::shared_ptr<rtr::PathPlanner> RTRPlannerInterface::acquireRoadmapPlanner(const RoadmapSpecification& roadmap_spec)
+{
+  ResidentRoadmap roadmap;
+  if (!loadRoadmapToPathPlanner(roadmap_spec, roadmap))
+    return nullptr;
+  return acquirePathPlanner(roadmap.planners);
 }
 
 bool RTRPlannerInterface::getRoadmapConfigs(const RoadmapSpecification& roadmap_spec, std::vector<rtr::Config>& configs)
 {
-  // mutex locked because of sequential load and read access
-  {  // SCOPED MUTEX LOCK
-    std::lock_guard<std::mutex> scoped_lock(mutex_);
-    bool success = loadRoadmapToPathPlanner(roadmap_spec);
-    if (success)
-      configs = planner_.GetConfigs();
-    return success;
-  }  // SCOPED MUTEX UNLOCK
+  std::shared_ptr<rtr::PathPlanner> planner = acquireRoadmapPlanner(roadmap_spec);
+  if (planner)
+    configs = planner->GetConfigs();
+  return planner != nullptr;
 }
 
 bool RTRPlannerInterface::getRoadmapEdges(const RoadmapSpecification& roadmap_spec, std::vector<rtr::Edge>& edges)
 {
-  // mutex locked because of sequential load and read access
-  {  // SCOPED MUTEX LOCK
-    std::lock_guard<std::mutex> scoped_lock(mutex_);
-    bool success = loadRoadmapToPathPlanner(roadmap_spec);
-    if (success)
-      edges = planner_.GetEdges();
-    return success;
-  }  // SCOPED MUTEX UNLOCK
+  std::shared_ptr<rtr::PathPlanner> planner = acquireRoadmapPlanner(roadmap_spec);
+  if (planner)
+    edges = planner->GetEdges();
+  return planner != nullptr;
 }
 
 bool RTRPlannerInterface::getRoadmapTransforms(const RoadmapSpecification& roadmap_spec,
                                                std::vector<rtr::ToolPose>& transforms)
 {
-  // mutex locked because of sequential load and read access
-  {  // SCOPED MUTEX LOCK
-    std::lock_guard<std::mutex> scoped_lock(mutex_);
-    bool success = loadRoadmapToPathPlanner(roadmap_spec);
-    if (success)
-      transforms = planner_.GetTransforms();
-    return success;
-  }  // SCOPED MUTEX UNLOCK
+  std::shared_ptr<rtr::PathPlanner> planner = acquireRoadmapPlanner(roadmap_spec);
+  if (planner)
+    transforms = planner->GetTransforms();
+  return planner != nullptr;
+}
+
+RTRPlannerInterface::CollisionCacheStatistics RTRPlannerInterface::getCollisionCacheStatistics() const
+{
+  std::lock_guard<std::mutex> cache_lock(collision_cache_mutex_);
+  return collision_cache_statistics_;
+}
+
+void RTRPlannerInterface::clearCollisionCache()
+{
+  std::lock_guard<std::mutex> cache_lock(collision_cache_mutex_);
+  collision_cache_.clear();
+}
+
+void RTRPlannerInterface::setSweptVolumes(const std::string& group_name, const std::string& roadmap_id,
+                                          const RoadmapSweptVolumesConstPtr& swept_volumes)
+{
+  {
+    std::lock_guard<std::mutex> scoped_lock(mpa_mutex_);
+    swept_volumes_[std::make_pair(group_name, roadmap_id)] = swept_volumes;
+  }
+  // cached results of unchecked collisions are outdated
+  clearCollisionCache();
+}
+
+void RTRPlannerInterface::setPlannerMetrics(const PlannerMetricsPtr& metrics)
+{
+  metrics_ = metrics;
+}
+
+bool RTRPlannerInterface::findCachedCollisions(const std::string& group_name, const std::string& roadmap_id,
+                                               std::size_t fingerprint, const OccupancyData& occupancy_data,
+                                               std::vector<uint8_t>& collisions)
+{
+  std::lock_guard<std::mutex> cache_lock(collision_cache_mutex_);
+  for (CollisionCacheEntry& entry : collision_cache_)
+  {
+    if (entry.fingerprint != fingerprint || entry.type != occupancy_data.type || entry.roadmap_id != roadmap_id ||
+        entry.group_name != group_name)
+      continue;
+    // compare the complete occupancy data to rule out hash collisions
+    const bool is_same_occupancy =
+        entry.type == OccupancyData::Type::GRID ?
+            entry.grid == occupancy_data.grid :
+            entry.voxels.size() == occupancy_data.voxels.size() &&
+                std::equal(entry.voxels.begin(), entry.voxels.end(), occupancy_data.voxels.begin(), &isSameVoxel);
+    if (is_same_occupancy)
+    {
+      entry.last_used = ++collision_cache_counter_;
+      collisions = entry.collisions;
+      ++collision_cache_statistics_.hits;
+      if (metrics_)
+        metrics_->increment(PlannerMetrics::COLLISION_CACHE_HITS);
+      return true;
+    }
+  }
+  ++collision_cache_statistics_.misses;
+  if (metrics_)
+    metrics_->increment(PlannerMetrics::COLLISION_CACHE_MISSES);
+  return false;
+}
+
+void RTRPlannerInterface::addCachedCollisions(const std::string& group_name, const std::string& roadmap_id,
+                                              std::size_t fingerprint, const OccupancyData& occupancy_data,
+                                              const std::vector<uint8_t>& collisions)
+{
+  std::lock_guard<std::mutex> cache_lock(collision_cache_mutex_);
+  CollisionCacheEntry* entry;
+  if (collision_cache_.size() < collision_cache_size_)
+  {
+    collision_cache_.emplace_back();
+    entry = &collision_cache_.back();
+  }
+  else
+  {
+    entry = &*std::min_element(collision_cache_.begin(), collision_cache_.end(),
+                               [](const CollisionCacheEntry& a, const CollisionCacheEntry& b) {
+                                 return a.last_used < b.last_used;
+                               });
+  }
+  entry->group_name = group_name;
+  entry->roadmap_id = roadmap_id;
+  entry->fingerprint = fingerprint;
+  entry->type = occupancy_data.type;
+  entry->voxels.clear();
+  entry->grid = OccupancyGrid();
+  if (occupancy_data.type == OccupancyData::Type::GRID)
+    entry->grid = occupancy_data.grid;
+  else
+    entry->voxels = occupancy_data.voxels;
+  entry->collisions = collisions;
+  entry->last_used = ++collision_cache_counter_;
+}
+
+bool RTRPlannerInterface::loadRoadmap(const RoadmapSpecification& roadmap_spec)
+{
+  ResidentRoadmap roadmap;
+  if (!loadRoadmapToPathPlanner(roadmap_spec, roadmap))
+    return false;
+  const RoadmapSpecification& resident_spec = roadmap.spec;
+  if (!rapidplan_interface_enabled_)
+    return true;
+
+  // write the roadmap to all devices it can be assigned to
+  std::vector<const MPADevice*> prepared_devices;
+  bool success = false;
+  while (true)
+  {
+    MPADevice* device;
+    {  // SCOPED MUTEX LOCK
+      std::lock_guard<std::mutex> scoped_lock(mpa_mutex_);
+      device = selectDevice(roadmap_spec.roadmap_id, prepared_devices);
+    }  // SCOPED MUTEX UNLOCK
+    if (!device)
+      break;
+    {  // SCOPED DEVICE LOCK
+      std::lock_guard<std::mutex> device_lock(device->mutex);
+      std::size_t roadmap_index;
+      success |= prepareDeviceRoadmap(*device, resident_spec, roadmap_index);
+      --device->pending_checks;
+    }  // SCOPED DEVICE UNLOCK
+    prepared_devices.push_back(device);
+  }
+  return success;
 }
 
-bool RTRPlannerInterface::loadRoadmapToPathPlanner(const RoadmapSpecification& roadmap_spec)
+bool RTRPlannerInterface::loadRoadmapToPathPlanner(const RoadmapSpecification& roadmap_spec, ResidentRoadmap& roadmap)
 {
-  // check if roadmap is already loaded in the PathPlanner
-  if (roadmap_spec.roadmap_id != loaded_roadmap_)
+  // check if roadmap is already loaded in a PathPlanner
+  {  // SCOPED MUTEX LOCK
+    std::lock_guard<std::mutex> scoped_lock(mpa_mutex_);
+    auto roadmap_search = resident_roadmaps_.find(roadmap_spec.roadmap_id);
+    if (roadmap_search != resident_roadmaps_.end())
+    {
+      roadmap_search->second.last_used = ++usage_counter_;
+      roadmap = roadmap_search->second;
+      return true;
+    }
+  }  // SCOPED MUTEX UNLOCK
+
+  // parse the roadmap file without blocking requests of other roadmaps, all planners of the pool are loaded here so
+  // that graph searches never need to load the roadmap file
+  PathPlannerPoolPtr planners = std::make_shared<PathPlannerPool>();
+  for (std::size_t i = 0; i < path_planners_per_roadmap_; ++i)
   {
-    ROS_INFO_STREAM_NAMED(LOGNAME, "Loading roadmap: " << roadmap_spec.og_file);
-    if (!planner_.LoadRoadmap(roadmap_spec.og_file))
+    std::unique_ptr<rtr::PathPlanner> planner = loadPathPlanner(roadmap_spec.og_file);
+    if (!planner)
     {
       ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to load roadmap '" << roadmap_spec.roadmap_id << "' to PathPlanner");
-      std::cout << roadmap_spec.og_file << std::endl;
       return false;
     }
+    planners->num_edges = planner->GetNumEdges();
+    planners->idle_planners.push_back(std::move(planner));
+  }
+
+  std::vector<DeviceEviction> evictions;
+  {  // SCOPED MUTEX LOCK
+    std::lock_guard<std::mutex> scoped_lock(mpa_mutex_);
+    // the first loaded planner wins if the roadmap has been loaded concurrently
+    auto roadmap_search = resident_roadmaps_.find(roadmap_spec.roadmap_id);
+    if (roadmap_search != resident_roadmaps_.end())
+    {
+      roadmap_search->second.last_used = ++usage_counter_;
+      roadmap = roadmap_search->second;
+      return true;
+    }
+
+    // make room for the new roadmap
+    while (resident_roadmaps_.size() >= max_resident_roadmaps_)
+      evictLeastRecentlyUsedRoadmap(evictions);
 
-    // save new roadmap if it is new
     // TODO(RTR-51): Only store *.og file paths, others will be deprecated with the next API
-    if (roadmaps_.find(roadmap_spec.roadmap_id) == roadmaps_.end())
-      roadmaps_[roadmap_spec.roadmap_id] = roadmap_spec;
-    loaded_roadmap_ = roadmap_spec.roadmap_id;
+    ResidentRoadmap& resident_roadmap = resident_roadmaps_[roadmap_spec.roadmap_id];
+    resident_roadmap.spec = roadmap_spec;
+    resident_roadmap.planners = planners;
+    resident_roadmap.last_used = ++usage_counter_;
+    roadmap = resident_roadmap;
+  }  // SCOPED MUTEX UNLOCK
 
-    // set edge cost as simple joint distance - TODO(RTR-55): use weighted distance?
-    planner_.SetEdgeCost(&getConfigDistance);
-  }
+  clearEvictedRoadmaps(evictions);
   return true;
 }
 
-bool RTRPlannerInterface::prepareRoadmap(const RoadmapSpecification& roadmap_spec, size_t& roadmap_index)
+std::shared_ptr<rtr::PathPlanner> RTRPlannerInterface::acquirePathPlanner(const PathPlannerPoolPtr& pool)
 {
-  if (!loadRoadmapToPathPlanner(roadmap_spec))
-    return false;
+  // all planners are busy with graph searches of other requests, wait for the first one to be returned
+  std::unique_ptr<rtr::PathPlanner> planner;
+  {
+    std::unique_lock<std::mutex> pool_lock(pool->mutex);
+    pool->idle_condition.wait(pool_lock, [&pool]() { return !pool->idle_planners.empty(); });
+    planner = std::move(pool->idle_planners.back());
+    pool->idle_planners.pop_back();
+  }
 
+  // return the planner to the pool on release
+  return std::shared_ptr<rtr::PathPlanner>(planner.release(), [pool](rtr::PathPlanner* released_planner) {
+    {
+      std::lock_guard<std::mutex> pool_lock(pool->mutex);
+      pool->idle_planners.emplace_back(released_planner);
+    }
+    pool->idle_condition.notify_one();
+  });
+}
+
+RTRPlannerInterface::MPADevice*
+RTRPlannerInterface::selectDevice(const std::string& roadmap_id, const std::vector<const MPADevice*>& excluded_devices)
+{
+  std::size_t num_replicas = 0;
+  for (const std::unique_ptr<MPADevice>& device : mpa_devices_)
+    num_replicas += device->healthy && device->assigned_roadmaps.count(roadmap_id);
+  const bool add_replica = num_replicas < mpa_roadmap_replicas_;
+
+  // prefer the device with the fewest pending checks, then devices that already store the roadmap
+  MPADevice* selected_device = nullptr;
+  std::size_t selected_checks = 0;
+  bool selected_assigned = false;
+  for (const std::unique_ptr<MPADevice>& device : mpa_devices_)
+  {
+    if (!device->healthy ||
+        std::find(excluded_devices.begin(), excluded_devices.end(), device.get()) != excluded_devices.end())
+      continue;
+    const bool assigned = device->assigned_roadmaps.count(roadmap_id);
+    if (!assigned && !add_replica)
+      continue;
+    const std::size_t pending_checks = device->pending_checks;
+    if (!selected_device || pending_checks < selected_checks ||
+        (pending_checks == selected_checks && assigned && !selected_assigned))
+    {
+      selected_device = device.get();
+      selected_checks = pending_checks;
+      selected_assigned = assigned;
+    }
+  }
+  if (selected_device)
+  {
+    // roadmaps evicted by concurrent requests must not be assigned again, they would never be removed from the MPA
+    if (resident_roadmaps_.count(roadmap_id))
+      selected_device->assigned_roadmaps.insert(roadmap_id);
+    ++selected_device->pending_checks;
+  }
+  return selected_device;
+}
+
+bool RTRPlannerInterface::prepareDeviceRoadmap(MPADevice& device, const RoadmapSpecification& roadmap_spec,
+                                               std::size_t& roadmap_index)
+{
   // check if roadmap is already written to hardware
-  if (!findRoadmapIndex(roadmap_spec.roadmap_id, roadmap_index))
+  auto index_search = device.roadmap_indices.find(roadmap_spec.roadmap_id);
+  if (index_search == device.roadmap_indices.end())
   {
-    if (rapidplan_interface_enabled_)
+    if (!writeRoadmap(device, roadmap_spec))
     {
-      // write roadmap and retrieve new roadmap index
-      if (!rapidplan_interface_.WriteRoadmap(roadmap_spec.og_file, roadmap_index))
-      {
-        ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to write roadmap '" << roadmap_spec.roadmap_id << "' to RapidPlan MPA");
+      // the MPA storage might be full, clear all other roadmaps and try again
+      if (device.roadmap_indices.empty())
+        return false;
+      ROS_WARN_STREAM_NAMED(LOGNAME, "Clearing storage of MPA " << device.device_id << " to write roadmap '"
+                                                                << roadmap_spec.roadmap_id << "'");
+      if (!clearMPARoadmaps(device) || !writeRoadmap(device, roadmap_spec))
         return false;
-      }
     }
-    else
+    index_search = device.roadmap_indices.find(roadmap_spec.roadmap_id);
+    ROS_INFO_STREAM_NAMED(LOGNAME, "RapidPlan MPA " << device.device_id << " initialized with roadmap '"
+                                                    << roadmap_spec.roadmap_id << "'");
+  }
+  roadmap_index = index_search->second;
+  return true;
+}
+
+bool RTRPlannerInterface::writeRoadmap(MPADevice& device, const RoadmapSpecification& roadmap_spec)
+{
+  // write roadmap and retrieve new roadmap index
+  if (metrics_)
+    metrics_->increment(PlannerMetrics::MPA_ROADMAP_WRITES);
+  std::size_t roadmap_index;
+  if (!device.interface.WriteRoadmap(roadmap_spec.og_file, roadmap_index))
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to write roadmap '" << roadmap_spec.roadmap_id << "' to RapidPlan MPA "
+                                                                << device.device_id);
+    return false;
+  }
+  device.roadmap_indices[roadmap_spec.roadmap_id] = roadmap_index;
+  return true;
+}
+
+void RTRPlannerInterface::evictLeastRecentlyUsedRoadmap(std::vector<DeviceEviction>& evictions)
+{
+  auto lru_roadmap = resident_roadmaps_.begin();
+  for (auto it = resident_roadmaps_.begin(); it != resident_roadmaps_.end(); ++it)
+    if (it->second.last_used < lru_roadmap->second.last_used)
+      lru_roadmap = it;
+  if (lru_roadmap == resident_roadmaps_.end())
+    return;
+  ROS_INFO_STREAM_NAMED(LOGNAME, "Evicting least recently used roadmap '" << lru_roadmap->first << "'");
+  const std::string roadmap_id = lru_roadmap->first;
+  resident_roadmaps_.erase(lru_roadmap);
+
+  // the devices are only accessed after releasing mpa_mutex_, see clearEvictedRoadmaps()
+  for (std::unique_ptr<MPADevice>& device : mpa_devices_)
+  {
+    if (!device->assigned_roadmaps.erase(roadmap_id))
+      continue;
+    evictions.emplace_back();
+    DeviceEviction& eviction = evictions.back();
+    eviction.device = device.get();
+    eviction.roadmap_id = roadmap_id;
+    for (const std::string& assigned_roadmap : device->assigned_roadmaps)
     {
-      // if we don't use hardware, we just increase the numbers
-      roadmap_index = roadmap_indices_.size();
+      auto roadmap_search = resident_roadmaps_.find(assigned_roadmap);
+      if (roadmap_search != resident_roadmaps_.end())
+        eviction.remaining_roadmaps.push_back(roadmap_search->second.spec);
     }
-    roadmap_indices_[roadmap_index] = roadmap_spec.roadmap_id;
   }
-  ROS_INFO_STREAM_NAMED(LOGNAME, "RapidPlan initialized with with roadmap '" << roadmap_spec.roadmap_id << "'");
+}
+
+void RTRPlannerInterface::clearEvictedRoadmaps(const std::vector<DeviceEviction>& evictions)
+{
+  // The MPA storage can only be cleared as a whole, so the remaining roadmaps of the devices are written again.
+  // Roadmaps that have been assigned meanwhile are written by prepareDeviceRoadmap() on their next check.
+  for (const DeviceEviction& eviction : evictions)
+  {
+    MPADevice& device = *eviction.device;
+    std::lock_guard<std::mutex> device_lock(device.mutex);
+    if (!device.roadmap_indices.count(eviction.roadmap_id) || !clearMPARoadmaps(device))
+      continue;
+    for (const RoadmapSpecification& remaining_roadmap : eviction.remaining_roadmaps)
+      writeRoadmap(device, remaining_roadmap);
+  }
+}
+
+bool RTRPlannerInterface::clearMPARoadmaps(MPADevice& device)
+{
+  device.roadmap_indices.clear();
+  if (!device.interface.ClearRoadmaps())
+  {
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to clear storage of RapidPlan MPA " << device.device_id);
+    return false;
+  }
   return true;
 }
 }  // namespace rtr_moveit
@@ -37,7 +37,11 @@
  */
 
 // C++
+#include <algorithm>
+#include <limits>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
 #include <vector>
@@ -45,15 +49,21 @@
 
 // MoveIt!
 #include <moveit/planning_interface/planning_interface.h>
+#include <moveit/robot_state/robot_state.h>
 #include <moveit_msgs/Constraints.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <pluginlib/class_list_macros.hpp>
 
 // rtr_moveit
 #include <rtr_moveit/rtr_planning_context.h>
 #include <rtr_moveit/rtr_planner_interface.h>
+#include <rtr_moveit/planner_metrics.h>
+#include <rtr_moveit/roadmap_cache.h>
+#include <rtr_moveit/roadmap_coverage.h>
 #include <rtr_moveit/roadmap_visualization.h>
 
 // ROS parameter loading
+#include <eigen_conversions/eigen_msg.h>
 #include <ros/package.h>
 #include <rosparam_shortcuts/rosparam_shortcuts.h>
 
@@ -66,6 +76,55 @@ const std::string PLANNER_DESCRIPTION = "RapidPlan";
 // default roadmap planner id (NOTE: in the future we could support diferent selection modes)
 const std::string ROADMAP_DEFAULT = "Default";
 
+// Idle planning contexts of a single group and roadmap that are handed out again for later requests
+struct PlanningContextPool
+{
+  std::mutex mutex;
+  std::vector<std::unique_ptr<RTRPlanningContext>> idle_contexts;
+};
+typedef std::shared_ptr<PlanningContextPool> PlanningContextPoolPtr;
+
+namespace
+{
+// Returns the radius of the bounding sphere of a constraint region primitive
+bool getPrimitiveRadius(const shape_msgs::SolidPrimitive& primitive, double& radius)
+{
+  const std::vector<double>& dimensions = primitive.dimensions;
+  if (primitive.type == shape_msgs::SolidPrimitive::SPHERE && dimensions.size() >= 1)
+    radius = dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS];
+  else if (primitive.type == shape_msgs::SolidPrimitive::BOX && dimensions.size() >= 3)
+    radius = 0.5 * std::sqrt(std::pow(dimensions[shape_msgs::SolidPrimitive::BOX_X], 2) +
+                             std::pow(dimensions[shape_msgs::SolidPrimitive::BOX_Y], 2) +
+                             std::pow(dimensions[shape_msgs::SolidPrimitive::BOX_Z], 2));
+  else if (primitive.type == shape_msgs::SolidPrimitive::CYLINDER && dimensions.size() >= 2)
+    radius = std::sqrt(std::pow(dimensions[shape_msgs::SolidPrimitive::CYLINDER_RADIUS], 2) +
+                       std::pow(0.5 * dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT], 2));
+  else
+    return false;
+  return true;
+}
+
+// Returns the transform of a frame in the model frame if it doesn't depend on any joint positions
+bool getFixedFrameTransform(const robot_state::RobotState& default_state, const std::string& frame,
+                            Eigen::Isometry3d& transform)
+{
+  const robot_model::RobotModel& robot_model = *default_state.getRobotModel();
+  if (frame.empty() || frame == robot_model.getModelFrame())
+  {
+    transform = Eigen::Isometry3d::Identity();
+    return true;
+  }
+  if (!robot_model.hasLinkModel(frame))
+    return false;
+  const robot_model::LinkModel* link = robot_model.getLinkModel(frame);
+  for (const robot_model::LinkModel* parent = link; parent; parent = parent->getParentLinkModel())
+    if (parent->getParentJointModel()->getType() != robot_model::JointModel::FIXED)
+      return false;
+  transform = default_state.getGlobalLinkTransform(link);
+  return true;
+}
+}  // namespace
+
 class RTRPlannerManager : public planning_interface::PlannerManager
 {
 public:
@@ -77,6 +136,7 @@ public:
   bool initialize(const robot_model::RobotModelConstPtr& robot_model, const std::string& ns)
   {
     // load config
+    robot_model_ = robot_model;
     group_names_ = robot_model->getJointModelGroupNames();
     loadRoadmapConfigurations();
     if (group_configs_.empty())
@@ -91,13 +151,32 @@ public:
     }
 
     // initialize planner
+    metrics_ = std::make_shared<PlannerMetrics>();
     planner_interface_.reset(new RTRPlannerInterface(nh_));
+    planner_interface_->setPlannerMetrics(metrics_);
     if (!planner_interface_->initialize())
     {
       ROS_ERROR_NAMED(LOGNAME, "RapidPlan interface could not be initialized!");
       return false;
     }
 
+    // periodically publish stage latencies and counters
+    const double metrics_publish_period = nh_.param("planner_config/metrics_publish_period", 10.0);
+    if (metrics_publish_period > 0.0)
+    {
+      metrics_pub_ = nh_.advertise<diagnostic_msgs::DiagnosticArray>("metrics", 1);
+      metrics_timer_ = nh_.createWallTimer(ros::WallDuration(metrics_publish_period),
+                                           &RTRPlannerManager::publishMetrics, this);
+    }
+
+    // load default roadmaps to the PathPlanner and MPA so that the first requests don't need to
+    for (const std::pair<const std::string, GroupConfig>& group_configs_item : group_configs_)
+    {
+      auto roadmap_search = roadmaps_.find(group_configs_item.second.default_roadmap_id);
+      if (roadmap_search != roadmaps_.end() && !planner_interface_->loadRoadmap(roadmap_search->second))
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to preload default roadmap '" << roadmap_search->first << "'");
+    }
+
     occupancy_handler_.reset(new OccupancyHandler(nh_));
     std::string occupancy_source;
     nh_.param("planner_config/occupancy_source", occupancy_source, std::string("PLANNING_SCENE"));
@@ -111,6 +190,10 @@ public:
       }
       occupancy_handler_->setPointCloudTopic(pcl_topic);
     }
+    else if (occupancy_source == "FUSION" && !loadPointCloudSensors())
+    {
+      return false;
+    }
 
     // set default planner ids
     for (const std::pair<std::string, GroupConfig>& group_configs_item : group_configs_)
@@ -118,6 +201,21 @@ public:
 
     visualization_.reset(new RoadmapVisualization(nh_));
 
+    // roadmap data is shared by all planning contexts, optionally load all roadmaps in advance
+    roadmap_cache_.reset(new RoadmapCache(nh_.param("planner_config/roadmap_snapshot_directory", std::string())));
+    if (nh_.param("planner_config/preload_roadmaps", false))
+      for (const std::pair<std::string, RoadmapSpecification>& roadmap_item : roadmaps_)
+        if (!roadmap_cache_->loadRoadmap(roadmap_item.second))
+          ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to preload roadmap '" << roadmap_item.first << "'");
+
+    // fixed frame transforms and joints outside of planning groups use the default state
+    default_state_.reset(new robot_state::RobotState(robot_model_));
+    default_state_->setToDefaultValues();
+    default_state_->update();
+
+    loadRoadmapCoverages();
+    if (!nh_.param("planner_config/rapidplan_interface_enabled", false))
+      loadRoadmapSweptVolumes();
     return true;
   }
 
@@ -151,10 +249,11 @@ public:
                                           << "Supported are only joint/position/orientation goals");
       return false;
     }
-    // Note: Further checks require inspecting the roadmaps, volume region and attached collision objects.
-    // This does not belong into the planner manager and should be provided by the planning context.
-    // TODO(RTR-50): check if we have a valid roadmap for this request
-    // TODO(RTR-49): check if we can handle the goal constraints
+    // reject requests that are not covered by any roadmap of the group
+    // Note: Collisions with the volume region and attached collision objects can only be checked by the context.
+    std::string roadmap_id;
+    if (!selectRoadmap(req, roadmap_id))
+      return false;
 
     return true;
   }
@@ -179,6 +278,32 @@ public:
     }
   }
 
+  /** \brief Adds all point cloud sensors for occupancy fusion to the occupancy handler */
+  bool loadPointCloudSensors()
+  {
+    std::vector<std::string> sensor_names;
+    if (!nh_.getParam("planner_config/pcl_sensors", sensor_names) || sensor_names.empty())
+    {
+      ROS_ERROR_NAMED(LOGNAME, "Occupancy source 'FUSION' cannot be configured without parameter 'pcl_sensors'");
+      return false;
+    }
+    const double default_max_age = nh_.param("planner_config/pcl_max_age", 0.1);
+    for (const std::string& sensor_name : sensor_names)
+    {
+      std::string sensor_config = "planner_config/sensors/" + sensor_name;
+      std::string pcl_topic;
+      if (!nh_.getParam(sensor_config + "/pcl_topic", pcl_topic))
+      {
+        ROS_ERROR_STREAM_NAMED(LOGNAME, "Point cloud sensor '" << sensor_name << "' is missing parameter 'pcl_topic'");
+        return false;
+      }
+      double max_age = nh_.param(sensor_config + "/max_age", default_max_age);
+      occupancy_handler_->addPointCloudSensor(sensor_name, pcl_topic, max_age);
+      ROS_INFO_STREAM_NAMED(LOGNAME, "Fusing point cloud sensor '" << sensor_name << "' on topic: " << pcl_topic);
+    }
+    return true;
+  }
+
   void loadRoadmapConfigurations()
   {
     // load group configs
@@ -282,34 +407,16 @@ public:
   {
     RTRPlanningContextPtr context;
     error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-    // look for group config
-    auto group_config_search = group_configs_.find(req.group_name);
-    if (group_config_search != group_configs_.end())
-    {
-      // look for roadmap
-      // TODO(RTR-31): look for suitable roadmap if we have multiple
-      GroupConfig group_config = group_config_search->second;
-      std::string group_roadmap = group_config.default_roadmap_id;
-      // look for non-default roadmap id
-      if (req.planner_id != ROADMAP_DEFAULT && req.planner_id != group_roadmap)
-      {
-        auto roadmap_search = group_config.roadmap_ids.find(req.planner_id);
-        if (roadmap_search != group_config.roadmap_ids.end())
-          group_roadmap = *roadmap_search;
-      }
-      // if default roadmap is not specified, use the first in the list
-      else if (group_roadmap.empty() && !group_config.roadmap_ids.empty())
-      {
-        group_roadmap = *group_config.roadmap_ids.begin();
-      }
-      auto roadmap_search = roadmaps_.find(group_roadmap);
+    // select the roadmap that covers the request best
+    std::string roadmap_id;
+    if (selectRoadmap(req, roadmap_id))
+    {
+      auto roadmap_search = roadmaps_.find(roadmap_id);
       if (roadmap_search != roadmaps_.end())
       {
-        context.reset(
-            new RTRPlanningContext(req.group_name, roadmap_search->second, planner_interface_, visualization_));
+        context = acquirePlanningContext(req.group_name, roadmap_search->second);
         context->setMotionPlanRequest(req);
         context->setPlanningScene(planning_scene);
-        context->setOccupancyHandler(occupancy_handler_);
         context->configure(error_code);
       }
       else
@@ -317,15 +424,271 @@ public:
         ROS_ERROR_STREAM_NAMED(LOGNAME, "No valid roadmap specification found for group " << req.group_name);
       }
     }
-    else
+    return context;
+  }
+
+private:
+  /** \brief Loads the coverage maps of all roadmaps for checking requests without loading the roadmaps */
+  void loadRoadmapCoverages()
+  {
+    nh_.param("planner_config/use_roadmap_coverage", use_roadmap_coverage_, true);
+    if (!use_roadmap_coverage_)
+      return;
+    double cell_size = nh_.param("planner_config/coverage_cell_size", 0.05);
+    if (cell_size <= 0.0)
+    {
+      ROS_WARN_NAMED(LOGNAME, "Parameter 'coverage_cell_size' must be positive. Proceeding with default 0.05.");
+      cell_size = 0.05;
+    }
+    const bool cache_coverage = nh_.param("planner_config/cache_roadmap_coverage", true);
+    nh_.param("planner_config/allowed_joint_distance", allowed_joint_distance_, 0.5);
+    nh_.param("planner_config/coverage_position_tolerance", coverage_position_tolerance_, 0.2);
+    coverage_position_tolerance_ =
+        std::max(coverage_position_tolerance_, nh_.param("planner_config/allowed_position_distance", 0.1));
+
+    for (const std::pair<const std::string, RoadmapSpecification>& roadmap_item : roadmaps_)
+    {
+      RoadmapCoverageConstPtr coverage;
+      if (roadmap_cache_->getRoadmapCoverage(roadmap_item.second, cell_size, cache_coverage, coverage))
+        coverages_[roadmap_item.first] = coverage;
+      else
+        ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to load coverage map of roadmap '" << roadmap_item.first << "'");
+    }
+  }
+
+  /** \brief Loads the swept volumes of the roadmaps of all groups for collision checking without the MPA */
+  void loadRoadmapSweptVolumes()
+  {
+    if (!nh_.param("planner_config/software_collision_checks", true))
+      return;
+    double max_step = nh_.param("planner_config/swept_volume_step", 0.01);
+    if (max_step <= 0.0)
+    {
+      ROS_WARN_NAMED(LOGNAME, "Parameter 'swept_volume_step' must be positive. Proceeding with default 0.01.");
+      max_step = 0.01;
+    }
+    const bool cache_swept_volumes = nh_.param("planner_config/cache_swept_volumes", true);
+    const int num_threads = nh_.param("planner_config/software_collision_threads", 0);
+
+    for (const std::pair<const std::string, GroupConfig>& group_configs_item : group_configs_)
+    {
+      std::set<std::string> roadmap_ids = group_configs_item.second.roadmap_ids;
+      roadmap_ids.insert(group_configs_item.second.default_roadmap_id);
+      for (const std::string& roadmap_id : roadmap_ids)
+      {
+        auto roadmap_search = roadmaps_.find(roadmap_id);
+        RoadmapSweptVolumesConstPtr swept_volumes;
+        if (roadmap_search != roadmaps_.end() &&
+            roadmap_cache_->getRoadmapSweptVolumes(roadmap_search->second, *default_state_, group_configs_item.first,
+                                                   max_step, std::max(0, num_threads), cache_swept_volumes,
+                                                   swept_volumes))
+          planner_interface_->setSweptVolumes(group_configs_item.first, roadmap_id, swept_volumes);
+        else if (roadmap_search != roadmaps_.end())
+          ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to load swept volumes of roadmap '"
+                                             << roadmap_id << "' for group '" << group_configs_item.first
+                                             << "', requests will fail");
+      }
+    }
+  }
+
+  /** \brief Selects the roadmap of the request's group that covers most goal constraints. Only the planner id
+   *  ROADMAP_DEFAULT selects among all roadmaps of the group and prefers the default roadmap on ties. Any other
+   *  planner id selects the named roadmap of the group, including the default roadmap, or the default roadmap if
+   *  the id is unknown. Roadmaps without coverage maps are assumed to cover all goals.
+   *  \return false if no roadmap covers the start state and any of the goal constraints */
+  bool selectRoadmap(const moveit_msgs::MotionPlanRequest& req, std::string& roadmap_id) const
+  {
+    auto group_config_search = group_configs_.find(req.group_name);
+    if (group_config_search == group_configs_.end())
     {
       ROS_ERROR_STREAM_NAMED(LOGNAME, "Group '" << req.group_name << "' is not configured with any roadmaps for "
                                                                      "RapidPlan");
+      return false;
     }
-    return context;
+    const GroupConfig& group_config = group_config_search->second;
+
+    // candidate roadmaps in order of preference, unknown planner ids use the default roadmap as before
+    std::vector<std::string> roadmap_ids;
+    if (req.planner_id != ROADMAP_DEFAULT && group_config.roadmap_ids.count(req.planner_id))
+    {
+      roadmap_ids.push_back(req.planner_id);
+    }
+    else if (req.planner_id != ROADMAP_DEFAULT && !group_config.default_roadmap_id.empty())
+    {
+      roadmap_ids.push_back(group_config.default_roadmap_id);
+    }
+    else
+    {
+      if (!group_config.default_roadmap_id.empty())
+        roadmap_ids.push_back(group_config.default_roadmap_id);
+      for (const std::string& group_roadmap_id : group_config.roadmap_ids)
+        if (group_roadmap_id != group_config.default_roadmap_id)
+          roadmap_ids.push_back(group_roadmap_id);
+    }
+
+    int best_coverage = 0;
+    for (const std::string& candidate_id : roadmap_ids)
+    {
+      auto coverage_search = coverages_.find(candidate_id);
+      const int coverage = coverage_search == coverages_.end() ?
+                               req.goal_constraints.size() :
+                               getRequestCoverage(req, *coverage_search->second);
+      if (roadmap_id.empty() || coverage > best_coverage)
+      {
+        roadmap_id = candidate_id;
+        best_coverage = coverage;
+      }
+    }
+    if (roadmap_id.empty())
+    {
+      ROS_ERROR_STREAM_NAMED(LOGNAME, "No roadmap found for group " << req.group_name);
+      return false;
+    }
+    if (best_coverage <= 0)
+    {
+      ROS_ERROR_STREAM_NAMED(LOGNAME, "Start state or goal constraints are not covered by any roadmap of group "
+                                          << req.group_name);
+      return false;
+    }
+    return true;
+  }
+
+  /** \brief Returns the number of goal constraints that are covered by the roadmap, -1 if the start state is not
+   *  covered. Constraints that can't be checked with the coverage map are assumed to be covered. */
+  int getRequestCoverage(const moveit_msgs::MotionPlanRequest& req, const RoadmapCoverage& coverage) const
+  {
+    if (!robot_model_->hasJointModelGroup(req.group_name))
+      return req.goal_constraints.size();
+    const std::vector<std::string>& joint_names =
+        robot_model_->getJointModelGroup(req.group_name)->getActiveJointModelNames();
+
+    // the closest roadmap state of the start state needs to be within the allowed joint distance
+    const sensor_msgs::JointState& start_state = req.start_state.joint_state;
+    std::vector<double> start_config;
+    for (const std::string& joint_name : joint_names)
+    {
+      auto name_search = std::find(start_state.name.begin(), start_state.name.end(), joint_name);
+      const std::size_t index = name_search - start_state.name.begin();
+      if (index < start_state.position.size())
+        start_config.push_back(start_state.position[index]);
+    }
+    if (start_config.size() == joint_names.size() &&
+        coverage.getJointDistance(start_config, start_config) > allowed_joint_distance_)
+      return -1;
+
+    int covered_goals = 0;
+    for (const moveit_msgs::Constraints& goal_constraint : req.goal_constraints)
+      covered_goals += isGoalCovered(goal_constraint, joint_names, coverage);
+    return covered_goals;
+  }
+
+  /** \brief Checks if joint and position constraints of a goal are covered by the roadmap */
+  bool isGoalCovered(const moveit_msgs::Constraints& goal_constraint, const std::vector<std::string>& joint_names,
+                     const RoadmapCoverage& coverage) const
+  {
+    if (!goal_constraint.visibility_constraints.empty())
+      return false;
+
+    // joint constraints need roadmap states within the allowed joint distance
+    if (!goal_constraint.joint_constraints.empty())
+    {
+      std::vector<double> lower(joint_names.size(), -std::numeric_limits<double>::infinity());
+      std::vector<double> upper(joint_names.size(), std::numeric_limits<double>::infinity());
+      for (const moveit_msgs::JointConstraint& joint_constraint : goal_constraint.joint_constraints)
+      {
+        const std::size_t index =
+            std::find(joint_names.begin(), joint_names.end(), joint_constraint.joint_name) - joint_names.begin();
+        if (index < joint_names.size())
+        {
+          lower[index] = joint_constraint.position - std::abs(joint_constraint.tolerance_below);
+          upper[index] = joint_constraint.position + std::abs(joint_constraint.tolerance_above);
+        }
+      }
+      if (coverage.getJointDistance(lower, upper) > allowed_joint_distance_)
+        return false;
+    }
+
+    // position constraints of the end effector need roadmap tool positions close to the constraint region
+    Eigen::Isometry3d model_to_base;
+    if (!getFixedFrameTransform(*default_state_, coverage.getBaseLinkFrame(), model_to_base))
+      return true;
+    for (const moveit_msgs::PositionConstraint& position_constraint : goal_constraint.position_constraints)
+    {
+      const moveit_msgs::BoundingVolume& region = position_constraint.constraint_region;
+      const geometry_msgs::Vector3& offset = position_constraint.target_point_offset;
+      Eigen::Isometry3d model_to_frame;
+      if (position_constraint.link_name != coverage.getEndEffectorFrame() || offset.x != 0.0 || offset.y != 0.0 ||
+          offset.z != 0.0 || region.primitives.empty() || region.primitives.size() != region.primitive_poses.size() ||
+          !getFixedFrameTransform(*default_state_, position_constraint.header.frame_id, model_to_frame))
+        continue;
+      const Eigen::Isometry3d base_to_frame = model_to_base.inverse() * model_to_frame;
+      bool is_covered = false;
+      for (std::size_t i = 0; i < region.primitives.size() && !is_covered; ++i)
+      {
+        double radius;
+        Eigen::Vector3d position;
+        tf::pointMsgToEigen(region.primitive_poses[i].position, position);
+        // unknown primitives can't be checked
+        is_covered = !getPrimitiveRadius(region.primitives[i], radius) ||
+                     coverage.coversPosition(base_to_frame * position, radius + coverage_position_tolerance_);
+      }
+      if (!is_covered)
+        return false;
+    }
+    return true;
+  }
+
+  /** \brief Publishes the current planner metrics as diagnostic status */
+  void publishMetrics(const ros::WallTimerEvent& /*event*/)
+  {
+    diagnostic_msgs::DiagnosticArray metrics_msg;
+    metrics_msg.header.stamp = ros::Time::now();
+    metrics_msg.status.resize(1);
+    metrics_->getDiagnosticStatus(metrics_msg.status[0]);
+    metrics_pub_.publish(metrics_msg);
+  }
+
+  /** \brief Returns an idle planning context of the pool for the given group and roadmap, or creates a new one.
+   *  The context is cleared and returned to the pool when it's released. */
+  RTRPlanningContextPtr acquirePlanningContext(const std::string& group_name,
+                                               const RoadmapSpecification& roadmap_spec) const
+  {
+    PlanningContextPoolPtr pool;
+    {
+      std::lock_guard<std::mutex> pools_lock(context_pools_mutex_);
+      PlanningContextPoolPtr& group_pool = context_pools_[group_name + "[" + roadmap_spec.roadmap_id + "]"];
+      if (!group_pool)
+        group_pool = std::make_shared<PlanningContextPool>();
+      pool = group_pool;
+    }
+
+    std::unique_ptr<RTRPlanningContext> context;
+    {
+      std::lock_guard<std::mutex> pool_lock(pool->mutex);
+      if (!pool->idle_contexts.empty())
+      {
+        context = std::move(pool->idle_contexts.back());
+        pool->idle_contexts.pop_back();
+      }
+    }
+
+    // all contexts are in use, create another one
+    if (!context)
+    {
+      context.reset(new RTRPlanningContext(group_name, roadmap_spec, planner_interface_, visualization_));
+      context->setOccupancyHandler(occupancy_handler_);
+      context->setRoadmapCache(roadmap_cache_);
+      context->setPlannerMetrics(metrics_);
+    }
+
+    // return the context to the pool on release
+    return RTRPlanningContextPtr(context.release(), [pool](RTRPlanningContext* released_context) {
+      released_context->clear();
+      std::lock_guard<std::mutex> pool_lock(pool->mutex);
+      pool->idle_contexts.emplace_back(released_context);
+    });
   }
 
-private:
   ros::NodeHandle nh_;
 
   // The RapidPlan wrapper interface
@@ -337,6 +700,24 @@ private:
   std::map<std::string, GroupConfig> group_configs_;
   std::map<std::string, RoadmapSpecification> roadmaps_;
   std::shared_ptr<OccupancyHandler> occupancy_handler_;
+  RoadmapCachePtr roadmap_cache_;
+
+  // coverage maps of all roadmaps by roadmap_id for rejecting requests and selecting roadmaps
+  robot_model::RobotModelConstPtr robot_model_;
+  robot_state::RobotStatePtr default_state_;
+  std::map<std::string, RoadmapCoverageConstPtr> coverages_;
+  bool use_roadmap_coverage_ = true;
+  double allowed_joint_distance_ = 0.5;
+  double coverage_position_tolerance_ = 0.2;
+
+  // stage latencies and counters, published on ~/metrics
+  PlannerMetricsPtr metrics_;
+  ros::Publisher metrics_pub_;
+  ros::WallTimer metrics_timer_;
+
+  // reusable planning contexts by "<group>[<roadmap_id>]"
+  mutable std::mutex context_pools_mutex_;
+  mutable std::map<std::string, PlanningContextPoolPtr> context_pools_;
 };
 }  // namespace rtr_moveit
 
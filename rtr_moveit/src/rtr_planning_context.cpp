@@ -40,9 +40,16 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 // Eigen
 #include <Eigen/Geometry>
+#include <eigen_conversions/eigen_msg.h>
 
 // ROS parameters
 #include <ros/ros.h>
@@ -59,15 +66,74 @@
 // rtr_moveit
 #include <rtr_moveit/rtr_planning_context.h>
 #include <rtr_moveit/rtr_planner_interface.h>
-#include <rtr_moveit/roadmap_search.h>
 #include <rtr_moveit/roadmap_visualization.h>
-
-// RapidPlan
-#include <rtr-api/OGFileReader.hpp>
+#include <rtr_moveit/roadmap_search.h>
 
 namespace rtr_moveit
 {
 static const std::string LOGNAME = "rtr_planning_context";
+namespace
+{
+// Calls process(i) for all i in [0, count) in increasing order of i, distributed over up to num_threads threads
+template <typename Function>
+void parallelFor(std::size_t count, std::size_t num_threads, const Function& process)
+{
+  std::atomic<std::size_t> next(0);
+  auto run = [&]() {
+    for (std::size_t i = next++; i < count; i = next++)
+      process(i);
+  };
+  std::vector<std::thread> threads;
+  for (std::size_t t = 1; t < std::min(num_threads, count); ++t)
+    threads.emplace_back(run);
+  run();
+  for (std::thread& thread : threads)
+    thread.join();
+}
+}  // namespace
+
+std::vector<std::size_t> getBisectionOrder(std::size_t step_count)
+{
+  std::vector<std::size_t> steps = { step_count };
+  if (step_count > 0)
+    steps.push_back(0);
+  std::deque<std::pair<std::size_t, std::size_t>> intervals = { { 0, step_count } };
+  while (!intervals.empty())
+  {
+    const std::size_t begin = intervals.front().first;
+    const std::size_t end = intervals.front().second;
+    intervals.pop_front();
+    if (end - begin < 2)
+      continue;
+    const std::size_t mid = begin + (end - begin) / 2;
+    steps.push_back(mid);
+    intervals.emplace_back(begin, mid);
+    intervals.emplace_back(mid, end);
+  }
+  return steps;
+}
+
+bool getRegionTolerance(const shape_msgs::SolidPrimitive& region, double& tolerance)
+{
+  if (region.type == shape_msgs::SolidPrimitive::SPHERE && region.dimensions.size() == 1)
+    tolerance = region.dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS];
+  else if (region.type == shape_msgs::SolidPrimitive::BOX && region.dimensions.size() == 3)
+    tolerance = 0.5 * *std::min_element(region.dimensions.begin(), region.dimensions.end());
+  else if (region.type == shape_msgs::SolidPrimitive::CYLINDER && region.dimensions.size() == 2)
+    tolerance = std::min(region.dimensions[shape_msgs::SolidPrimitive::CYLINDER_RADIUS],
+                         0.5 * region.dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT]);
+  else
+    return false;
+  return true;
+}
+
+void getRollPitchYaw(const Eigen::Matrix3d& rotation, double& roll, double& pitch, double& yaw)
+{
+  const tf::Matrix3x3 matrix(rotation(0, 0), rotation(0, 1), rotation(0, 2), rotation(1, 0), rotation(1, 1),
+                             rotation(1, 2), rotation(2, 0), rotation(2, 1), rotation(2, 2));
+  matrix.getRPY(roll, pitch, yaw);
+}
+
 RTRPlanningContext::RTRPlanningContext(const std::string& planning_group, const RoadmapSpecification& roadmap_spec,
                                        const RTRPlannerInterfacePtr& planner_interface,
                                        const RoadmapVisualizationPtr& visualization)
@@ -76,6 +142,7 @@ RTRPlanningContext::RTRPlanningContext(const std::string& planning_group, const
   , roadmap_(roadmap_spec)
   , visualization_(visualization)
 {
+  roadmap_.group_name = planning_group;
 }
 
 moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotTrajectoryPtr& trajectory)
@@ -84,6 +151,9 @@ moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotT
   terminate_plan_time_ = start_time_ + ros::Duration(request_.allowed_planning_time);
   moveit_msgs::MoveItErrorCodes result;
   result.val = result.FAILURE;
+  ScopedStageTimer solve_timer(metrics_, PlannerMetrics::SOLVE);
+  if (metrics_)
+    metrics_->increment(PlannerMetrics::REQUESTS);
 
   // this should always be satisfied since getPlanningContext() would have failed otherwise
   if (!configured_)
@@ -94,140 +164,95 @@ moveit_msgs::MoveItErrorCodes RTRPlanningContext::solve(robot_trajectory::RobotT
 
   // extract RapidPlanGoals;
   addDetailedTime("init goal states", start_time_);
-  if (!initRapidPlanGoals(request_.goal_constraints, goals_))
+  bool goals_success;
+  {
+    ScopedStageTimer timer(metrics_, PlannerMetrics::GOAL_SAMPLING);
+    goals_success = initRapidPlanGoals(request_.goal_constraints, goals_);
+  }
+  if (checkPreempted(result) || !goals_success)
     return result;
 
   // prepare collision scene
   addDetailedTime("generate occupancy", ros::Time::now());
-  OccupancyData occupancy_data;
+  // the occupancy buffers of the previous request are reused, so the grid is only allocated if the volume changes
+  OccupancyData& occupancy_data = occupancy_data_;
   bool occupancy_success;
-  if (occupancy_source_ == "POINT_CLOUD")
-    occupancy_success = occupancy_handler_->fromPointCloud(occupancy_data, getRemainingPlanningTime());
-  else
-    occupancy_success = occupancy_handler_->fromPlanningScene(planning_scene_, occupancy_data);
-  if (!occupancy_success)
+  {
+    ScopedStageTimer timer(metrics_, PlannerMetrics::OCCUPANCY);
+    if (occupancy_source_ == "POINT_CLOUD")
+      occupancy_success = occupancy_handler_->fromPointCloud(roadmap_.volume, occupancy_data,
+                                                             getRemainingPlanningTime(), &terminated_);
+    else if (occupancy_source_ == "FUSION")
+      occupancy_success = occupancy_handler_->fromFusedSources(planning_scene_, roadmap_.volume, occupancy_data,
+                                                               getRemainingPlanningTime(), &terminated_);
+    else
+      occupancy_success =
+          occupancy_handler_->fromPlanningScene(planning_scene_, roadmap_.volume, occupancy_data, &terminated_);
+  }
+  if (checkPreempted(result) || !occupancy_success)
     return result;
 
   // initialize start state
   addDetailedTime("init start state", ros::Time::now());
   std::size_t start_state_id;
-  if (!initStartState(start_state_id))
+  bool start_state_success;
+  {
+    ScopedStageTimer timer(metrics_, PlannerMetrics::START_STATE);
+    start_state_success = initStartState(start_state_id);
+  }
+  if (!start_state_success || checkPreempted(result))
     return result;
 
-  // Iterate goals and plan until we have a solution
+  // check collisions of the roadmap once, the result is used for all goals
+  addDetailedTime("check scene", ros::Time::now());
+  RoadmapCollisions roadmap_collisions;
+  bool check_scene_success;
+  {
+    ScopedStageTimer timer(metrics_, PlannerMetrics::CHECK_SCENE);
+    check_scene_success = planner_interface_->checkScene(roadmap_, occupancy_data, roadmap_collisions);
+  }
+  if (!check_scene_success || checkPreempted(result))
+    return result;
+
+  // search paths to all goals, then accept the cheapest one that connects to start and goal states
   addDetailedTime("plan", ros::Time::now());
   result.val = result.PLANNING_FAILED;
-  std::vector<rtr::Config> states;
+  std::vector<GoalCandidate> candidates;
+  {
+    ScopedStageTimer timer(metrics_, PlannerMetrics::GOAL_SEARCH);
+    findGoalCandidates(roadmap_collisions, start_state_id, candidates);
+  }
   std::deque<std::size_t> waypoints;
-  std::deque<std::size_t> edges;
-  for (std::size_t goal_pos = 0; goal_pos < goals_.size(); goal_pos++)
+  std::size_t accepted = 0;
+  ros::Time process_solution_time = ros::Time::now();
+  bool connect_success = false;
+  if (!candidates.empty())
   {
-    // check time
-    double timeout = getRemainingPlanningTime() * 1000;  // seconds -> milliseconds
-    if (timeout <= 0.0)
-    {
-      result.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
-      break;
-    }
-    // run plan
-    const RapidPlanGoal& goal = goals_[goal_pos];
-    states.clear();
-    waypoints.clear();
-    edges.clear();
-    if (planner_interface_->solve(roadmap_, start_state_id, goal, occupancy_data, timeout, states, waypoints, edges))
-    {
-      if (waypoints.empty())
-      {
-        ROS_WARN_NAMED(LOGNAME, "Cannot convert empty path to robot trajectory");
-        continue;
-      }
-
-      // fill solution path
-      std::vector<rtr::Config> solution_path;
-      for (std::size_t waypoint : waypoints)
-        solution_path.push_back(roadmap_configs_[waypoint]);
-
-      // convert solution path to robot trajectory
-      ros::Time process_solution_time = ros::Time::now();
-      const robot_state::RobotState& reference_state = planning_scene_->getCurrentState();
-      trajectory.reset(new robot_trajectory::RobotTrajectory(reference_state.getRobotModel(), group_));
-      processSolutionPath(solution_path, reference_state, joint_model_names_, *trajectory);
-
-      // connect start state waypoint
-      if (!connectWaypointToTrajectory(trajectory, start_state_, true))
-      {
-        ROS_WARN_NAMED(LOGNAME, "Found collisions trying to connect the requested start state to the solution path");
-        continue;
-      }
-
-      // connect goal state waypoint
-      if (goal_states_[goal_pos])
-      {
-        if (!connectWaypointToTrajectory(trajectory, goal_states_[goal_pos]))
-        {
-          ROS_WARN_NAMED(LOGNAME, "Found collisions trying to connect the goal state to the solution path");
-          continue;
-        }
-      }
-      // plan successful
-      addDetailedTime("process solution", process_solution_time);
-      result.val = result.SUCCESS;
-      break;
-    }
+    ScopedStageTimer timer(metrics_, PlannerMetrics::CONNECT);
+    connect_success = connectGoalCandidates(candidates, trajectory, accepted);
   }
-  if (visualization_enabled_)
-    visualizePlanContext(occupancy_data, waypoints, result.val == result.SUCCESS);
-  addDetailedTime("done", ros::Time::now());
-  return result;
-}
-
-void RTRPlanningContext::visualizePlanContext(const OccupancyData& occupancy_data,
-                                              const std::deque<std::size_t>& waypoint_ids, bool plan_success)
-{
-  // visualize volume region
-  visualization_->visualizeVolumeRegion(roadmap_.volume);
-
-  // visualize voxels
-  // TODO(henningkayser): visualize all kinds of occupancy data
-  if (occupancy_data.type == OccupancyData::Type::VOXELS)
-    visualization_->visualizeOccupancy(roadmap_.volume, occupancy_data);
-
-  // visualize roadmap states
-  std::vector<geometry_msgs::Point> poses(roadmap_poses_.size());
-  for (std::size_t i = 0; i < roadmap_poses_.size(); ++i)
+  if (candidates.empty())
   {
-    poses[i].x = roadmap_poses_[i][0];
-    poses[i].y = roadmap_poses_[i][1];
-    poses[i].z = roadmap_poses_[i][2];
+    if (!checkPreempted(result) && getRemainingPlanningTime() <= 0.0)
+      result.val = moveit_msgs::MoveItErrorCodes::TIMED_OUT;
   }
-
-  // visualize roadmap edges
-  std::vector<geometry_msgs::Point> edges(2 * roadmap_edges_.size());
-  for (std::size_t i = 0; i < roadmap_edges_.size(); ++i)
+  else if (connect_success)
   {
-    edges[2 * i].x = roadmap_poses_[roadmap_edges_[i].start_index][0];
-    edges[2 * i].y = roadmap_poses_[roadmap_edges_[i].start_index][1];
-    edges[2 * i].z = roadmap_poses_[roadmap_edges_[i].start_index][2];
-    edges[2 * i + 1].x = roadmap_poses_[roadmap_edges_[i].end_index][0];
-    edges[2 * i + 1].y = roadmap_poses_[roadmap_edges_[i].end_index][1];
-    edges[2 * i + 1].z = roadmap_poses_[roadmap_edges_[i].end_index][2];
+    // plan successful
+    addDetailedTime("process solution", process_solution_time);
+    waypoints = candidates[accepted].waypoints;
+    result.val = result.SUCCESS;
+    if (metrics_)
+      metrics_->increment(PlannerMetrics::SUCCESSFUL_REQUESTS);
   }
-  geometry_msgs::Pose pose;
-  pose.orientation.w = 1.0;
-  visualization_->visualizeRoadmap(roadmap_.base_link_frame, pose, poses, edges);
-
-  // visualize solution
-  if (plan_success)
+  else
   {
-    std::vector<geometry_msgs::Point> solution_poses(waypoint_ids.size());
-    for (std::size_t i = 0; i < waypoint_ids.size(); ++i)
-    {
-      solution_poses[i].x = roadmap_poses_[waypoint_ids[i]][0];
-      solution_poses[i].y = roadmap_poses_[waypoint_ids[i]][1];
-      solution_poses[i].z = roadmap_poses_[waypoint_ids[i]][2];
-    }
-    visualization_->visualizeSolutionPath(roadmap_.base_link_frame, pose, solution_poses);
+    checkPreempted(result);
   }
+  if (visualization_enabled_)
+    visualization_->visualizePlanContext(roadmap_data_, occupancy_data, waypoints, result.val == result.SUCCESS);
+  addDetailedTime("done", ros::Time::now());
+  return result;
 }
 
 bool RTRPlanningContext::solve(planning_interface::MotionPlanResponse& res)
@@ -255,51 +280,189 @@ bool RTRPlanningContext::solve(planning_interface::MotionPlanDetailedResponse& r
   return res.error_code_.val == res.error_code_.SUCCESS;
 }
 
+void RTRPlanningContext::findGoalCandidates(const RoadmapCollisions& roadmap_collisions,
+                                            const std::size_t start_state_id, std::vector<GoalCandidate>& candidates)
+{
+  std::vector<GoalCandidate> goal_results(goals_.size());
+  std::vector<uint8_t> found(goals_.size(), false);  // not std::vector<bool>, written concurrently
+  parallelFor(goals_.size(), goal_evaluation_threads_, [&](std::size_t goal_pos) {
+    // check time
+    double timeout = getRemainingPlanningTime() * 1000;  // seconds -> milliseconds
+    if (timeout <= 0.0)
+      return;
+    GoalCandidate& candidate = goal_results[goal_pos];
+    std::deque<std::size_t> edges;
+    if (!planner_interface_->findPath(roadmap_collisions, start_state_id, goals_[goal_pos], timeout,
+                                      candidate.solution_path, candidate.waypoints, edges))
+      return;
+    if (candidate.waypoints.empty())
+    {
+      ROS_WARN_NAMED(LOGNAME, "Cannot convert empty path to robot trajectory");
+      return;
+    }
+    candidate.goal_pos = goal_pos;
+    candidate.cost = 0.0;
+    for (std::size_t i = 1; i < candidate.solution_path.size(); ++i)
+      candidate.cost += getConfigDistance(candidate.solution_path[i - 1], candidate.solution_path[i]);
+    found[goal_pos] = true;
+  });
+
+  candidates.clear();
+  for (std::size_t goal_pos = 0; goal_pos < goals_.size(); ++goal_pos)
+    if (found[goal_pos])
+      candidates.push_back(std::move(goal_results[goal_pos]));
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const GoalCandidate& a, const GoalCandidate& b) { return a.cost < b.cost; });
+}
+
+bool RTRPlanningContext::connectGoalCandidates(const std::vector<GoalCandidate>& candidates,
+                                               robot_trajectory::RobotTrajectoryPtr& trajectory,
+                                               std::size_t& accepted)
+{
+  // candidates more expensive than the best connected one are cancelled
+  std::atomic<std::size_t> best(candidates.size());
+  std::unique_ptr<std::atomic<bool>[]> cancelled(new std::atomic<bool>[candidates.size()]);
+  for (std::size_t i = 0; i < candidates.size(); ++i)
+    cancelled[i] = false;
+  std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories(candidates.size());
+  const robot_state::RobotState& reference_state = planning_scene_->getCurrentState();
+
+  parallelFor(candidates.size(), goal_evaluation_threads_, [&](std::size_t i) {
+    if (cancelled[i])
+      return;
+    const GoalCandidate& candidate = candidates[i];
+
+    // convert solution path to robot trajectory
+    robot_trajectory::RobotTrajectoryPtr candidate_trajectory(
+        new robot_trajectory::RobotTrajectory(reference_state.getRobotModel(), group_));
+    processSolutionPath(candidate.solution_path, reference_state, *candidate_trajectory);
+
+    // connect start state waypoint
+    if (!connectWaypointToTrajectory(candidate_trajectory, start_state_, true, &cancelled[i]))
+    {
+      if (!cancelled[i])
+        ROS_WARN_NAMED(LOGNAME, "Found collisions trying to connect the requested start state to the solution path");
+      return;
+    }
+
+    // connect goal state waypoint
+    const robot_state::RobotStatePtr& goal_state = goal_states_[candidate.goal_pos];
+    if (goal_state && !connectWaypointToTrajectory(candidate_trajectory, goal_state, false, &cancelled[i]))
+    {
+      if (!cancelled[i])
+        ROS_WARN_NAMED(LOGNAME, "Found collisions trying to connect the goal state to the solution path");
+      return;
+    }
+
+    // accept the candidate if no cheaper one has been accepted and cancel all more expensive ones
+    trajectories[i] = candidate_trajectory;
+    std::size_t current_best = best;
+    while (i < current_best && !best.compare_exchange_weak(current_best, i))
+      ;
+    for (std::size_t j = i + 1; j < candidates.size(); ++j)
+      cancelled[j] = true;
+  });
+
+  accepted = best;
+  if (accepted == candidates.size())
+    return false;
+  trajectory = trajectories[accepted];
+  return true;
+}
+
 void RTRPlanningContext::processSolutionPath(const std::vector<rtr::Config>& solution_path,
                                              const robot_state::RobotState& reference_state,
-                                             const std::vector<std::string>& joint_names,
                                              robot_trajectory::RobotTrajectory& trajectory)
 {
-  ROS_ASSERT_MSG(joint_names.size() == solution_path[0].size(), "Joint values don't match joint names");
+  ROS_ASSERT_MSG(joint_models_.size() == solution_path[0].size(), "Joint values don't match joint names");
+  std::vector<double> joint_positions(joint_models_.size());
   for (const rtr::Config& joint_config : solution_path)
   {
-    robot_state::RobotStatePtr robot_state(new robot_state::RobotState(reference_state));
-    for (std::size_t i = 0; i < joint_names.size(); i++)
-      robot_state->setJointPositions(joint_names[i], { (double)joint_config[i] });
+    std::copy(joint_config.begin(), joint_config.end(), joint_positions.begin());
+    robot_state::RobotStatePtr robot_state = std::make_shared<robot_state::RobotState>(reference_state);
+    if (use_group_positions_)
+    {
+      robot_state->setJointGroupPositions(jmg_, joint_positions);
+    }
+    else
+    {
+      for (std::size_t i = 0; i < joint_models_.size(); ++i)
+        robot_state->setJointPositions(joint_models_[i], &joint_positions[i]);
+    }
     trajectory.addSuffixWayPoint(robot_state, 0.1);
   }
 }
 
 bool RTRPlanningContext::connectWaypointToTrajectory(const robot_trajectory::RobotTrajectoryPtr& trajectory,
                                                      const robot_state::RobotStatePtr& waypoint_state,
-                                                     bool connect_to_front)
+                                                     bool connect_to_front, const std::atomic<bool>* cancelled)
 {
   robot_state::RobotState connecting_state(trajectory->getLastWayPoint());
   if (connect_to_front)
     connecting_state = trajectory->getFirstWayPoint();
 
-  // check collisions of intermediate states and the waypoint state itself
-  robot_state::RobotState intermediate_state(connecting_state);
+  // check collisions of intermediate states and the waypoint state itself in bisection order,
+  // workers stop as soon as any step collides or the connection is cancelled
   double waypoint_distance = connecting_state.distance(*waypoint_state);
   std::size_t step_count = std::abs(waypoint_distance / max_waypoint_distance_) + 1;
   double step_fraction = 1.0 / step_count;
-  for (std::size_t step = 0; step <= step_count; ++step)
-  {
-    connecting_state.interpolate(*waypoint_state, step * step_fraction, intermediate_state);
-    if (planning_scene_->isStateColliding(intermediate_state))
-      return false;
-  }
+  const std::vector<std::size_t> steps = getBisectionOrder(step_count);
+  std::atomic<std::size_t> next_step(0);
+  std::atomic<bool> failed(false);
+  auto check_steps = [&](std::size_t) {
+    robot_state::RobotState intermediate_state(connecting_state);
+    for (std::size_t i = next_step++; i < steps.size() && !failed; i = next_step++)
+    {
+      if ((cancelled && *cancelled) || terminated_)
+      {
+        failed = true;
+        return;
+      }
+      connecting_state.interpolate(*waypoint_state, steps[i] * step_fraction, intermediate_state);
+      if (planning_scene_->isStateColliding(intermediate_state))
+        failed = true;
+    }
+  };
+  const std::size_t num_threads = std::min(connection_check_threads_, steps.size());
+  parallelFor(num_threads, num_threads, check_steps);
+  if (failed)
+    return false;
+
+  // the last interpolation step is the waypoint state itself
   if (connect_to_front)
-    trajectory->addPrefixWayPoint(intermediate_state, 0.0);
+    trajectory->addPrefixWayPoint(*waypoint_state, 0.0);
   else
-    trajectory->addSuffixWayPoint(intermediate_state, 0.0);
+    trajectory->addSuffixWayPoint(*waypoint_state, 0.0);
   return true;
 }
 
 void RTRPlanningContext::configure(moveit_msgs::MoveItErrorCodes& error_code)
 {
   error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+  terminated_ = false;
 
+  // planning scene should be set
+  if (!planning_scene_)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Cannot configure planning context while planning scene has not been set");
+    return;
+  }
+
+  // parameters, joint model group and roadmap data are kept if the context is reused with the same robot model
+  if (!configured_ || &jmg_->getParentModel() != planning_scene_->getRobotModel().get())
+  {
+    configured_ = false;
+    if (!loadConfiguration())
+      return;
+  }
+
+  // done
+  error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+  configured_ = true;
+}
+
+bool RTRPlanningContext::loadConfiguration()
+{
   // load defult planner parameters
   // TODO(RTR-56): support overloading defaults
   ros::NodeHandle nh("~");
@@ -312,114 +475,93 @@ void RTRPlanningContext::configure(moveit_msgs::MoveItErrorCodes& error_code)
   if (error)
   {
     ROS_ERROR_NAMED(LOGNAME, "Planning Context could not be configured due to missing params");
-    return;
+    return false;
   }
 
   // read occupancy parameters
   nh.param("planner_config/occupancy_source", occupancy_source_, std::string("PLANNING_SCENE"));
   nh.param("planner_config/visualization_enabled", visualization_enabled_, false);
+  int goal_evaluation_threads = nh.param("planner_config/goal_evaluation_threads", 4);
+  goal_evaluation_threads_ =
+      goal_evaluation_threads > 0 ? goal_evaluation_threads : std::max(1u, std::thread::hardware_concurrency());
+  nh.param("planner_config/use_tool_pose_goals", use_tool_pose_goals_, false);
+  int connection_check_threads = nh.param("planner_config/connection_check_threads", 1);
+  connection_check_threads_ =
+      connection_check_threads > 0 ? connection_check_threads : std::max(1u, std::thread::hardware_concurrency());
+  int goal_sampling_threads = nh.param("planner_config/goal_sampling_threads", 1);
+  goal_sampling_threads_ =
+      goal_sampling_threads > 0 ? goal_sampling_threads : std::max(1u, std::thread::hardware_concurrency());
+  nh.param("planner_config/max_goal_samples", max_goal_samples_, 0);
+  nh.param("planner_config/goal_sample_matches", goal_sample_matches_, 1);
+  if (goal_sample_matches_ < 1)
+  {
+    ROS_WARN_STREAM_NAMED(LOGNAME, "Parameter 'goal_sample_matches' must be at least 1, but is set to "
+                                       << goal_sample_matches_ << ". Proceeding with default 1.");
+    goal_sample_matches_ = 1;
+  }
   if (occupancy_source_ != "PLANNING_SCENE")
   {
-    if (occupancy_source_ != "POINT_CLOUD")
+    if (occupancy_source_ != "POINT_CLOUD" && occupancy_source_ != "FUSION")
     {
       ROS_WARN_STREAM_NAMED(LOGNAME, "Occupancy source is set to unknown type '"
                                          << occupancy_source_ << "'. Proceeding with default 'PLANNING_SCENE'.");
       occupancy_source_ = "PLANNING_SCENE";
     }
-    else if (!nh.getParam("planner_config/pcl_topic", pcl_topic_))
+    else if (occupancy_source_ == "POINT_CLOUD" && !nh.getParam("planner_config/pcl_topic", pcl_topic_))
     {
       ROS_ERROR_NAMED(LOGNAME, "Occupancy source 'POINT_CLOUD' cannot be configured without parameter 'pcl_topic'");
-      return;
+      return false;
     }
   }
 
-  // planning scene should be set
-  if (!planning_scene_)
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Cannot configure planning context while planning scene has not been set");
-    return;
-  }
-
   // get joint model group
   jmg_ = planning_scene_->getCurrentState().getJointModelGroup(group_);
   joint_model_names_ = jmg_->getActiveJointModelNames();
 
+  // resolve joint models once, roadmap configs can be written as group positions if they match the group variables
+  joint_models_.clear();
+  for (const std::string& joint_name : joint_model_names_)
+    joint_models_.push_back(jmg_->getJointModel(joint_name));
+  use_group_positions_ = jmg_->getVariableCount() == joint_models_.size();
+
   // check planner interface
   if (!planner_interface_->isReady() && !planner_interface_->initialize())
-    return;
+    return false;
 
-  // read roadmap data from .og file
-  og_file_.reset(new rtr::OGFileReader(roadmap_.og_file));
-  if (!og_file_->IsValid())
+  // get roadmap data from the shared cache, the .og file is only read on first use
+  if (!roadmap_cache_ || !roadmap_cache_->getRoadmapData(roadmap_, roadmap_data_))
   {
-    ROS_ERROR_STREAM_NAMED(LOGNAME, "Roadmap file invalid " << roadmap_.og_file << "'");
-    return;
-  }
-
-  // get roadmap configs
-  if (!og_file_->GetConfigs(roadmap_configs_) || roadmap_configs_.empty())
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load config states from roadmap file");
-    return;
+    ROS_ERROR_STREAM_NAMED(LOGNAME, "Unable to load roadmap '" << roadmap_.roadmap_id << "'");
+    return false;
   }
+  // the cached roadmap data is shared by all groups, so only the fields read from the roadmap file are copied
+  roadmap_.volume = roadmap_data_->spec.volume;
+  roadmap_.base_link_frame = roadmap_data_->spec.base_link_frame;
+  roadmap_.end_effector_frame = roadmap_data_->spec.end_effector_frame;
 
   // check if joint dimension in roadmap fits to joint model group
-  if (roadmap_configs_[0].size() != joint_model_names_.size())
+  if (roadmap_data_->dimension != joint_model_names_.size())
   {
     ROS_ERROR_NAMED(LOGNAME, "Roadmap state dimension does not fit to joint count of planning group");
-    return;
-  }
-
-  // get roadmap poses
-  if (!og_file_->GetPoses(roadmap_poses_) || roadmap_poses_.empty())
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load state poses from roadmap file");
-    return;
-  }
-
-  // get roadmap edges
-  if (!og_file_->GetEdges(roadmap_edges_) || roadmap_edges_.empty())
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load state edges from roadmap file");
-    return;
-  }
-
-  // load occupancy region volume
-  rtr::ToolPose volume_center_pose;
-  if (!og_file_->GetVoxelRegion(roadmap_.volume.pose.header.frame_id, volume_center_pose, roadmap_.volume.dimension))
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Unable to load voxel region from roadmap file");
-    return;
-  }
-  roadmap_.volume.pose.pose.position.x = volume_center_pose[0];
-  roadmap_.volume.pose.pose.position.y = volume_center_pose[1];
-  roadmap_.volume.pose.pose.position.z = volume_center_pose[2];
-  roadmap_.volume.pose.pose.orientation =
-      tf::createQuaternionMsgFromRollPitchYaw(volume_center_pose[3], volume_center_pose[4], volume_center_pose[5]);
-  roadmap_.volume.pose.header.frame_id = "world";  // NOTE: GetVoxelRegion returns an empty frame - we fix this here
-  if (!og_file_->GetResolution(roadmap_.volume.voxel_resolution))
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Failed to read volume voxel resolution from roadmap file");
-    return;
+    return false;
   }
-  std::array<float, 6> start_link_transform;
-  if (!og_file_->GetKinematicData(start_link_transform, roadmap_.base_link_frame, roadmap_.end_effector_frame))
-  {
-    ROS_ERROR_NAMED(LOGNAME, "Failed to read kinematic data roadmap file");
-    return;
-  }
-
-  occupancy_handler_->setVolumeRegion(roadmap_.volume);
-
-  // done
-  error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
-  configured_ = true;
+  return true;
 }
 
 bool RTRPlanningContext::initRapidPlanGoals(const std::vector<moveit_msgs::Constraints>& goal_constraints,
                                             std::vector<RapidPlanGoal>& goals)
 {
   bool success = false;
+  goals.clear();
+  goal_states_.clear();
+
+  // samplers hold the planning scene, so they are only reused for the same scene
+  if (goal_sampler_scene_ != planning_scene_)
+  {
+    goal_samplers_.clear();
+    goal_sampler_scene_ = planning_scene_;
+  }
+  goal_samplers_.resize(goal_sampling_threads_);
   for (const moveit_msgs::Constraints& goal_constraint : goal_constraints)
   {
     RapidPlanGoal goal;
@@ -440,58 +582,171 @@ bool RTRPlanningContext::initRapidPlanGoals(const std::vector<moveit_msgs::Const
   return success;
 }
 
-bool RTRPlanningContext::getRapidPlanGoal(const moveit_msgs::Constraints& goal_constraint, RapidPlanGoal& goal,
-                                          robot_state::RobotStatePtr& goal_state)
+constraint_samplers::ConstraintSamplerPtr
+RTRPlanningContext::createGoalSampler(const moveit_msgs::Constraints& goal_constraint, GoalSamplers& goal_samplers)
 {
-  goal.type = RapidPlanGoal::Type::STATE_IDS;
-
-  // initialize constraint samplers
+  // initialize constraint samplers, samplers are created once and only reconfigured for new constraints
   std::vector<constraint_samplers::ConstraintSamplerPtr> samplers;
   // joint constraint
   if (!goal_constraint.joint_constraints.empty())
   {
     // joint state sampler
-    constraint_samplers::JointConstraintSamplerPtr joint_sampler(
-        new constraint_samplers::JointConstraintSampler(planning_scene_, group_));
-    joint_sampler->configure(goal_constraint);
-    samplers.push_back(joint_sampler);
+    if (!goal_samplers.joint_sampler)
+      goal_samplers.joint_sampler.reset(new constraint_samplers::JointConstraintSampler(planning_scene_, group_));
+    goal_samplers.joint_sampler->configure(goal_constraint);
+    samplers.push_back(goal_samplers.joint_sampler);
   }
   // position/orientation constraint
   if (!goal_constraint.position_constraints.empty() || !goal_constraint.orientation_constraints.empty())
   {
     // IK sampler
-    constraint_samplers::IKConstraintSamplerPtr ik_sampler(
-        new constraint_samplers::IKConstraintSampler(planning_scene_, group_));
-    ik_sampler->configure(goal_constraint);
-    samplers.push_back(ik_sampler);
+    if (!goal_samplers.ik_sampler)
+      goal_samplers.ik_sampler.reset(new constraint_samplers::IKConstraintSampler(planning_scene_, group_));
+    goal_samplers.ik_sampler->configure(goal_constraint);
+    samplers.push_back(goal_samplers.ik_sampler);
   }
+  return std::make_shared<constraint_samplers::UnionConstraintSampler>(planning_scene_, group_, samplers);
+}
 
-  // sample goal from roadmap states
-  constraint_samplers::UnionConstraintSampler union_sampler(planning_scene_, group_, samplers);
-  const robot_state::RobotState& robot_state = planning_scene_->getCurrentState();
-  robot_state::RobotState sample_state(robot_state);
-  std::vector<double> joint_positions(jmg_->getActiveJointModels().size());
-  rtr::Config sample_config(joint_positions.size());
-  std::vector<float> distances;
-  while (ros::Time::now() < terminate_plan_time_)
-  {
-    if (!union_sampler.sample(sample_state, robot_state, 100))
-      continue;
-    sample_state.copyJointGroupPositions(group_, joint_positions);
-    // copy joint values to rtr::Config
-    std::transform(std::begin(joint_positions), std::end(joint_positions), std::begin(sample_config),
-                   [](double d) -> float { return float(d); });
-    // search for goal state candidates within allowed joint distance
-    // TODO(RTR-7): (pre-)filter by allowed position distance
-    findClosestConfigs(sample_config, roadmap_configs_, goal.state_ids, distances, max_goal_states_,
-                       allowed_joint_distance_);
-    if (!goal.state_ids.empty())
+bool RTRPlanningContext::getRapidPlanGoal(const moveit_msgs::Constraints& goal_constraint, RapidPlanGoal& goal,
+                                          robot_state::RobotStatePtr& goal_state)
+{
+  // end effector pose constraints are passed to the PathPlanner without sampling
+  if (use_tool_pose_goals_ && isToolPoseConstraint(goal_constraint))
+    return getToolPoseGoal(goal_constraint, goal, goal_state);
+
+  goal.type = RapidPlanGoal::Type::STATE_IDS;
+  goal.state_ids.clear();
+
+  // sample goal from roadmap states, the sample with the closest roadmap state is used
+  std::mutex goal_mutex;
+  float goal_distance = FLT_MAX;
+  std::atomic<int> num_samples(0);
+  std::atomic<int> num_matches(0);
+  auto sample_goal = [&](std::size_t thread_id) {
+    // samplers and states are thread-local, only the roadmap index is shared
+    constraint_samplers::ConstraintSamplerPtr sampler = createGoalSampler(goal_constraint, goal_samplers_[thread_id]);
+    const robot_state::RobotState& robot_state = planning_scene_->getCurrentState();
+    robot_state::RobotState sample_state(robot_state);
+    std::vector<double> joint_positions(jmg_->getActiveJointModels().size());
+    rtr::Config sample_config(joint_positions.size());
+    std::vector<std::size_t> state_ids;
+    std::vector<float> distances;
+    while (num_matches < goal_sample_matches_ && (max_goal_samples_ <= 0 || num_samples++ < max_goal_samples_) &&
+           getRemainingPlanningTime() > 0.0)
     {
-      goal_state = std::make_shared<robot_state::RobotState>(sample_state);
-      return true;
+      if (!sampler->sample(sample_state, robot_state, 100))
+        continue;
+      sample_state.copyJointGroupPositions(group_, joint_positions);
+      // copy joint values to rtr::Config
+      std::transform(std::begin(joint_positions), std::end(joint_positions), std::begin(sample_config),
+                     [](double d) -> float { return float(d); });
+      // search for goal state candidates within allowed joint distance
+      // TODO(RTR-7): (pre-)filter by allowed position distance
+      roadmap_data_->config_index.findClosest(sample_config, state_ids, distances, max_goal_states_,
+                                              allowed_joint_distance_);
+      if (state_ids.empty())
+        continue;
+      ++num_matches;
+      std::lock_guard<std::mutex> lock(goal_mutex);
+      if (distances[0] < goal_distance)
+      {
+        goal_distance = distances[0];
+        goal.state_ids = state_ids;
+        goal_state = std::make_shared<robot_state::RobotState>(sample_state);
+      }
     }
+  };
+  parallelFor(goal_sampling_threads_, goal_sampling_threads_, sample_goal);
+  return !goal.state_ids.empty();
+}
+
+bool RTRPlanningContext::isToolPoseConstraint(const moveit_msgs::Constraints& goal_constraint) const
+{
+  if (!goal_constraint.joint_constraints.empty() || goal_constraint.position_constraints.size() != 1 ||
+      goal_constraint.orientation_constraints.size() > 1)
+    return false;
+  const moveit_msgs::PositionConstraint& position_constraint = goal_constraint.position_constraints[0];
+  const geometry_msgs::Vector3& offset = position_constraint.target_point_offset;
+  if (position_constraint.link_name != roadmap_.end_effector_frame || offset.x != 0.0 || offset.y != 0.0 ||
+      offset.z != 0.0 || position_constraint.constraint_region.primitive_poses.size() != 1 ||
+      position_constraint.constraint_region.primitives.size() != 1)
+    return false;
+  double position_tolerance;
+  if (!getRegionTolerance(position_constraint.constraint_region.primitives[0], position_tolerance))
+  {
+    ROS_DEBUG_NAMED(LOGNAME, "Position constraint region is not supported for tool pose goals");
+    return false;
   }
-  return false;
+  return goal_constraint.orientation_constraints.empty() ||
+         goal_constraint.orientation_constraints[0].link_name == roadmap_.end_effector_frame;
+}
+
+bool RTRPlanningContext::getToolPoseGoal(const moveit_msgs::Constraints& goal_constraint, RapidPlanGoal& goal,
+                                         robot_state::RobotStatePtr& goal_state)
+{
+  const moveit_msgs::PositionConstraint& position_constraint = goal_constraint.position_constraints[0];
+  const shape_msgs::SolidPrimitive& region = position_constraint.constraint_region.primitives[0];
+
+  // position tolerance of a sphere that fits inside the constraint region independent of its orientation
+  double position_tolerance;
+  if (!getRegionTolerance(region, position_tolerance))
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Position constraint region is not supported for tool pose goals");
+    return false;
+  }
+
+  // target position and orientation in the roadmap base frame
+  // we use auto to support Affine3d and Isometry3d (kinetic + melodic)
+  auto world_to_base = planning_scene_->getFrameTransform(roadmap_.base_link_frame);
+  auto world_to_position_frame = planning_scene_->getFrameTransform(position_constraint.header.frame_id);
+  Eigen::Vector3d position;
+  tf::pointMsgToEigen(position_constraint.constraint_region.primitive_poses[0].position, position);
+  Eigen::Vector3d base_position = world_to_base.inverse() * (world_to_position_frame * position);
+  Eigen::Matrix3d base_orientation = Eigen::Matrix3d::Identity();
+  rtr::ToolPose orientation_tolerance = { { 0, 0, 0, M_PI, M_PI, M_PI } };
+  rtr::ToolPose orientation_weights = { { 0, 0, 0, 0, 0, 0 } };
+  if (!goal_constraint.orientation_constraints.empty())
+  {
+    const moveit_msgs::OrientationConstraint& orientation_constraint = goal_constraint.orientation_constraints[0];
+    auto world_to_orientation_frame = planning_scene_->getFrameTransform(orientation_constraint.header.frame_id);
+    Eigen::Quaterniond orientation;
+    tf::quaternionMsgToEigen(orientation_constraint.orientation, orientation);
+    base_orientation =
+        world_to_base.linear().transpose() * world_to_orientation_frame.linear() * orientation.toRotationMatrix();
+    orientation_tolerance = { { 0, 0, 0, float(orientation_constraint.absolute_x_axis_tolerance),
+                                float(orientation_constraint.absolute_y_axis_tolerance),
+                                float(orientation_constraint.absolute_z_axis_tolerance) } };
+    orientation_weights = { { 0, 0, 0, 1, 1, 1 } };
+  }
+
+  // roadmap tool poses are stored as x/y/z and roll/pitch/yaw, the per-axis position tolerance spans a cube that fits
+  // inside the tolerance sphere
+  double roll, pitch, yaw;
+  getRollPitchYaw(base_orientation, roll, pitch, yaw);
+  goal.type = RapidPlanGoal::Type::TOOL_POSE;
+  goal.state_ids.clear();
+  goal.tool_pose = { { float(base_position.x()), float(base_position.y()), float(base_position.z()), float(roll),
+                       float(pitch), float(yaw) } };
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    goal.tolerance[i] = position_tolerance / std::sqrt(3.0);
+    goal.weights[i] = 1.0;
+    goal.tolerance[i + 3] = orientation_tolerance[i + 3];
+    goal.weights[i + 3] = orientation_weights[i + 3];
+  }
+  goal_state.reset();
+
+  // fail fast if no roadmap state is within the position tolerance
+  std::vector<std::size_t> pose_ids;
+  std::vector<float> pose_distances;
+  roadmap_data_->pose_index.findClosest(goal.tool_pose, pose_ids, pose_distances, 1, position_tolerance);
+  if (pose_ids.empty())
+  {
+    ROS_WARN_NAMED(LOGNAME, "No roadmap state is within the position tolerance of the tool pose goal");
+    return false;
+  }
+  return true;
 }
 
 bool RTRPlanningContext::initStartState(std::size_t& start_state_id)
@@ -528,7 +783,10 @@ bool RTRPlanningContext::initStartState(std::size_t& start_state_id)
   }
 
   // search for start state candidate in roadmap
-  int result_id = findClosestConfigId(start_config, roadmap_configs_, allowed_joint_distance_);
+  std::vector<std::size_t> result_ids;
+  std::vector<float> result_distances;
+  roadmap_data_->config_index.findClosest(start_config, result_ids, result_distances, 1, allowed_joint_distance_);
+  int result_id = result_ids.empty() ? -1 : result_ids[0];
   if (result_id < 0)
     ROS_ERROR_NAMED(LOGNAME, "Unable to find a start state candidate in the roadmap within the allowed joint distance");
   start_state_id = result_id;
@@ -543,23 +801,52 @@ void RTRPlanningContext::addDetailedTime(const std::string& description, const r
 
 double RTRPlanningContext::getRemainingPlanningTime()
 {
+  // no time is left after termination, this also stops graph searches from being started
+  if (terminated_)
+    return 0.0;
   return (terminate_plan_time_ - ros::Time::now()).toSec();
 }
 
+bool RTRPlanningContext::checkPreempted(moveit_msgs::MoveItErrorCodes& error_code)
+{
+  if (!terminated_)
+    return false;
+  ROS_INFO_NAMED(LOGNAME, "Planning attempt has been terminated");
+  error_code.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+  if (metrics_)
+    metrics_->increment(PlannerMetrics::PREEMPTED_REQUESTS);
+  return true;
+}
+
 void RTRPlanningContext::setOccupancyHandler(std::shared_ptr<OccupancyHandler> occupancy_handler)
 {
   occupancy_handler_ = occupancy_handler;
 }
 
+void RTRPlanningContext::setRoadmapCache(const RoadmapCachePtr& roadmap_cache)
+{
+  roadmap_cache_ = roadmap_cache;
+}
+
+void RTRPlanningContext::setPlannerMetrics(const PlannerMetricsPtr& metrics)
+{
+  metrics_ = metrics;
+}
+
 void RTRPlanningContext::clear()
 {
-  // TODO(henningkayser): implement and support reusing planning contexts
+  // parameters, roadmap data and samplers are kept for the next request
+  goals_.clear();
+  goal_states_.clear();
+  start_state_.reset();
+  detailed_times_.clear();
+  terminated_ = false;
 }
 
 bool RTRPlanningContext::terminate()
 {
-  // RapidPlan does not support this right now
-  ROS_WARN_STREAM_NAMED(LOGNAME, "Failed to terminate the planning attempt! This is not supported.");
-  return false;
+  // the running solve() call checks the flag between all planning steps and aborts with PREEMPTED
+  terminated_ = true;
+  return true;
 }
 }  // namespace rtr_moveit
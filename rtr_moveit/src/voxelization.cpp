@@ -0,0 +1,587 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc: Object-local voxelization of collision shapes inside a roadmap volume
+ */
+
+#include <rtr_moveit/voxelization.h>
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// octomap
+#include <octomap/octomap.h>
+
+namespace rtr_moveit
+{
+namespace
+{
+// numerical threshold for degenerate separating axes and search directions
+constexpr double EPSILON = 1e-12;
+// maximum number of GJK iterations, the result is conservative (colliding) if exceeded
+constexpr std::size_t GJK_MAX_ITERATIONS = 64;
+
+/* Support mapping of a voxel box, returns the box corner that is furthest in a given direction */
+struct VoxelSupport
+{
+  Eigen::Vector3d center;
+  Eigen::Vector3d half_extents;
+
+  Eigen::Vector3d operator()(const Eigen::Vector3d& direction) const
+  {
+    return Eigen::Vector3d(center[0] + (direction[0] < 0.0 ? -half_extents[0] : half_extents[0]),
+                           center[1] + (direction[1] < 0.0 ? -half_extents[1] : half_extents[1]),
+                           center[2] + (direction[2] < 0.0 ? -half_extents[2] : half_extents[2]));
+  }
+};
+
+/* Support mapping and inside test of cylinders and cones, both are aligned with the local Z axis.
+ * The cone tip is on the positive Z axis, the base is on the negative Z axis (like shapes::Cone). */
+struct RevolutionSupport
+{
+  Eigen::Matrix3d rotation;
+  Eigen::Vector3d translation;
+  double radius;
+  double half_length;
+  bool is_cone;
+
+  Eigen::Vector3d operator()(const Eigen::Vector3d& direction) const
+  {
+    const Eigen::Vector3d local_direction = rotation.transpose() * direction;
+    const double radial_length = std::hypot(local_direction[0], local_direction[1]);
+    Eigen::Vector3d support(0.0, 0.0, -half_length);
+    if (radial_length > EPSILON)
+    {
+      support[0] = radius * local_direction[0] / radial_length;
+      support[1] = radius * local_direction[1] / radial_length;
+    }
+    if (is_cone)
+    {
+      // compare the rim of the base with the tip
+      if (half_length * local_direction[2] > support.dot(local_direction))
+        support = Eigen::Vector3d(0.0, 0.0, half_length);
+    }
+    else if (local_direction[2] > 0.0)
+    {
+      support[2] = half_length;
+    }
+    return translation + rotation * support;
+  }
+
+  bool contains(const Eigen::Vector3d& point) const
+  {
+    const Eigen::Vector3d local_point = rotation.transpose() * (point - translation);
+    if (std::abs(local_point[2]) > half_length)
+      return false;
+    double local_radius = radius;
+    if (is_cone)
+      local_radius *= 0.5 * (half_length - local_point[2]) / half_length;
+    return local_point[0] * local_point[0] + local_point[1] * local_point[1] <= local_radius * local_radius;
+  }
+};
+
+/* GJK line case, simplex[1] is the most recent point */
+void updateLineSimplex(std::array<Eigen::Vector3d, 4>& simplex, std::size_t& size, Eigen::Vector3d& direction)
+{
+  const Eigen::Vector3d a = simplex[1];
+  const Eigen::Vector3d ab = simplex[0] - a;
+  const Eigen::Vector3d ao = -a;
+  if (ab.dot(ao) > 0.0)
+  {
+    direction = ab.cross(ao).cross(ab);
+  }
+  else
+  {
+    simplex[0] = a;
+    size = 1;
+    direction = ao;
+  }
+}
+
+/* GJK triangle case, simplex[2] is the most recent point */
+void updateTriangleSimplex(std::array<Eigen::Vector3d, 4>& simplex, std::size_t& size, Eigen::Vector3d& direction)
+{
+  const Eigen::Vector3d a = simplex[2];
+  const Eigen::Vector3d b = simplex[1];
+  const Eigen::Vector3d c = simplex[0];
+  const Eigen::Vector3d ab = b - a;
+  const Eigen::Vector3d ac = c - a;
+  const Eigen::Vector3d ao = -a;
+  const Eigen::Vector3d abc = ab.cross(ac);
+
+  // origin is outside of edge ac
+  if (abc.cross(ac).dot(ao) > 0.0 && ac.dot(ao) > 0.0)
+  {
+    simplex[0] = c;
+    simplex[1] = a;
+    size = 2;
+    direction = ac.cross(ao).cross(ac);
+  }
+  // origin is outside of edge ab
+  else if (abc.cross(ac).dot(ao) > 0.0 || ab.cross(abc).dot(ao) > 0.0)
+  {
+    simplex[0] = b;
+    simplex[1] = a;
+    size = 2;
+    updateLineSimplex(simplex, size, direction);
+  }
+  // origin is above or below the triangle face
+  else if (abc.dot(ao) > 0.0)
+  {
+    direction = abc;
+  }
+  else
+  {
+    simplex[0] = b;
+    simplex[1] = c;
+    direction = -abc;
+  }
+}
+
+/* GJK tetrahedron case, simplex[3] is the most recent point
+ * @return true if the tetrahedron contains the origin */
+bool updateTetrahedronSimplex(std::array<Eigen::Vector3d, 4>& simplex, std::size_t& size, Eigen::Vector3d& direction)
+{
+  const Eigen::Vector3d a = simplex[3];
+  const Eigen::Vector3d ao = -a;
+  // faces that contain the most recent point, listed with the vertex on the opposite side
+  const std::array<std::array<Eigen::Vector3d, 3>, 3> faces = { { { { simplex[2], simplex[1], simplex[0] } },
+                                                                  { { simplex[1], simplex[0], simplex[2] } },
+                                                                  { { simplex[0], simplex[2], simplex[1] } } } };
+  for (const std::array<Eigen::Vector3d, 3>& face : faces)
+  {
+    Eigen::Vector3d normal = (face[0] - a).cross(face[1] - a);
+    if (normal.dot(face[2] - a) > 0.0)
+      normal = -normal;
+    if (normal.dot(ao) > 0.0)
+    {
+      simplex[0] = face[1];
+      simplex[1] = face[0];
+      simplex[2] = a;
+      size = 3;
+      updateTriangleSimplex(simplex, size, direction);
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Boolean GJK intersection test of two convex shapes given by their support mappings */
+template <class SupportA, class SupportB>
+bool intersectConvex(const SupportA& support_a, const SupportB& support_b, const Eigen::Vector3d& initial_direction)
+{
+  std::array<Eigen::Vector3d, 4> simplex;
+  std::size_t size = 0;
+  Eigen::Vector3d direction = initial_direction;
+  if (direction.squaredNorm() < EPSILON)
+    direction = Eigen::Vector3d::UnitX();
+  simplex[size++] = support_a(direction) - support_b(-direction);
+  direction = -simplex[0];
+  for (std::size_t iteration = 0; iteration < GJK_MAX_ITERATIONS; ++iteration)
+  {
+    // origin is located on the simplex
+    if (direction.squaredNorm() < EPSILON)
+      return true;
+    const Eigen::Vector3d point = support_a(direction) - support_b(-direction);
+    if (point.dot(direction) <= 0.0)
+      return false;
+    simplex[size++] = point;
+    if (size == 2)
+      updateLineSimplex(simplex, size, direction);
+    else if (size == 3)
+      updateTriangleSimplex(simplex, size, direction);
+    else if (updateTetrahedronSimplex(simplex, size, direction))
+      return true;
+  }
+  return true;
+}
+
+/* Separating axis test of a triangle and an axis-aligned box centered at the origin */
+bool intersectTriangleBox(const Eigen::Vector3d& v0, const Eigen::Vector3d& v1, const Eigen::Vector3d& v2,
+                          const Eigen::Vector3d& half_extents)
+{
+  // project triangle onto axis and compare with projected box radius
+  auto separated = [&](const Eigen::Vector3d& axis) {
+    const double p0 = axis.dot(v0);
+    const double p1 = axis.dot(v1);
+    const double p2 = axis.dot(v2);
+    const double radius = half_extents.dot(axis.cwiseAbs());
+    return std::min({ p0, p1, p2 }) >= radius || std::max({ p0, p1, p2 }) <= -radius;
+  };
+
+  // box face normals
+  for (std::size_t i = 0; i < 3; ++i)
+    if (separated(Eigen::Vector3d::Unit(i)))
+      return false;
+
+  // triangle face normal
+  const std::array<Eigen::Vector3d, 3> edges = { { v1 - v0, v2 - v1, v0 - v2 } };
+  const Eigen::Vector3d normal = edges[0].cross(edges[1]);
+  if (normal.squaredNorm() > EPSILON && separated(normal))
+    return false;
+
+  // cross products of box axes and triangle edges
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    for (const Eigen::Vector3d& edge : edges)
+    {
+      const Eigen::Vector3d axis = Eigen::Vector3d::Unit(i).cross(edge);
+      if (axis.squaredNorm() > EPSILON && separated(axis))
+        return false;
+    }
+  }
+  return true;
+}
+
+/* Appends all voxels of the range that pass the given voxel test */
+template <class VoxelTest>
+void addVoxels(const ShapeVoxelizer& voxelizer, const VoxelRange& range, const VoxelTest& voxel_test,
+               std::vector<rtr::Voxel>& voxels)
+{
+  for (uint16_t x = range.min[0]; x < range.max[0]; ++x)
+    for (uint16_t y = range.min[1]; y < range.max[1]; ++y)
+      for (uint16_t z = range.min[2]; z < range.max[2]; ++z)
+        if (voxel_test(voxelizer.getVoxelCenter(x, y, z)))
+          voxels.push_back(rtr::Voxel(x, y, z));
+}
+
+/* Candidate separating axes of the voxels and boxes with a fixed orientation. The 15 axes don't depend on the box
+ * position and size, so they are shared by all boxes of the same orientation (i.e. the leaves of an octree). */
+struct BoxAxes
+{
+  BoxAxes(const Eigen::Matrix3d& box_rotation, const Eigen::Vector3d& voxel_half_extents) : rotation(box_rotation)
+  {
+    for (std::size_t i = 0; i < 3; ++i)
+    {
+      addAxis(Eigen::Vector3d::Unit(i), voxel_half_extents);
+      addAxis(rotation.col(i), voxel_half_extents);
+      for (std::size_t j = 0; j < 3; ++j)
+        addAxis(Eigen::Vector3d::Unit(i).cross(rotation.col(j)), voxel_half_extents);
+    }
+  }
+
+  void addAxis(const Eigen::Vector3d& axis, const Eigen::Vector3d& voxel_half_extents)
+  {
+    if (axis.squaredNorm() <= EPSILON)
+      return;
+    axes[num_axes] = axis;
+    voxel_radii[num_axes] = voxel_half_extents.dot(axis.cwiseAbs());
+    box_axes[num_axes] = (rotation.transpose() * axis).cwiseAbs();
+    ++num_axes;
+  }
+
+  Eigen::Matrix3d rotation;
+  std::array<Eigen::Vector3d, 15> axes;
+  // projected radius of a voxel on each axis
+  std::array<double, 15> voxel_radii;
+  // absolute axes in the box frame, the dot product with the box half extents is the projected box radius
+  std::array<Eigen::Vector3d, 15> box_axes;
+  std::size_t num_axes = 0;
+};
+
+/* Appends all voxels that intersect with a box, only the projected distance between both centers is computed per
+ * voxel */
+void addBoxVoxels(const ShapeVoxelizer& voxelizer, const BoxAxes& box_axes, const Eigen::Vector3d& translation,
+                  const Eigen::Vector3d& half_extents, std::vector<rtr::Voxel>& voxels)
+{
+  const Eigen::Vector3d aabb_extents = box_axes.rotation.cwiseAbs() * half_extents;
+  VoxelRange range;
+  if (!voxelizer.getVoxelRange(translation - aabb_extents, translation + aabb_extents, range))
+    return;
+
+  std::array<double, 15> radii;
+  std::array<double, 15> offsets;
+  for (std::size_t i = 0; i < box_axes.num_axes; ++i)
+  {
+    radii[i] = box_axes.voxel_radii[i] + half_extents.dot(box_axes.box_axes[i]);
+    offsets[i] = translation.dot(box_axes.axes[i]);
+  }
+  addVoxels(voxelizer, range,
+            [&](const Eigen::Vector3d& center) {
+              for (std::size_t i = 0; i < box_axes.num_axes; ++i)
+                if (std::abs(offsets[i] - center.dot(box_axes.axes[i])) >= radii[i])
+                  return false;
+              return true;
+            },
+            voxels);
+}
+
+/* Appends all voxels that intersect with a cylinder or cone */
+void addRevolutionVoxels(const ShapeVoxelizer& voxelizer, const RevolutionSupport& shape,
+                         std::vector<rtr::Voxel>& voxels)
+{
+  // bounding box of the cylinder hull of the shape
+  const Eigen::Vector3d axis = shape.rotation.col(2);
+  Eigen::Vector3d aabb_extents;
+  for (std::size_t i = 0; i < 3; ++i)
+    aabb_extents[i] =
+        std::abs(axis[i]) * shape.half_length + shape.radius * std::sqrt(std::max(0.0, 1.0 - axis[i] * axis[i]));
+  VoxelRange range;
+  if (!voxelizer.getVoxelRange(shape.translation - aabb_extents, shape.translation + aabb_extents, range))
+    return;
+
+  // voxels with all corners inside the shape are occupied, only the remaining ones require a GJK test
+  const Eigen::Vector3d half_extents = 0.5 * voxelizer.getVoxelDimension();
+  addVoxels(voxelizer, range,
+            [&](const Eigen::Vector3d& center) {
+              bool inside = true;
+              for (std::size_t corner = 0; inside && corner < 8; ++corner)
+                inside = shape.contains(center + Eigen::Vector3d(corner & 1 ? half_extents[0] : -half_extents[0],
+                                                                 corner & 2 ? half_extents[1] : -half_extents[1],
+                                                                 corner & 4 ? half_extents[2] : -half_extents[2]));
+              return inside || intersectConvex(VoxelSupport{ center, half_extents }, shape, shape.translation - center);
+            },
+            voxels);
+}
+}  // namespace
+
+ShapeVoxelizer::ShapeVoxelizer(const RoadmapVolume& volume) : resolution_(volume.voxel_resolution)
+{
+  for (std::size_t i = 0; i < 3; ++i)
+    voxel_dimension_[i] = volume.dimension[i] / volume.voxel_resolution[i];
+  voxel_half_extents_ = 0.5 * voxel_dimension_;
+}
+
+bool ShapeVoxelizer::isSupported(const shapes::Shape& shape)
+{
+  return shape.type == shapes::BOX || shape.type == shapes::SPHERE || shape.type == shapes::CYLINDER ||
+         shape.type == shapes::CONE || shape.type == shapes::MESH || shape.type == shapes::PLANE ||
+         shape.type == shapes::OCTREE;
+}
+
+bool ShapeVoxelizer::voxelizeShape(const shapes::Shape& shape, const Eigen::Affine3d& pose,
+                                   std::vector<rtr::Voxel>& voxels) const
+{
+  switch (shape.type)
+  {
+    case shapes::BOX:
+      voxelizeBox(static_cast<const shapes::Box&>(shape), pose, voxels);
+      return true;
+    case shapes::SPHERE:
+      voxelizeSphere(static_cast<const shapes::Sphere&>(shape), pose, voxels);
+      return true;
+    case shapes::CYLINDER:
+      voxelizeCylinder(static_cast<const shapes::Cylinder&>(shape), pose, voxels);
+      return true;
+    case shapes::CONE:
+      voxelizeCone(static_cast<const shapes::Cone&>(shape), pose, voxels);
+      return true;
+    case shapes::MESH:
+      voxelizeMesh(static_cast<const shapes::Mesh&>(shape), pose, voxels);
+      return true;
+    case shapes::PLANE:
+      voxelizePlane(static_cast<const shapes::Plane&>(shape), pose, voxels);
+      return true;
+    case shapes::OCTREE:
+      voxelizeOcTree(static_cast<const shapes::OcTree&>(shape), pose, voxels);
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool ShapeVoxelizer::getVoxelRange(const Eigen::Vector3d& aabb_min, const Eigen::Vector3d& aabb_max,
+                                   VoxelRange& range) const
+{
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    // voxel i covers [i * voxel_dimension, (i + 1) * voxel_dimension]
+    double lower = std::max(std::floor(aabb_min[i] / voxel_dimension_[i]), 0.0);
+    double upper = std::min(std::ceil(aabb_max[i] / voxel_dimension_[i]), double(resolution_[i]));
+    if (!(lower < upper))
+      return false;
+    range.min[i] = lower;
+    range.max[i] = upper;
+  }
+  return true;
+}
+
+VoxelRange ShapeVoxelizer::getVolumeRange() const
+{
+  VoxelRange range;
+  range.min = { { 0, 0, 0 } };
+  range.max = resolution_;
+  return range;
+}
+
+void ShapeVoxelizer::voxelizeBox(const shapes::Box& box, const Eigen::Affine3d& pose,
+                                 std::vector<rtr::Voxel>& voxels) const
+{
+  const BoxAxes box_axes(pose.linear(), voxel_half_extents_);
+  const Eigen::Vector3d half_extents(0.5 * box.size[0], 0.5 * box.size[1], 0.5 * box.size[2]);
+  addBoxVoxels(*this, box_axes, pose.translation(), half_extents, voxels);
+}
+
+void ShapeVoxelizer::voxelizeSphere(const shapes::Sphere& sphere, const Eigen::Affine3d& pose,
+                                    std::vector<rtr::Voxel>& voxels) const
+{
+  const Eigen::Vector3d sphere_center = pose.translation();
+  const Eigen::Vector3d aabb_extents = Eigen::Vector3d::Constant(sphere.radius);
+  VoxelRange range;
+  if (!getVoxelRange(sphere_center - aabb_extents, sphere_center + aabb_extents, range))
+    return;
+
+  // compare the squared distance between the sphere center and the closest point of the voxel with the radius
+  const double squared_radius = sphere.radius * sphere.radius;
+  addVoxels(*this, range,
+            [&](const Eigen::Vector3d& center) {
+              return ((center - sphere_center).cwiseAbs() - voxel_half_extents_).cwiseMax(0.0).squaredNorm() <
+                     squared_radius;
+            },
+            voxels);
+}
+
+void ShapeVoxelizer::voxelizeCylinder(const shapes::Cylinder& cylinder, const Eigen::Affine3d& pose,
+                                      std::vector<rtr::Voxel>& voxels) const
+{
+  addRevolutionVoxels(*this, { pose.linear(), pose.translation(), cylinder.radius, 0.5 * cylinder.length, false },
+                      voxels);
+}
+
+void ShapeVoxelizer::voxelizeCone(const shapes::Cone& cone, const Eigen::Affine3d& pose,
+                                  std::vector<rtr::Voxel>& voxels) const
+{
+  addRevolutionVoxels(*this, { pose.linear(), pose.translation(), cone.radius, 0.5 * cone.length, true }, voxels);
+}
+
+void ShapeVoxelizer::voxelizeMesh(const shapes::Mesh& mesh, const Eigen::Affine3d& pose,
+                                  std::vector<rtr::Voxel>& voxels) const
+{
+  // transform vertices into the volume frame
+  std::vector<Eigen::Vector3d> vertices(mesh.vertex_count);
+  for (unsigned int i = 0; i < mesh.vertex_count; ++i)
+    vertices[i] = pose * Eigen::Vector3d(mesh.vertices[3 * i], mesh.vertices[3 * i + 1], mesh.vertices[3 * i + 2]);
+
+  // only test voxels against the triangles that overlap with it, like FCL this only covers the mesh surface
+  for (unsigned int i = 0; i < mesh.triangle_count; ++i)
+  {
+    const Eigen::Vector3d& v0 = vertices[mesh.triangles[3 * i]];
+    const Eigen::Vector3d& v1 = vertices[mesh.triangles[3 * i + 1]];
+    const Eigen::Vector3d& v2 = vertices[mesh.triangles[3 * i + 2]];
+    VoxelRange range;
+    if (!getVoxelRange(v0.cwiseMin(v1).cwiseMin(v2), v0.cwiseMax(v1).cwiseMax(v2), range))
+      continue;
+    addVoxels(*this, range,
+              [&](const Eigen::Vector3d& center) {
+                return intersectTriangleBox(v0 - center, v1 - center, v2 - center, voxel_half_extents_);
+              },
+              voxels);
+  }
+}
+
+void ShapeVoxelizer::voxelizePlane(const shapes::Plane& plane, const Eigen::Affine3d& pose,
+                                   std::vector<rtr::Voxel>& voxels) const
+{
+  // plane n * p + d = 0 in the volume frame
+  const Eigen::Vector3d local_normal(plane.a, plane.b, plane.c);
+  const double normal_length = local_normal.norm();
+  if (normal_length < EPSILON)
+    return;
+  const Eigen::Vector3d normal = pose.linear() * local_normal / normal_length;
+  const double d = plane.d / normal_length - normal.dot(pose.translation());
+  const double radius = voxel_half_extents_.dot(normal.cwiseAbs());
+
+  // solve for the voxel range along the axis with the largest normal component in each column of the other axes,
+  // one extra voxel on both sides is tested for rounding errors
+  std::size_t k;
+  normal.cwiseAbs().maxCoeff(&k);
+  const std::size_t i = (k + 1) % 3;
+  const std::size_t j = (k + 2) % 3;
+  std::array<uint16_t, 3> voxel;
+  for (voxel[i] = 0; voxel[i] < resolution_[i]; ++voxel[i])
+  {
+    for (voxel[j] = 0; voxel[j] < resolution_[j]; ++voxel[j])
+    {
+      const double offset = d + normal[i] * (voxel[i] + 0.5) * voxel_dimension_[i] +
+                            normal[j] * (voxel[j] + 0.5) * voxel_dimension_[j];
+      const double lower = (-offset - radius) / normal[k] / voxel_dimension_[k] - 0.5;
+      const double upper = (-offset + radius) / normal[k] / voxel_dimension_[k] - 0.5;
+      const double min_k = std::max(std::floor(std::min(lower, upper)) - 1.0, 0.0);
+      const double max_k = std::min(std::ceil(std::max(lower, upper)) + 1.0, double(resolution_[k] - 1));
+      for (double voxel_k = min_k; voxel_k <= max_k; ++voxel_k)
+      {
+        voxel[k] = voxel_k;
+        const double distance = offset + normal[k] * (voxel[k] + 0.5) * voxel_dimension_[k];
+        if (std::abs(distance) < radius)
+          voxels.push_back(rtr::Voxel(voxel[0], voxel[1], voxel[2]));
+      }
+    }
+  }
+}
+
+void ShapeVoxelizer::voxelizeOcTree(const shapes::OcTree& octree, const Eigen::Affine3d& pose,
+                                    std::vector<rtr::Voxel>& voxels) const
+{
+  if (!octree.octree)
+    return;
+  const octomap::OcTree& tree = *octree.octree;
+
+  // only leaves inside the bounding box of the volume in the octree frame are visited
+  const Eigen::Affine3d volume_to_octree = pose.inverse();
+  Eigen::Vector3d bbx_min = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+  Eigen::Vector3d bbx_max = -bbx_min;
+  for (std::size_t corner = 0; corner < 8; ++corner)
+  {
+    const Eigen::Vector3d volume_corner((corner & 1 ? 1 : 0) * resolution_[0] * voxel_dimension_[0],
+                                        (corner & 2 ? 1 : 0) * resolution_[1] * voxel_dimension_[1],
+                                        (corner & 4 ? 1 : 0) * resolution_[2] * voxel_dimension_[2]);
+    const Eigen::Vector3d octree_corner = volume_to_octree * volume_corner;
+    bbx_min = bbx_min.cwiseMin(octree_corner);
+    bbx_max = bbx_max.cwiseMax(octree_corner);
+  }
+
+  // clip the bounding box to the known octree space, coordinates outside of the octree's key range yield no leaves
+  Eigen::Vector3d tree_min, tree_max;
+  tree.getMetricMin(tree_min[0], tree_min[1], tree_min[2]);
+  tree.getMetricMax(tree_max[0], tree_max[1], tree_max[2]);
+  bbx_min = bbx_min.cwiseMax(tree_min);
+  bbx_max = bbx_max.cwiseMin(tree_max);
+  if ((bbx_min.array() > bbx_max.array()).any())
+    return;
+
+  // voxelize the occupied leaves as cubes, they all share the same orientation
+  const BoxAxes box_axes(pose.linear(), voxel_half_extents_);
+  const octomap::point3d leaf_min(bbx_min[0], bbx_min[1], bbx_min[2]);
+  const octomap::point3d leaf_max(bbx_max[0], bbx_max[1], bbx_max[2]);
+  for (auto leaf = tree.begin_leafs_bbx(leaf_min, leaf_max), end = tree.end_leafs_bbx(); leaf != end; ++leaf)
+  {
+    if (!tree.isNodeOccupied(*leaf))
+      continue;
+    const Eigen::Vector3d leaf_center = pose * Eigen::Vector3d(leaf.getX(), leaf.getY(), leaf.getZ());
+    addBoxVoxels(*this, box_axes, leaf_center, Eigen::Vector3d::Constant(0.5 * leaf.getSize()), voxels);
+  }
+}
+}  // namespace rtr_moveit
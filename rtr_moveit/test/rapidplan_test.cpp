@@ -59,7 +59,8 @@ TEST(TestSuite, testPlannerInterface)
   goal.type = rtr_moveit::RapidPlanGoal::Type::STATE_IDS;
   goal.state_ids = { goal_id };
 
-  // planner setup
+  // planner setup, the test roadmap is planned without collision checks
+  nh.setParam("planner_config/software_collision_checks", false);
   rtr_moveit::RTRPlannerInterface planner_(nh);
   double timeout = 5;  // seconds
   rtr_moveit::OccupancyData occupancy_dummy;
@@ -74,11 +75,18 @@ TEST(TestSuite, testPlannerInterface)
   roadmap.og_file = ros::package::getPath("rtr_moveit") + "/test/test_roadmap.og";
 
   // this should work now
-  std::vector<std::vector<float>> roadmap_states;
+  std::vector<std::vector<float>> waypoint_configs;
   std::deque<std::size_t> waypoints, edges;
-  ASSERT_TRUE(planner_.solve(roadmap, start_id, goal, occupancy_dummy, timeout, roadmap_states, waypoints, edges))
+  ASSERT_TRUE(planner_.solve(roadmap, start_id, goal, occupancy_dummy, timeout, waypoint_configs, waypoints, edges))
       << "Planning with STATE_IDS goal should have been successful";
 
+  // only the configs of the solution waypoints are returned
+  std::vector<std::vector<float>> roadmap_states;
+  ASSERT_TRUE(planner_.getRoadmapConfigs(roadmap, roadmap_states));
+  ASSERT_EQ(waypoint_configs.size(), waypoints.size());
+  for (std::size_t i = 0; i < waypoints.size(); ++i)
+    EXPECT_EQ(waypoint_configs[i], roadmap_states[waypoints[i]]);
+
   // then it should work backwards as well
   goal.state_ids = { start_id };
   ASSERT_TRUE(planner_.solve(roadmap, goal_id, goal, occupancy_dummy, timeout, solution))
@@ -86,6 +94,20 @@ TEST(TestSuite, testPlannerInterface)
 
   ASSERT_FALSE(solution.empty()) << "Solution path is empty";
 
+  // batch planning returns the same paths as single queries
+  std::vector<rtr_moveit::PlanningQuery> queries(2);
+  queries[0].start_state_id = start_id;
+  queries[0].goal.type = rtr_moveit::RapidPlanGoal::Type::STATE_IDS;
+  queries[0].goal.state_ids = { goal_id };
+  queries[1].start_state_id = goal_id;
+  queries[1].goal = goal;
+  std::vector<rtr_moveit::PlanningQueryResult> results;
+  ASSERT_TRUE(planner_.solveBatch(roadmap, occupancy_dummy, queries, timeout, results, 2));
+  ASSERT_EQ(results.size(), queries.size());
+  EXPECT_TRUE(results[0].success && results[1].success) << "Batch planning should have been successful";
+  EXPECT_EQ(results[0].waypoints, waypoints);
+  EXPECT_EQ(results[1].waypoint_configs, solution);
+
   // TODO(RTR-58): add TRANSFORM goal test
 
   // test state search
@@ -0,0 +1,546 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2019, PickNik LLC
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of PickNik LLC nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Offline benchmark of occupancy generation, roadmap search and planning without MPA hardware.
+ *       Results are written as JSON lines with one object per benchmark configuration.
+ */
+
+// C++
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ROS
+#include <ros/ros.h>
+#include <ros/package.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <pcl/io/pcd_io.h>
+#include <pcl/point_types.h>
+#include <pcl_conversions/pcl_conversions.h>
+
+// MoveIt!
+#include <moveit/kinematic_constraints/utils.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit_msgs/CollisionObject.h>
+#include <srdfdom/model.h>
+#include <urdf_parser/urdf_parser.h>
+
+// rtr_moveit
+#include <rtr_moveit/occupancy_handler.h>
+#include <rtr_moveit/planner_metrics.h>
+#include <rtr_moveit/roadmap_cache.h>
+#include <rtr_moveit/roadmap_index.h>
+#include <rtr_moveit/roadmap_search.h>
+#include <rtr_moveit/roadmap_visualization.h>
+#include <rtr_moveit/rtr_planner_interface.h>
+#include <rtr_moveit/rtr_planning_context.h>
+
+namespace
+{
+const std::string LOGNAME = "rtr_benchmark";
+const std::string GROUP_NAME = "manipulator";
+
+// benchmark parameters as JSON literals by name
+typedef std::vector<std::pair<std::string, std::string>> Parameters;
+
+std::string quote(const std::string& value)
+{
+  return "\"" + value + "\"";
+}
+
+// Durations of all iterations of a single benchmark configuration
+struct BenchmarkResult
+{
+  std::vector<double> samples;  // seconds
+  std::size_t failures = 0;
+};
+
+/** Runs setup and run for all iterations, only run is timed. Iterations for which run returns false count as
+ *  failures but are timed anyway. */
+BenchmarkResult measure(std::size_t iterations, const std::function<void(std::size_t)>& setup,
+                        const std::function<bool(std::size_t)>& run)
+{
+  BenchmarkResult result;
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    setup(i);
+    const ros::WallTime start = ros::WallTime::now();
+    const bool success = run(i);
+    result.samples.push_back((ros::WallTime::now() - start).toSec());
+    result.failures += !success;
+  }
+  return result;
+}
+
+void writeParameters(std::ostream& out, const Parameters& parameters)
+{
+  out << "{";
+  for (std::size_t i = 0; i < parameters.size(); ++i)
+    out << (i ? "," : "") << quote(parameters[i].first) << ":" << parameters[i].second;
+  out << "}";
+}
+
+/** Writes count, failures, mean, p50, p99, min and max in milliseconds of a benchmark as single JSON line */
+void writeResult(std::ostream& out, const std::string& benchmark, const Parameters& parameters,
+                 BenchmarkResult result)
+{
+  std::vector<double>& samples = result.samples;
+  if (samples.empty())
+    return;
+  std::sort(samples.begin(), samples.end());
+  double sum = 0.0;
+  for (double sample : samples)
+    sum += sample;
+  auto percentile = [&samples](double p) {
+    return samples[std::max<std::size_t>(std::ceil(p * samples.size()), 1) - 1];
+  };
+  out << std::fixed << std::setprecision(4) << "{\"benchmark\":" << quote(benchmark) << ",\"parameters\":";
+  writeParameters(out, parameters);
+  out << ",\"iterations\":" << samples.size() << ",\"failures\":" << result.failures
+      << ",\"mean_ms\":" << 1e3 * sum / samples.size() << ",\"p50_ms\":" << 1e3 * percentile(0.5)
+      << ",\"p99_ms\":" << 1e3 * percentile(0.99) << ",\"min_ms\":" << 1e3 * samples.front()
+      << ",\"max_ms\":" << 1e3 * samples.back() << "}" << std::endl;
+}
+
+/** Writes the stage latencies recorded by the planner metrics, percentiles are histogram bucket bounds */
+void writeStageResults(std::ostream& out, const std::string& benchmark, const Parameters& parameters,
+                       const rtr_moveit::PlannerMetrics& metrics)
+{
+  for (std::size_t i = 0; i < rtr_moveit::PlannerMetrics::NUM_STAGES; ++i)
+  {
+    const rtr_moveit::PlannerMetrics::Stage stage = rtr_moveit::PlannerMetrics::Stage(i);
+    const rtr_moveit::LatencyHistogram::Summary summary = metrics.getStageSummary(stage);
+    if (summary.count == 0)
+      continue;
+    Parameters stage_parameters = parameters;
+    stage_parameters.emplace_back("stage", quote(rtr_moveit::PlannerMetrics::getStageName(stage)));
+    out << std::fixed << std::setprecision(4) << "{\"benchmark\":" << quote(benchmark) << ",\"parameters\":";
+    writeParameters(out, stage_parameters);
+    out << ",\"iterations\":" << summary.count << ",\"p50_ms\":" << 1e3 * summary.p50
+        << ",\"p99_ms\":" << 1e3 * summary.p99 << ",\"max_ms\":" << 1e3 * summary.max << "}" << std::endl;
+  }
+}
+
+/** Returns a cubic volume region of 1m with the given voxel resolution along each axis */
+rtr_moveit::RoadmapVolume createVolume(const std::string& frame_id, uint16_t resolution)
+{
+  rtr_moveit::RoadmapVolume volume;
+  volume.pose.header.frame_id = frame_id;
+  volume.pose.pose.orientation.w = 1.0;
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    volume.dimension[i] = 1.0;
+    volume.voxel_resolution[i] = resolution;
+  }
+  return volume;
+}
+
+/** Adds boxes with random poses and sizes between 5cm and 20cm inside of a 1m volume to the planning scene */
+void addRandomBoxes(const planning_scene::PlanningScenePtr& scene, std::size_t count, std::mt19937& generator)
+{
+  std::uniform_real_distribution<double> position(0.0, 1.0);
+  std::uniform_real_distribution<double> size(0.05, 0.2);
+  std::uniform_real_distribution<double> angle(-M_PI, M_PI);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    moveit_msgs::CollisionObject obj;
+    obj.id = "box_" + std::to_string(i);
+    obj.header.frame_id = scene->getPlanningFrame();
+    obj.primitives.resize(1);
+    obj.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+    obj.primitives[0].dimensions = { size(generator), size(generator), size(generator) };
+    obj.primitive_poses.resize(1);
+    obj.primitive_poses[0].position.x = position(generator);
+    obj.primitive_poses[0].position.y = position(generator);
+    obj.primitive_poses[0].position.z = position(generator);
+    const Eigen::Quaterniond orientation(Eigen::AngleAxisd(angle(generator), Eigen::Vector3d::UnitZ()));
+    obj.primitive_poses[0].orientation.w = orientation.w();
+    obj.primitive_poses[0].orientation.z = orientation.z();
+    obj.operation = moveit_msgs::CollisionObject::ADD;
+    scene->processCollisionObjectMsg(obj);
+  }
+}
+
+/** Times OccupancyHandler::fromPlanningScene() for voxel resolutions, object counts and voxelization methods.
+ *  OBJECT_LOCAL is measured with a cleared occupancy cache (cold) and with cached object voxels (warm). */
+void benchmarkPlanningScene(const ros::NodeHandle& nh, std::size_t iterations, std::ostream& out)
+{
+  urdf::ModelInterfaceSharedPtr urdf_model(new urdf::ModelInterface());
+  srdf::ModelConstSharedPtr srdf_model(new srdf::Model());
+  moveit::core::RobotModelConstPtr robot_model(new moveit::core::RobotModel(urdf_model, srdf_model));
+
+  for (const std::size_t object_count : { 0, 10, 100 })
+  {
+    planning_scene::PlanningScenePtr scene(new planning_scene::PlanningScene(robot_model));
+    std::mt19937 generator(42);
+    addRandomBoxes(scene, object_count, generator);
+
+    for (const uint16_t resolution : { 16, 32, 64 })
+    {
+      rtr_moveit::OccupancyHandler occupancy_handler(nh);
+      const rtr_moveit::RoadmapVolume volume = createVolume(scene->getPlanningFrame(), resolution);
+      rtr_moveit::OccupancyData occupancy;
+      auto run = [&](std::size_t) { return occupancy_handler.fromPlanningScene(scene, volume, occupancy); };
+      Parameters parameters = { { "resolution", std::to_string(resolution) },
+                                { "objects", std::to_string(object_count) } };
+
+      occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::OBJECT_LOCAL);
+      parameters.emplace_back("method", quote("OBJECT_LOCAL"));
+      parameters.emplace_back("cache", quote("cold"));
+      writeResult(out, "fromPlanningScene", parameters,
+                  measure(iterations, [&](std::size_t) { occupancy_handler.clearOccupancyCache(); }, run));
+      parameters.back().second = quote("warm");
+      writeResult(out, "fromPlanningScene", parameters, measure(iterations, [](std::size_t) {}, run));
+
+      // checking every voxel with FCL is too slow for benchmarking fine resolutions
+      if (resolution <= 32)
+      {
+        occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::FULL_SWEEP);
+        parameters.resize(2);
+        parameters.emplace_back("method", quote("FULL_SWEEP"));
+        writeResult(out, "fromPlanningScene", parameters, measure(iterations, [](std::size_t) {}, run));
+      }
+    }
+  }
+}
+
+/** Returns a cloud with points uniformly distributed in a 2m cube around the benchmark volume */
+pcl::PCLPointCloud2 createRandomCloud(std::size_t point_count, std::mt19937& generator)
+{
+  std::uniform_real_distribution<float> position(-0.5, 1.5);
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  cloud.reserve(point_count);
+  for (std::size_t i = 0; i < point_count; ++i)
+    cloud.push_back(pcl::PointXYZ(position(generator), position(generator), position(generator)));
+  pcl::PCLPointCloud2 cloud_pcl2;
+  pcl::toPCLPointCloud2(cloud, cloud_pcl2);
+  return cloud_pcl2;
+}
+
+/** Times OccupancyHandler::fromPointCloud() with and without voxelization of the received clouds. Synthetic clouds
+ *  are used together with the recorded clouds of the PCD files in ~pcd_files, given in the volume frame. */
+void benchmarkPointCloud(ros::NodeHandle& nh, std::size_t iterations, std::ostream& out)
+{
+  std::vector<std::pair<std::string, pcl::PCLPointCloud2>> clouds;
+  std::mt19937 generator(42);
+  for (const std::size_t point_count : { 10000, 100000, 300000 })
+    clouds.emplace_back("random_" + std::to_string(point_count), createRandomCloud(point_count, generator));
+  std::vector<std::string> pcd_files;
+  nh.getParam("pcd_files", pcd_files);
+  for (const std::string& pcd_file : pcd_files)
+  {
+    pcl::PCLPointCloud2 cloud;
+    if (pcl::io::loadPCDFile(pcd_file, cloud) < 0)
+      ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to load point cloud file '" << pcd_file << "'");
+    else
+      clouds.emplace_back(pcd_file, cloud);
+  }
+
+  // the latched cloud stays valid for all iterations, waiting for new clouds is not measured
+  const std::string frame_id = "benchmark_volume";
+  nh.setParam("planner_config/pcl_max_age", 1e9);
+  ros::Publisher cloud_pub = nh.advertise<sensor_msgs::PointCloud2>("benchmark_cloud", 1, true);
+  for (std::pair<std::string, pcl::PCLPointCloud2>& cloud : clouds)
+  {
+    cloud.second.header.frame_id = frame_id;
+    sensor_msgs::PointCloud2 cloud_msg;
+    pcl_conversions::fromPCL(cloud.second, cloud_msg);
+    cloud_msg.header.stamp = ros::Time::now();
+    cloud_pub.publish(cloud_msg);
+
+    for (const bool voxelize : { false, true })
+    {
+      nh.setParam("planner_config/voxelize_point_clouds", voxelize);
+      rtr_moveit::OccupancyHandler occupancy_handler(nh);
+      const rtr_moveit::RoadmapVolume volume = createVolume(frame_id, 64);
+      occupancy_handler.setPointCloudTopic(cloud_pub.getTopic());
+      rtr_moveit::OccupancyData occupancy;
+      if (!occupancy_handler.fromPointCloud(volume, occupancy, 5.0))
+      {
+        ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to receive benchmark point cloud '" << cloud.first << "'");
+        continue;
+      }
+      const Parameters parameters = { { "cloud", quote(cloud.first) },
+                                      { "points", std::to_string(cloud.second.width * cloud.second.height) },
+                                      { "voxelize", voxelize ? "true" : "false" } };
+      writeResult(out, "fromPointCloud", parameters,
+                  measure(iterations, [](std::size_t) {},
+                          [&](std::size_t) { return occupancy_handler.fromPointCloud(volume, occupancy, 1.0); }));
+    }
+  }
+}
+
+/** Times nearest config lookups with the linear findClosestConfigs(), the linear search over the
+ *  structure-of-arrays coordinates of the roadmap index and the KD-tree of the index */
+void benchmarkConfigSearch(const std::string& roadmap_name, const std::vector<rtr::Config>& configs,
+                           std::size_t iterations, std::ostream& out)
+{
+  if (configs.empty())
+    return;
+
+  // queries are roadmap configs with random offsets
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<std::size_t> config_id(0, configs.size() - 1);
+  std::normal_distribution<float> offset(0.0, 0.1);
+  std::vector<rtr::Config> queries;
+  for (std::size_t i = 0; i < iterations; ++i)
+  {
+    queries.push_back(configs[config_id(generator)]);
+    for (float& value : queries.back())
+      value += offset(generator);
+  }
+
+  rtr_moveit::RoadmapIndex<rtr::Config> index;
+  index.build(configs);
+  std::vector<std::size_t> result_ids;
+  std::vector<float> result_distances;
+  for (const std::size_t max_results : { 1, 10 })
+  {
+    const Parameters parameters = { { "roadmap", quote(roadmap_name) },
+                                    { "states", std::to_string(configs.size()) },
+                                    { "dimension", std::to_string(configs[0].size()) },
+                                    { "max_results", std::to_string(max_results) } };
+    auto linear_search = [&](std::size_t i) {
+      rtr_moveit::findClosestConfigs(queries[i], configs, result_ids, result_distances, max_results);
+      return !result_ids.empty();
+    };
+    auto batched_search = [&](std::size_t i) {
+      index.findClosestLinear(queries[i], result_ids, result_distances, max_results);
+      return !result_ids.empty();
+    };
+    auto index_search = [&](std::size_t i) {
+      index.findClosest(queries[i], result_ids, result_distances, max_results);
+      return !result_ids.empty();
+    };
+    writeResult(out, "findClosestConfigs", parameters, measure(iterations, [](std::size_t) {}, linear_search));
+    writeResult(out, "RoadmapIndex::findClosestLinear", parameters,
+                measure(iterations, [](std::size_t) {}, batched_search));
+    writeResult(out, "RoadmapIndex::findClosest", parameters, measure(iterations, [](std::size_t) {}, index_search));
+  }
+}
+
+/** Creates a robot model with a serial chain of revolute joints that matches the dimension and joint ranges of
+ *  the roadmap configs. The chain starts at the roadmap base link and ends at the end effector link. */
+moveit::core::RobotModelPtr createRoadmapRobotModel(const rtr_moveit::RoadmapData& roadmap_data)
+{
+  const rtr_moveit::RoadmapSpecification& spec = roadmap_data.spec;
+  const std::string base_link = spec.base_link_frame.empty() ? "base_link" : spec.base_link_frame;
+  const std::string tip_link =
+      spec.end_effector_frame.empty() || spec.end_effector_frame == base_link ? "tool0" : spec.end_effector_frame;
+
+  std::ostringstream urdf;
+  urdf << "<robot name=\"benchmark_robot\"><link name=\"" << base_link << "\"/>";
+  const std::string& volume_frame = spec.volume.pose.header.frame_id;
+  if (!volume_frame.empty() && volume_frame != base_link && volume_frame != tip_link)
+    urdf << "<link name=\"" << volume_frame << "\"/><joint name=\"volume_joint\" type=\"fixed\"><parent link=\""
+         << base_link << "\"/><child link=\"" << volume_frame << "\"/></joint>";
+  std::string parent_link = base_link;
+  for (std::size_t i = 0; i < roadmap_data.dimension; ++i)
+  {
+    float lower = roadmap_data.getConfig(0)[i];
+    float upper = lower;
+    for (std::size_t state_id = 1; state_id < roadmap_data.num_states; ++state_id)
+    {
+      lower = std::min(lower, roadmap_data.getConfig(state_id)[i]);
+      upper = std::max(upper, roadmap_data.getConfig(state_id)[i]);
+    }
+    const std::string link = i + 1 == roadmap_data.dimension ? tip_link : "link_" + std::to_string(i + 1);
+    urdf << "<link name=\"" << link << "\"/><joint name=\"joint_" << i + 1 << "\" type=\"revolute\"><parent link=\""
+         << parent_link << "\"/><child link=\"" << link << "\"/><origin xyz=\"0 0 0.1\"/><axis xyz=\""
+         << (i % 2 ? "0 1 0" : "0 0 1") << "\"/><limit lower=\"" << lower - 0.1 << "\" upper=\"" << upper + 0.1
+         << "\" effort=\"1\" velocity=\"1\"/></joint>";
+    parent_link = link;
+  }
+  urdf << "</robot>";
+
+  urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(urdf.str());
+  if (!urdf_model)
+    return moveit::core::RobotModelPtr();
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  srdf_model->initString(*urdf_model, "<robot name=\"benchmark_robot\"><group name=\"" + GROUP_NAME +
+                                          "\"><chain base_link=\"" + base_link + "\" tip_link=\"" + tip_link +
+                                          "\"/></group></robot>");
+  return moveit::core::RobotModelPtr(new moveit::core::RobotModel(urdf_model, srdf_model));
+}
+
+/** Times RTRPlanningContext::solve() on a roadmap with RapidPlan collision checks disabled. Start and goal states
+ *  are roadmap configs, start and goal connections are collision checked in an empty planning scene. */
+void benchmarkSolve(ros::NodeHandle& nh, const rtr_moveit::RoadmapSpecification& roadmap_spec,
+                    const rtr_moveit::RoadmapCachePtr& roadmap_cache, std::size_t iterations, std::ostream& out)
+{
+  rtr_moveit::RoadmapDataConstPtr roadmap_data;
+  if (!roadmap_cache->getRoadmapData(roadmap_spec, roadmap_data) || roadmap_data->num_states < 2)
+    return;
+  moveit::core::RobotModelPtr robot_model = createRoadmapRobotModel(*roadmap_data);
+  if (!robot_model || !robot_model->hasJointModelGroup(GROUP_NAME) ||
+      robot_model->getJointModelGroup(GROUP_NAME)->getActiveJointModels().size() != roadmap_data->dimension)
+  {
+    ROS_ERROR_NAMED(LOGNAME, "Failed to create a robot model for the benchmark roadmap");
+    return;
+  }
+  planning_scene::PlanningScenePtr scene(new planning_scene::PlanningScene(robot_model));
+  const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(GROUP_NAME);
+
+  nh.setParam("planner_config/rapidplan_interface_enabled", false);
+  rtr_moveit::RTRPlannerInterfacePtr planner_interface(new rtr_moveit::RTRPlannerInterface(nh));
+  rtr_moveit::PlannerMetricsPtr metrics = std::make_shared<rtr_moveit::PlannerMetrics>();
+  planner_interface->setPlannerMetrics(metrics);
+  if (!planner_interface->initialize())
+    return;
+  std::shared_ptr<rtr_moveit::OccupancyHandler> occupancy_handler =
+      std::make_shared<rtr_moveit::OccupancyHandler>(nh);
+  rtr_moveit::RoadmapVisualizationPtr visualization(new rtr_moveit::RoadmapVisualization(nh));
+  rtr_moveit::RTRPlanningContext context(GROUP_NAME, roadmap_spec, planner_interface, visualization);
+  context.setOccupancyHandler(occupancy_handler);
+  context.setRoadmapCache(roadmap_cache);
+  context.setPlannerMetrics(metrics);
+
+  // plan from the first roadmap state to goals spread over the roadmap
+  robot_state::RobotState state(robot_model);
+  state.setToDefaultValues();
+  auto setup = [&](std::size_t i) {
+    planning_interface::MotionPlanRequest request;
+    request.group_name = GROUP_NAME;
+    request.allowed_planning_time = 5.0;
+    const std::size_t goal_id = 1 + (i * 7919) % (roadmap_data->num_states - 1);
+    std::vector<double> goal_config(roadmap_data->getConfig(goal_id),
+                                    roadmap_data->getConfig(goal_id) + roadmap_data->dimension);
+    state.setJointGroupPositions(jmg, goal_config);
+    request.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(state, jmg, 1e-3));
+    std::vector<double> start_config(roadmap_data->getConfig(0), roadmap_data->getConfig(0) + roadmap_data->dimension);
+    request.start_state.joint_state.name = jmg->getActiveJointModelNames();
+    request.start_state.joint_state.position = start_config;
+
+    moveit_msgs::MoveItErrorCodes error_code;
+    context.clear();
+    context.setMotionPlanRequest(request);
+    context.setPlanningScene(scene);
+    context.configure(error_code);
+  };
+  planning_interface::MotionPlanResponse response;
+  const Parameters parameters = { { "roadmap", quote(roadmap_spec.roadmap_id) },
+                                  { "states", std::to_string(roadmap_data->num_states) } };
+  writeResult(out, "solve", parameters,
+              measure(iterations, setup, [&](std::size_t) { return context.solve(response); }));
+  writeStageResults(out, "solve_stages", parameters, *metrics);
+}
+}  // namespace
+
+int main(int argc, char** argv)
+{
+  ros::init(argc, argv, "rtr_benchmark");
+  ros::NodeHandle nh("~");
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+
+  const std::size_t iterations = std::max(nh.param("iterations", 20), 1);
+  std::vector<std::string> benchmarks = { "planning_scene", "point_cloud", "config_search", "solve" };
+  nh.getParam("benchmarks", benchmarks);
+  auto is_enabled = [&benchmarks](const std::string& name) {
+    return std::find(benchmarks.begin(), benchmarks.end(), name) != benchmarks.end();
+  };
+
+  // results are written to stdout if no output file is given
+  std::string output_file = nh.param("output_file", std::string());
+  std::ofstream output_stream;
+  if (!output_file.empty())
+  {
+    output_stream.open(output_file);
+    if (!output_stream)
+    {
+      ROS_ERROR_STREAM_NAMED(LOGNAME, "Failed to open output file '" << output_file << "'");
+      return 1;
+    }
+  }
+  std::ostream& out = output_file.empty() ? std::cout : output_stream;
+
+  // planning context parameters that are required for solve()
+  const std::pair<std::string, double> context_params[] = { { "planner_config/allowed_position_distance", 0.1 },
+                                                            { "planner_config/allowed_joint_distance", 0.5 },
+                                                            { "planner_config/max_waypoint_distance", 0.01 } };
+  for (const std::pair<std::string, double>& param : context_params)
+    if (!nh.hasParam(param.first))
+      nh.setParam(param.first, param.second);
+  if (!nh.hasParam("planner_config/max_goal_states"))
+    nh.setParam("planner_config/max_goal_states", 5);
+
+  if (is_enabled("planning_scene"))
+    benchmarkPlanningScene(nh, iterations, out);
+  if (is_enabled("point_cloud"))
+    benchmarkPointCloud(nh, iterations, out);
+
+  // roadmap benchmarks use the bundled test roadmap and synthetic roadmaps
+  rtr_moveit::RoadmapSpecification roadmap_spec;
+  roadmap_spec.roadmap_id = "test_roadmap";
+  roadmap_spec.og_file =
+      nh.param("roadmap_file", ros::package::getPath("rtr_moveit") + "/test/test_roadmap.og");
+  rtr_moveit::RoadmapCachePtr roadmap_cache(new rtr_moveit::RoadmapCache());
+  if (is_enabled("config_search"))
+  {
+    rtr_moveit::RoadmapDataConstPtr roadmap_data;
+    if (roadmap_cache->getRoadmapData(roadmap_spec, roadmap_data))
+    {
+      std::vector<rtr::Config> configs;
+      for (std::size_t i = 0; i < roadmap_data->num_states; ++i)
+        configs.emplace_back(roadmap_data->getConfig(i), roadmap_data->getConfig(i) + roadmap_data->dimension);
+      benchmarkConfigSearch(roadmap_spec.roadmap_id, configs, iterations, out);
+    }
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> joint_value(-M_PI, M_PI);
+    for (const std::size_t state_count : { 10000, 100000, 1000000 })
+    {
+      std::vector<rtr::Config> configs(state_count, rtr::Config(6));
+      for (rtr::Config& config : configs)
+        for (float& value : config)
+          value = joint_value(generator);
+      benchmarkConfigSearch("synthetic", configs, iterations, out);
+    }
+  }
+  if (is_enabled("solve"))
+    benchmarkSolve(nh, roadmap_spec, roadmap_cache, iterations, out);
+
+  ros::shutdown();
+  return 0;
+}
@@ -37,23 +37,51 @@
  */
 
 // C++
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <limits>
+#include <numeric>
+#include <random>
 #include <vector>
 #include <string>
+#include <thread>
+#include <tuple>
 
 // gtest
 #include <gtest/gtest.h>
 
+// POSIX
+#include <unistd.h>
+
+// ROS
+#include <ros/package.h>
+
 // package dependencies
+#include <rtr_moveit/occupancy_grid.h>
 #include <rtr_moveit/occupancy_handler.h>
+#include <rtr_moveit/planner_metrics.h>
+#include <rtr_moveit/roadmap_cache.h>
+#include <rtr_moveit/roadmap_coverage.h>
+#include <rtr_moveit/roadmap_data.h>
+#include <rtr_moveit/roadmap_index.h>
+#include <rtr_moveit/roadmap_search.h>
+#include <rtr_moveit/roadmap_swept_volumes.h>
+#include <rtr_moveit/rtr_planning_context.h>
 #include <rtr_moveit/rtr_datatypes.h>
+#include <rtr_moveit/voxelization.h>
 
 // planning scene conversion
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
 #include <moveit_msgs/CollisionObject.h>
 #include <srdfdom/model.h>
 #include <urdf_model/model.h>
+#include <urdf_parser/urdf_parser.h>
+#include <geometric_shapes/shapes.h>
+#include <octomap/octomap.h>
 
 // RapidPlan
 #include <rtr-occupancy/Voxel.hpp>
@@ -90,9 +118,8 @@ TEST(TestSuite, convertPlanningScene)
 
   // convert planning scene object to voxels
   rtr_moveit::OccupancyHandler occupancy_handler(nh);
-  occupancy_handler.setVolumeRegion(volume);
   rtr_moveit::OccupancyData occupancy;
-  occupancy_handler.fromPlanningScene(scene, occupancy);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
 
   // voxels should be empty
   EXPECT_TRUE(occupancy.voxels.empty()) << "Created " << occupancy.voxels.size() << " occupancy voxels for empty "
@@ -120,7 +147,7 @@ TEST(TestSuite, convertPlanningScene)
 
   // There should be 1000 occupancy voxels (of 1000)
   occupancy.voxels.clear();
-  occupancy_handler.fromPlanningScene(scene, occupancy);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
 
 #define BUG_RAPID_1304_RTR_MOVEIT_TEST_FAILURE_BIONIC_MELODIC
 #if defined(BUG_RAPID_1304_RTR_MOVEIT_TEST_FAILURE_BIONIC_MELODIC)
@@ -132,30 +159,1066 @@ TEST(TestSuite, convertPlanningScene)
 
   // shift volume so only half of it is occluded
   volume.pose.pose.position.x += 0.501 * volume.dimension[shape_msgs::SolidPrimitive::BOX_X];
-  occupancy_handler.setVolumeRegion(volume);
   occupancy.voxels.clear();
-  occupancy_handler.fromPlanningScene(scene, occupancy);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
   EXPECT_TRUE(occupancy.voxels.size() == 500) << "Created " << occupancy.voxels.size() << " occupancy voxels even "
                                                                                           "though there should be 500";
 
   // shift volume so only a quarter of it is occluded
   volume.pose.pose.position.y += 0.501 * volume.dimension[shape_msgs::SolidPrimitive::BOX_Y];
-  occupancy_handler.setVolumeRegion(volume);
   occupancy.voxels.clear();
-  occupancy_handler.fromPlanningScene(scene, occupancy);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
   EXPECT_TRUE(occupancy.voxels.size() == 250) << "Created " << occupancy.voxels.size() << " occupancy voxels even "
                                                                                           "though there should be 250";
 
   // shift volume so only an eight of it is occluded
   volume.pose.pose.position.z += 0.501 * volume.dimension[shape_msgs::SolidPrimitive::BOX_Z];
-  occupancy_handler.setVolumeRegion(volume);
   occupancy.voxels.clear();
-  occupancy_handler.fromPlanningScene(scene, occupancy);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
   EXPECT_TRUE(occupancy.voxels.size() == 125) << "Created " << occupancy.voxels.size() << " occupancy voxels even "
                                                                                           "though there should be 125";
 #endif
 }
 
+/* This test voxelizes single collision shapes inside a 1m cube with 10x10x10 voxels and compares the number of
+ * occupied voxels with the analytical results. */
+TEST(TestSuite, voxelizeShapes)
+{
+  rtr_moveit::RoadmapVolume volume;
+  volume.dimension[0] = 1.0;
+  volume.dimension[1] = 1.0;
+  volume.dimension[2] = 1.0;
+  volume.voxel_resolution[0] = 10;
+  volume.voxel_resolution[1] = 10;
+  volume.voxel_resolution[2] = 10;
+  rtr_moveit::ShapeVoxelizer voxelizer(volume);
+  std::vector<rtr::Voxel> voxels;
+
+  // box spanning [0.25, 0.75] in all dimensions
+  Eigen::Affine3d pose(Eigen::Translation3d(0.5, 0.5, 0.5));
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Box(0.5, 0.5, 0.5), pose, voxels));
+  EXPECT_EQ(voxels.size(), 216u);
+
+  // rotating a box by 90 degrees is the same as swapping its dimensions
+  voxels.clear();
+  Eigen::Affine3d rotated_pose = pose * Eigen::AngleAxisd(0.5 * M_PI, Eigen::Vector3d::UnitZ());
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Box(0.5, 0.3, 0.5), rotated_pose, voxels));
+  EXPECT_EQ(voxels.size(), 144u);
+
+  // a sphere at a voxel center occupies the voxel and its 6 face neighbors
+  voxels.clear();
+  Eigen::Affine3d voxel_center_pose(Eigen::Translation3d(0.55, 0.55, 0.55));
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Sphere(0.06), voxel_center_pose, voxels));
+  EXPECT_EQ(voxels.size(), 7u);
+
+  // cylinder along the x axis, 6 layers with 5 voxels each
+  voxels.clear();
+  Eigen::Affine3d cylinder_pose(Eigen::Translation3d(0.5, 0.55, 0.55));
+  cylinder_pose.rotate(Eigen::AngleAxisd(0.5 * M_PI, Eigen::Vector3d::UnitY()));
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Cylinder(0.06, 0.5), cylinder_pose, voxels));
+  EXPECT_EQ(voxels.size(), 30u);
+
+  // single triangle inside the voxel layer z=5 covers all voxels with x+y <= 9
+  voxels.clear();
+  shapes::Mesh mesh(3, 1);
+  double vertices[] = { 0.02, 0.02, 0.55, 0.95, 0.02, 0.55, 0.02, 0.95, 0.55 };
+  std::copy(vertices, vertices + 9, mesh.vertices);
+  mesh.triangles[0] = 0;
+  mesh.triangles[1] = 1;
+  mesh.triangles[2] = 2;
+  EXPECT_TRUE(voxelizer.voxelizeShape(mesh, Eigen::Affine3d::Identity(), voxels));
+  EXPECT_EQ(voxels.size(), 55u);
+  for (const rtr::Voxel& voxel : voxels)
+    EXPECT_EQ(voxel.z, 5);
+
+  // horizontal plane through the voxel centers of layer z=5
+  voxels.clear();
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Plane(0.0, 0.0, 1.0, -0.55), Eigen::Affine3d::Identity(), voxels));
+  EXPECT_EQ(voxels.size(), 100u);
+  for (const rtr::Voxel& voxel : voxels)
+    EXPECT_EQ(voxel.z, 5);
+
+  // diagonal plane x + y = 1.12 intersects the voxels with x+y = 10 or x+y = 11 in all layers
+  voxels.clear();
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Plane(1.0, 1.0, 0.0, -1.12), Eigen::Affine3d::Identity(), voxels));
+  EXPECT_EQ(voxels.size(), 170u);
+  for (const rtr::Voxel& voxel : voxels)
+    EXPECT_TRUE(voxel.x + voxel.y == 10 || voxel.x + voxel.y == 11);
+
+  // octree leaves occupy the voxels they intersect, free leaves and leaves outside of the volume are ignored
+  std::shared_ptr<octomap::OcTree> octree = std::make_shared<octomap::OcTree>(0.02);
+  octree->updateNode(octomap::point3d(0.55, 0.55, 0.55), true);
+  octree->updateNode(octomap::point3d(0.05, 0.95, 0.25), true);
+  octree->updateNode(octomap::point3d(0.75, 0.75, 0.75), false);
+  octree->updateNode(octomap::point3d(1.55, 0.55, 0.55), true);
+  voxels.clear();
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::OcTree(octree), Eigen::Affine3d(Eigen::Translation3d(0.1, 0.0, 0.0)),
+                                      voxels));
+  ASSERT_EQ(voxels.size(), 2u);
+  std::sort(voxels.begin(), voxels.end(),
+            [](const rtr::Voxel& a, const rtr::Voxel& b) { return std::tie(a.x, a.y, a.z) < std::tie(b.x, b.y, b.z); });
+  EXPECT_EQ(voxels[0].x, 1);
+  EXPECT_EQ(voxels[0].y, 9);
+  EXPECT_EQ(voxels[0].z, 2);
+  EXPECT_EQ(voxels[1].x, 6);
+  EXPECT_EQ(voxels[1].y, 5);
+  EXPECT_EQ(voxels[1].z, 5);
+
+  // shapes outside of the volume don't occupy any voxels
+  voxels.clear();
+  Eigen::Affine3d outside_pose(Eigen::Translation3d(2.0, 0.5, 0.5));
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Box(0.5, 0.5, 0.5), outside_pose, voxels));
+  EXPECT_TRUE(voxelizer.voxelizeShape(shapes::Plane(0.0, 0.0, 1.0, -2.0), Eigen::Affine3d::Identity(), voxels));
+  EXPECT_TRUE(voxels.empty());
+}
+
+/* This test checks that the occupancy cache is updated if collision objects are added, moved or removed. */
+TEST(TestSuite, occupancyCache)
+{
+  ros::NodeHandle nh;
+
+  // instantiate emtpy planning scene
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  urdf_model.reset(new urdf::ModelInterface());
+  srdf::ModelConstSharedPtr srdf_model;
+  srdf_model.reset(new srdf::Model());
+  moveit::core::RobotModelConstPtr robot_model;
+  robot_model.reset(new moveit::core::RobotModel(urdf_model, srdf_model));
+  planning_scene::PlanningScenePtr scene;
+  scene.reset(new planning_scene::PlanningScene(robot_model));
+
+  // specify volume region
+  rtr_moveit::RoadmapVolume volume;
+  volume.pose.header.frame_id = scene->getPlanningFrame();
+  volume.pose.pose.orientation.w = 1.0;
+  volume.dimension[0] = 1.0;
+  volume.dimension[1] = 1.0;
+  volume.dimension[2] = 1.0;
+  volume.voxel_resolution[0] = 10;
+  volume.voxel_resolution[1] = 10;
+  volume.voxel_resolution[2] = 10;
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+  occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::OBJECT_LOCAL);
+
+  // sphere at the center of voxel (5,5,5) that also occupies the 6 neighbor voxels
+  moveit_msgs::CollisionObject obj;
+  obj.id = "collision_object";
+  obj.header.frame_id = scene->getPlanningFrame();
+  obj.primitives.resize(1);
+  obj.primitives[0].type = shape_msgs::SolidPrimitive::SPHERE;
+  obj.primitives[0].dimensions.resize(1);
+  obj.primitives[0].dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS] = 0.06;
+  obj.primitive_poses.resize(1);
+  obj.primitive_poses[0].orientation.w = 1.0;
+  obj.primitive_poses[0].position.x = 0.55;
+  obj.primitive_poses[0].position.y = 0.55;
+  obj.primitive_poses[0].position.z = 0.55;
+  obj.operation = moveit_msgs::CollisionObject::ADD;
+  scene->processCollisionObjectMsg(obj);
+
+  rtr_moveit::OccupancyData occupancy;
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  ASSERT_EQ(occupancy.voxels.size(), 7u);
+  EXPECT_EQ(occupancy.voxels[3].x, 5);
+
+  // unchanged scene returns the same voxels
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  ASSERT_EQ(occupancy.voxels.size(), 7u);
+  EXPECT_EQ(occupancy.voxels[3].x, 5);
+
+  // moved object is voxelized again
+  obj.primitive_poses[0].position.x = 0.25;
+  obj.operation = moveit_msgs::CollisionObject::ADD;
+  scene->processCollisionObjectMsg(obj);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  ASSERT_EQ(occupancy.voxels.size(), 7u);
+  EXPECT_EQ(occupancy.voxels[3].x, 2);
+
+  // cancelled voxelization fails and doesn't leave partial results in the cache
+  obj.primitive_poses[0].position.x = 0.75;
+  scene->processCollisionObjectMsg(obj);
+  std::atomic<bool> cancelled(true);
+  EXPECT_FALSE(occupancy_handler.fromPlanningScene(scene, volume, occupancy, &cancelled));
+  EXPECT_TRUE(occupancy_handler.fromPlanningScene(scene, volume, occupancy));
+  ASSERT_EQ(occupancy.voxels.size(), 7u);
+  EXPECT_EQ(occupancy.voxels[3].x, 7);
+
+  // removed object doesn't occupy any voxels
+  obj.operation = moveit_msgs::CollisionObject::REMOVE;
+  scene->processCollisionObjectMsg(obj);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  EXPECT_TRUE(occupancy.voxels.empty());
+}
+
+TEST(TestSuite, occupancyCacheOctree)
+{
+  ros::NodeHandle nh;
+
+  // instantiate emtpy planning scene
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  urdf_model.reset(new urdf::ModelInterface());
+  srdf::ModelConstSharedPtr srdf_model;
+  srdf_model.reset(new srdf::Model());
+  moveit::core::RobotModelConstPtr robot_model;
+  robot_model.reset(new moveit::core::RobotModel(urdf_model, srdf_model));
+  planning_scene::PlanningScenePtr scene;
+  scene.reset(new planning_scene::PlanningScene(robot_model));
+
+  // specify volume region
+  rtr_moveit::RoadmapVolume volume;
+  volume.pose.header.frame_id = scene->getPlanningFrame();
+  volume.pose.pose.orientation.w = 1.0;
+  volume.dimension[0] = 1.0;
+  volume.dimension[1] = 1.0;
+  volume.dimension[2] = 1.0;
+  volume.voxel_resolution[0] = 10;
+  volume.voxel_resolution[1] = 10;
+  volume.voxel_resolution[2] = 10;
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+  occupancy_handler.setVoxelizationMethod(rtr_moveit::OccupancyHandler::OBJECT_LOCAL);
+
+  // octree cell at the center of voxel (5,5,5), small enough to not touch the neighbor voxels
+  std::shared_ptr<octomap::OcTree> octree = std::make_shared<octomap::OcTree>(0.02);
+  octree->updateNode(octomap::point3d(0.55, 0.55, 0.55), true);
+  auto octree_pose = scene->getFrameTransform(scene->getPlanningFrame());
+  scene->processOctomapPtr(octree, octree_pose);
+
+  rtr_moveit::OccupancyData occupancy;
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  ASSERT_EQ(occupancy.voxels.size(), 1u);
+  EXPECT_EQ(occupancy.voxels[0].x, 5);
+
+  // octree updated in place like by the octomap monitor keeps the same shape pointer and pose
+  octree->deleteNode(octomap::point3d(0.55, 0.55, 0.55));
+  octree->updateNode(octomap::point3d(0.25, 0.55, 0.55), true);
+  scene->processOctomapPtr(octree, octree_pose);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  ASSERT_EQ(occupancy.voxels.size(), 1u);
+  EXPECT_EQ(occupancy.voxels[0].x, 2);
+
+  // unchanged octrees return the cached voxels
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  ASSERT_EQ(occupancy.voxels.size(), 1u);
+  EXPECT_EQ(occupancy.voxels[0].x, 2);
+
+  // changed occupancy of existing leaves is detected even if the number of nodes stays the same
+  octree->updateNode(octomap::point3d(0.85, 0.55, 0.55), false);
+  scene->processOctomapPtr(octree, octree_pose);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  octree->updateNode(octomap::point3d(0.25, 0.55, 0.55), false);
+  octree->updateNode(octomap::point3d(0.85, 0.55, 0.55), true);
+  scene->processOctomapPtr(octree, octree_pose);
+  occupancy_handler.fromPlanningScene(scene, volume, occupancy);
+  ASSERT_EQ(occupancy.voxels.size(), 1u);
+  EXPECT_EQ(occupancy.voxels[0].x, 8);
+}
+
+/* This test checks that multi-threaded voxel sweeps return the same voxels as a single thread */
+TEST(TestSuite, voxelizationThreads)
+{
+  ros::NodeHandle nh;
+
+  // instantiate emtpy planning scene
+  urdf::ModelInterfaceSharedPtr urdf_model;
+  urdf_model.reset(new urdf::ModelInterface());
+  srdf::ModelConstSharedPtr srdf_model;
+  srdf_model.reset(new srdf::Model());
+  moveit::core::RobotModelConstPtr robot_model;
+  robot_model.reset(new moveit::core::RobotModel(urdf_model, srdf_model));
+  planning_scene::PlanningScenePtr scene;
+  scene.reset(new planning_scene::PlanningScene(robot_model));
+
+  // specify volume region
+  rtr_moveit::RoadmapVolume volume;
+  volume.pose.header.frame_id = scene->getPlanningFrame();
+  volume.pose.pose.orientation.w = 1.0;
+  volume.dimension[0] = 1.0;
+  volume.dimension[1] = 1.0;
+  volume.dimension[2] = 1.0;
+  volume.voxel_resolution[0] = 10;
+  volume.voxel_resolution[1] = 10;
+  volume.voxel_resolution[2] = 10;
+
+  // voxelize the scene with a new handler, so that no cached voxels are shared between thread counts
+  auto voxelize = [&](rtr_moveit::OccupancyHandler::VoxelizationMethod method, int threads) {
+    rtr_moveit::OccupancyHandler occupancy_handler(nh);
+    occupancy_handler.setVoxelizationMethod(method);
+    occupancy_handler.setVoxelizationThreads(threads);
+    rtr_moveit::OccupancyData occupancy;
+    EXPECT_TRUE(occupancy_handler.fromPlanningScene(scene, volume, occupancy));
+    return occupancy.voxels;
+  };
+  auto expectEqualVoxels = [](const std::vector<rtr::Voxel>& expected, const std::vector<rtr::Voxel>& voxels) {
+    ASSERT_EQ(voxels.size(), expected.size());
+    for (std::size_t i = 0; i < voxels.size(); ++i)
+    {
+      EXPECT_EQ(voxels[i].x, expected[i].x);
+      EXPECT_EQ(voxels[i].y, expected[i].y);
+      EXPECT_EQ(voxels[i].z, expected[i].z);
+    }
+  };
+
+  // box that spans all X slabs and touches the Y/Z volume borders, and a sphere at a slab boundary
+  moveit_msgs::CollisionObject obj;
+  obj.id = "collision_object";
+  obj.header.frame_id = scene->getPlanningFrame();
+  obj.primitives.resize(2);
+  obj.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+  obj.primitives[0].dimensions.resize(3);
+  obj.primitives[0].dimensions[shape_msgs::SolidPrimitive::BOX_X] = 0.98;
+  obj.primitives[0].dimensions[shape_msgs::SolidPrimitive::BOX_Y] = 0.18;
+  obj.primitives[0].dimensions[shape_msgs::SolidPrimitive::BOX_Z] = 0.08;
+  obj.primitives[1].type = shape_msgs::SolidPrimitive::SPHERE;
+  obj.primitives[1].dimensions.resize(1);
+  obj.primitives[1].dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS] = 0.06;
+  obj.primitive_poses.resize(2);
+  obj.primitive_poses[0].orientation.w = 1.0;
+  obj.primitive_poses[0].position.x = 0.5;
+  obj.primitive_poses[0].position.y = 0.1;
+  obj.primitive_poses[0].position.z = 0.95;
+  obj.primitive_poses[1].orientation.w = 1.0;
+  obj.primitive_poses[1].position.x = 0.35;
+  obj.primitive_poses[1].position.y = 0.55;
+  obj.primitive_poses[1].position.z = 0.05;
+  obj.operation = moveit_msgs::CollisionObject::ADD;
+  scene->processCollisionObjectMsg(obj);
+
+  // 10 X voxels are split into uneven slabs by 3 and 4 threads, more threads than voxels use one slab per voxel
+  std::vector<rtr::Voxel> expected = voxelize(rtr_moveit::OccupancyHandler::FULL_SWEEP, 1);
+  EXPECT_FALSE(expected.empty());
+  for (int threads : { 2, 3, 4, 16 })
+  {
+    SCOPED_TRACE("FULL_SWEEP threads: " + std::to_string(threads));
+    expectEqualVoxels(expected, voxelize(rtr_moveit::OccupancyHandler::FULL_SWEEP, threads));
+  }
+
+  // octree cells in every X voxel at changing Y/Z positions, voxelized from the octree leaves with OBJECT_LOCAL
+  obj.operation = moveit_msgs::CollisionObject::REMOVE;
+  scene->processCollisionObjectMsg(obj);
+  std::shared_ptr<octomap::OcTree> octree = std::make_shared<octomap::OcTree>(0.02);
+  for (int x = 0; x < 10; ++x)
+    octree->updateNode(octomap::point3d(0.1 * x + 0.05, 0.1 * ((3 * x) % 10) + 0.05, 0.1 * (9 - x) + 0.05), true);
+  scene->processOctomapPtr(octree, scene->getFrameTransform(scene->getPlanningFrame()));
+
+  expected = voxelize(rtr_moveit::OccupancyHandler::OBJECT_LOCAL, 1);
+  ASSERT_EQ(expected.size(), 10u);
+  for (std::size_t x = 0; x < expected.size(); ++x)
+  {
+    EXPECT_EQ(expected[x].x, x);
+    EXPECT_EQ(expected[x].y, (3 * x) % 10);
+    EXPECT_EQ(expected[x].z, 9 - x);
+  }
+  for (int threads : { 2, 3, 4, 16 })
+  {
+    SCOPED_TRACE("OBJECT_LOCAL threads: " + std::to_string(threads));
+    expectEqualVoxels(expected, voxelize(rtr_moveit::OccupancyHandler::OBJECT_LOCAL, threads));
+  }
+}
+
+/* This test checks conversions and set operations of occupancy grids */
+TEST(TestSuite, occupancyGrid)
+{
+  std::array<uint16_t, 3> resolution = { { 7, 5, 3 } };
+  rtr_moveit::OccupancyGrid grid(resolution);
+  EXPECT_TRUE(grid.empty());
+
+  // voxels are converted back in X/Y/Z order without duplicates
+  std::vector<rtr::Voxel> voxels = { rtr::Voxel(6, 4, 2), rtr::Voxel(0, 0, 0), rtr::Voxel(3, 1, 2),
+                                     rtr::Voxel(3, 1, 2) };
+  EXPECT_TRUE(grid.setOccupied(voxels));
+  EXPECT_FALSE(grid.setOccupied({ rtr::Voxel(7, 0, 0) }));
+  EXPECT_EQ(grid.count(), 3u);
+  EXPECT_TRUE(grid.isOccupied(3, 1, 2));
+  EXPECT_FALSE(grid.isOccupied(3, 2, 1));
+  std::vector<rtr::Voxel> grid_voxels;
+  grid.toVoxels(grid_voxels);
+  ASSERT_EQ(grid_voxels.size(), 3u);
+  EXPECT_EQ(grid_voxels[0].x, 0);
+  EXPECT_EQ(grid_voxels[1].x, 3);
+  EXPECT_EQ(grid_voxels[1].y, 1);
+  EXPECT_EQ(grid_voxels[1].z, 2);
+  EXPECT_EQ(grid_voxels[2].x, 6);
+
+  // set operations
+  rtr_moveit::OccupancyGrid other(resolution);
+  other.setOccupied(3, 1, 2);
+  other.setOccupied(1, 1, 1);
+  rtr_moveit::OccupancyGrid merged = grid;
+  EXPECT_TRUE(merged.merge(other));
+  EXPECT_EQ(merged.count(), 4u);
+  rtr_moveit::OccupancyGrid intersected = grid;
+  EXPECT_TRUE(intersected.intersect(other));
+  EXPECT_EQ(intersected.count(), 1u);
+  EXPECT_TRUE(intersected.isOccupied(3, 1, 2));
+  EXPECT_TRUE(merged.subtract(other));
+  EXPECT_EQ(merged.count(), 2u);
+  EXPECT_FALSE(merged.isOccupied(3, 1, 2));
+
+  // linear index ranges in X/Y/Z order, the grid spans two words
+  EXPECT_TRUE(grid.isAnyOccupied(0, 1));
+  EXPECT_FALSE(grid.isAnyOccupied(1, 50));
+  EXPECT_TRUE(grid.isAnyOccupied(1, 51));
+  EXPECT_FALSE(grid.isAnyOccupied(51, 104));
+  EXPECT_TRUE(grid.isAnyOccupied(51, 105));
+  EXPECT_FALSE(grid.isAnyOccupied(50, 50));
+  merged.setFree(0, 0, 0);
+  merged.setFree(6, 4, 2);
+  EXPECT_TRUE(merged.empty());
+
+  // grids of different resolutions can't be combined
+  rtr_moveit::OccupancyGrid small_grid(std::array<uint16_t, 3>{ { 1, 1, 1 } });
+  EXPECT_FALSE(grid.merge(small_grid));
+  EXPECT_NE(grid, small_grid);
+
+  // equal grids have equal hashes
+  rtr_moveit::OccupancyGrid changed_grid(grid);
+  EXPECT_EQ(changed_grid.hash(), grid.hash());
+  if (changed_grid.isOccupied(0, 0, 0))
+    changed_grid.setFree(0, 0, 0);
+  else
+    changed_grid.setOccupied(0, 0, 0);
+  EXPECT_NE(changed_grid.hash(), grid.hash());
+  EXPECT_NE(small_grid.hash(), grid.hash());
+}
+
+/* This test voxelizes a serialized point cloud with padded points */
+TEST(TestSuite, voxelizePointCloud)
+{
+  ros::NodeHandle nh;
+  rtr_moveit::RoadmapVolume volume;
+  volume.pose.pose.orientation.w = 1.0;
+  volume.dimension[0] = 1.0;
+  volume.dimension[1] = 1.0;
+  volume.dimension[2] = 1.0;
+  volume.voxel_resolution[0] = 10;
+  volume.voxel_resolution[1] = 10;
+  volume.voxel_resolution[2] = 10;
+  rtr_moveit::OccupancyHandler occupancy_handler(nh);
+
+  // points with x/y/z/padding layout, two points are inside the volume
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  const std::vector<float> points = { 0.05, 0.15, 0.25, 0.0, 0.95, 0.95, 0.95, 0.0, 1.05, 0.5,
+                                      0.5,  0.0,  nan,  nan, nan,  0.0,  0.05, 0.15, 0.25, 0.0 };
+  pcl::PCLPointCloud2 cloud;
+  const std::string field_names[3] = { "x", "y", "z" };
+  for (std::size_t i = 0; i < 3; ++i)
+  {
+    pcl::PCLPointField field;
+    field.name = field_names[i];
+    field.offset = i * sizeof(float);
+    field.datatype = pcl::PCLPointField::FLOAT32;
+    field.count = 1;
+    cloud.fields.push_back(field);
+  }
+  cloud.height = 1;
+  cloud.width = points.size() / 4;
+  cloud.point_step = 4 * sizeof(float);
+  cloud.row_step = cloud.width * cloud.point_step;
+  cloud.data.resize(cloud.row_step);
+  std::memcpy(cloud.data.data(), points.data(), cloud.data.size());
+
+  rtr_moveit::OccupancyGrid grid;
+  ASSERT_TRUE(occupancy_handler.voxelizePointCloud(cloud, volume, Eigen::Isometry3d::Identity(), grid));
+  EXPECT_EQ(grid.count(), 2u);
+  EXPECT_TRUE(grid.isOccupied(0, 1, 2));
+  EXPECT_TRUE(grid.isOccupied(9, 9, 9));
+
+  // shifting the cloud moves the points outside of the volume
+  Eigen::Isometry3d volume_to_cloud(Eigen::Translation3d(0.1, 0.0, 0.0));
+  grid.clear();
+  ASSERT_TRUE(occupancy_handler.voxelizePointCloud(cloud, volume, volume_to_cloud, grid));
+  EXPECT_EQ(grid.count(), 1u);
+  EXPECT_TRUE(grid.isOccupied(1, 1, 2));
+
+  // clouds without coordinate fields are rejected
+  cloud.fields.pop_back();
+  EXPECT_FALSE(occupancy_handler.voxelizePointCloud(cloud, volume, Eigen::Isometry3d::Identity(), grid));
+}
+
+/* This test compares KD-tree queries of roadmap configs and poses with the linear search */
+TEST(TestSuite, roadmapIndex)
+{
+  // random items with quantized values to produce equal distances
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> distribution(-10, 10);
+  std::vector<rtr::Config> configs(2000, rtr::Config(6));
+  std::vector<rtr::ToolPose> poses(2000);
+  for (rtr::Config& config : configs)
+    for (float& value : config)
+      value = 0.1 * distribution(generator);
+  for (rtr::ToolPose& pose : poses)
+    for (float& value : pose)
+      value = 0.1 * distribution(generator);
+  rtr_moveit::RoadmapConfigIndex config_index;
+  config_index.build(configs);
+  rtr_moveit::RoadmapPoseIndex pose_index;
+  pose_index.build(poses);
+
+  std::vector<std::size_t> expected_ids, result_ids;
+  std::vector<float> expected_distances, result_distances;
+  for (std::size_t max_results : { 1, 5, 2000 })
+  {
+    for (float distance_threshold : { 0.5f, 2.0f, FLT_MAX })
+    {
+      const rtr::Config& config = configs[max_results - 1];
+      rtr_moveit::findClosestConfigs(config, configs, expected_ids, expected_distances, max_results,
+                                     distance_threshold);
+      config_index.findClosest(config, result_ids, result_distances, max_results, distance_threshold);
+      EXPECT_EQ(result_ids, expected_ids);
+      EXPECT_EQ(result_distances, expected_distances);
+      config_index.findClosestLinear(config, result_ids, result_distances, max_results, distance_threshold);
+      EXPECT_EQ(result_ids, expected_ids);
+      EXPECT_EQ(result_distances, expected_distances);
+
+      const rtr::ToolPose& pose = poses[max_results - 1];
+      rtr_moveit::findClosestPositions(pose, poses, expected_ids, expected_distances, max_results,
+                                       distance_threshold);
+      pose_index.findClosest(pose, result_ids, result_distances, max_results, distance_threshold);
+      EXPECT_EQ(result_ids, expected_ids);
+      EXPECT_EQ(result_distances, expected_distances);
+      pose_index.findClosestLinear(pose, result_ids, result_distances, max_results, distance_threshold);
+      EXPECT_EQ(result_ids, expected_ids);
+      EXPECT_EQ(result_distances, expected_distances);
+    }
+  }
+}
+
+TEST(TestSuite, roadmapDistances)
+{
+  // random items in structure-of-arrays layout, the count is no multiple of any vector width
+  const std::size_t count = 1001;
+  const std::size_t dimension = 7;
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> distribution(-3.0, 3.0);
+  std::vector<rtr::Config> configs(count, rtr::Config(dimension));
+  std::vector<rtr::ToolPose> poses(count);
+  std::vector<float> config_columns(dimension * count);
+  std::vector<float> pose_columns(3 * count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    for (std::size_t j = 0; j < dimension; ++j)
+      config_columns[j * count + i] = configs[i][j] = distribution(generator);
+    for (std::size_t d = 0; d < poses[i].size(); ++d)
+      poses[i][d] = distribution(generator);
+    for (std::size_t d = 0; d < 3; ++d)
+      pose_columns[d * count + i] = poses[i][d];
+  }
+
+  // the batched kernels yield exactly the same distances as the scalar functions, also for batches at an offset
+  rtr::Config config(dimension);
+  rtr::ToolPose pose;
+  for (float& value : config)
+    value = distribution(generator);
+  for (float& value : pose)
+    value = distribution(generator);
+  std::vector<float> distances(count);
+  for (std::size_t offset : { 0, 3 })
+  {
+    const std::size_t batch_count = count - offset;
+    rtr_moveit::computeConfigDistances(config.data(), config_columns.data() + offset, count, dimension, batch_count,
+                                       distances.data());
+    for (std::size_t i = 0; i < batch_count; ++i)
+      ASSERT_EQ(distances[i], rtr_moveit::getConfigDistance(config, configs[offset + i]));
+    rtr_moveit::computePositionDistances(pose.data(), pose_columns.data() + offset, count, batch_count,
+                                         distances.data());
+    for (std::size_t i = 0; i < batch_count; ++i)
+      ASSERT_EQ(distances[i], rtr_moveit::getPositionDistance(pose, poses[offset + i]));
+  }
+}
+
+/* This test loads the test roadmap into the roadmap cache and checks that the roadmap data is shared */
+TEST(TestSuite, roadmapCache)
+{
+  rtr_moveit::RoadmapCache roadmap_cache;
+  rtr_moveit::RoadmapDataConstPtr roadmap_data;
+
+  // roadmap spec without file
+  rtr_moveit::RoadmapSpecification roadmap;
+  roadmap.roadmap_id = "missing_roadmap";
+  roadmap.og_file = ros::package::getPath("rtr_moveit") + "/test/missing_roadmap.og";
+  EXPECT_FALSE(roadmap_cache.getRoadmapData(roadmap, roadmap_data)) << "Missing roadmap file should fail to load";
+  EXPECT_FALSE(roadmap_data);
+
+  // load test roadmap
+  roadmap.roadmap_id = "test_roadmap";
+  roadmap.og_file = ros::package::getPath("rtr_moveit") + "/test/test_roadmap.og";
+  ASSERT_TRUE(roadmap_cache.getRoadmapData(roadmap, roadmap_data));
+  ASSERT_TRUE(roadmap_data);
+  EXPECT_EQ(roadmap_data->spec.roadmap_id, roadmap.roadmap_id);
+  EXPECT_EQ(roadmap_data->spec.volume.pose.header.frame_id, "world");
+  EXPECT_GT(roadmap_data->num_states, 0u);
+  EXPECT_GT(roadmap_data->num_edges, 0u);
+  EXPECT_FALSE(roadmap_data->config_index.empty());
+  EXPECT_FALSE(roadmap_data->pose_index.empty());
+
+  // the cached data is shared
+  rtr_moveit::RoadmapDataConstPtr cached_roadmap_data;
+  ASSERT_TRUE(roadmap_cache.getRoadmapData(roadmap, cached_roadmap_data));
+  EXPECT_EQ(cached_roadmap_data, roadmap_data);
+
+  // removed roadmaps are loaded again while previous data stays valid
+  roadmap_cache.removeRoadmap(roadmap.roadmap_id);
+  ASSERT_TRUE(roadmap_cache.getRoadmapData(roadmap, cached_roadmap_data));
+  EXPECT_NE(cached_roadmap_data, roadmap_data);
+  ASSERT_EQ(cached_roadmap_data->num_states, roadmap_data->num_states);
+  const std::size_t config_values = roadmap_data->num_states * roadmap_data->dimension;
+  EXPECT_TRUE(std::equal(roadmap_data->configs, roadmap_data->configs + config_values, cached_roadmap_data->configs));
+}
+
+/* This test writes roadmap data into a snapshot buffer and file and compares the mapped views */
+TEST(TestSuite, roadmapSnapshot)
+{
+  rtr_moveit::RoadmapSpecification spec;
+  spec.volume.pose.header.frame_id = "world";
+  spec.volume.pose.pose.position.x = 0.5;
+  spec.volume.pose.pose.orientation.w = 1.0;
+  spec.volume.dimension = { 1.0, 0.5, 0.25 };
+  spec.volume.voxel_resolution = { 64, 32, 16 };
+  spec.base_link_frame = "base_link";
+  spec.end_effector_frame = "tool0";
+  std::vector<rtr::Config> configs = { { 0.0, 0.1, 0.2 }, { 1.0, 1.1, 1.2 }, { 2.0, 2.1, 2.2 } };
+  std::vector<rtr::ToolPose> poses(configs.size());
+  for (std::size_t i = 0; i < poses.size(); ++i)
+    poses[i].fill(i);
+  std::vector<rtr::EdgeInfo> edges(2);
+  edges[0].start_index = 0;
+  edges[0].end_index = 1;
+  edges[1].start_index = 1;
+  edges[1].end_index = 2;
+  rtr_moveit::RoadmapFileStamp stamp{ 1234, 5678 };
+
+  std::vector<char> buffer;
+  rtr_moveit::writeRoadmapBuffer(spec, configs, poses, edges, stamp, buffer);
+
+  // buffers of other .og file versions are rejected
+  rtr_moveit::RoadmapData roadmap_data;
+  rtr_moveit::RoadmapFileStamp other_stamp{ 1234, 5679 };
+  EXPECT_FALSE(rtr_moveit::readRoadmapBuffer(nullptr, buffer.data(), buffer.size(), other_stamp, roadmap_data));
+  EXPECT_FALSE(rtr_moveit::readRoadmapBuffer(nullptr, buffer.data(), buffer.size() - 1, stamp, roadmap_data));
+
+  // write and map snapshot file
+  const std::string snapshot_file = "/tmp/rtr_moveit_test_" + std::to_string(getpid()) + ".rmap";
+  ASSERT_TRUE(rtr_moveit::writeRoadmapFile(snapshot_file, buffer));
+  std::shared_ptr<const void> storage;
+  const char* data;
+  std::size_t size;
+  ASSERT_TRUE(rtr_moveit::mapRoadmapFile(snapshot_file, storage, data, size));
+  std::remove(snapshot_file.c_str());  // the mapping remains valid
+  ASSERT_TRUE(rtr_moveit::readRoadmapBuffer(storage, data, size, stamp, roadmap_data));
+
+  EXPECT_EQ(roadmap_data.spec.volume.pose.header.frame_id, spec.volume.pose.header.frame_id);
+  EXPECT_EQ(roadmap_data.spec.volume.pose.pose.position.x, spec.volume.pose.pose.position.x);
+  EXPECT_EQ(roadmap_data.spec.volume.pose.pose.orientation.w, spec.volume.pose.pose.orientation.w);
+  EXPECT_EQ(roadmap_data.spec.volume.dimension, spec.volume.dimension);
+  EXPECT_EQ(roadmap_data.spec.volume.voxel_resolution, spec.volume.voxel_resolution);
+  EXPECT_EQ(roadmap_data.spec.base_link_frame, spec.base_link_frame);
+  EXPECT_EQ(roadmap_data.spec.end_effector_frame, spec.end_effector_frame);
+  ASSERT_EQ(roadmap_data.dimension, 3u);
+  ASSERT_EQ(roadmap_data.num_states, configs.size());
+  ASSERT_EQ(roadmap_data.num_edges, edges.size());
+  for (std::size_t i = 0; i < configs.size(); ++i)
+  {
+    EXPECT_TRUE(std::equal(configs[i].begin(), configs[i].end(), roadmap_data.getConfig(i)));
+    EXPECT_TRUE(std::equal(poses[i].begin(), poses[i].end(), roadmap_data.getPose(i)));
+  }
+  for (std::size_t i = 0; i < edges.size(); ++i)
+  {
+    EXPECT_EQ(roadmap_data.getEdgeStart(i), edges[i].start_index);
+    EXPECT_EQ(roadmap_data.getEdgeEnd(i), edges[i].end_index);
+  }
+}
+
+TEST(TestSuite, roadmapCoverage)
+{
+  rtr_moveit::RoadmapSpecification spec;
+  spec.base_link_frame = "base_link";
+  spec.end_effector_frame = "tool0";
+  std::vector<rtr::Config> configs = { { 0.0, -1.0 }, { 1.0, 0.0 }, { 0.5, 1.0 } };
+  std::vector<rtr::ToolPose> poses(configs.size());
+  for (std::size_t i = 0; i < poses.size(); ++i)
+  {
+    poses[i].fill(0.0);
+    poses[i][0] = 0.3 * i;
+    poses[i][2] = 0.5;
+  }
+  rtr_moveit::RoadmapFileStamp stamp{ 1234, 5678 };
+  std::vector<char> roadmap_buffer;
+  rtr_moveit::writeRoadmapBuffer(spec, configs, poses, { rtr::EdgeInfo() }, stamp, roadmap_buffer);
+  rtr_moveit::RoadmapData roadmap_data;
+  ASSERT_TRUE(rtr_moveit::readRoadmapBuffer(nullptr, roadmap_buffer.data(), roadmap_buffer.size(), stamp,
+                                            roadmap_data));
+
+  rtr_moveit::RoadmapCoverage coverage;
+  coverage.build(roadmap_data, 0.05);
+  EXPECT_EQ(coverage.getBaseLinkFrame(), spec.base_link_frame);
+  EXPECT_EQ(coverage.getEndEffectorFrame(), spec.end_effector_frame);
+  ASSERT_EQ(coverage.getDimension(), 2u);
+
+  // joint bounds are [0, 1] x [-1, 1]
+  const double inf = std::numeric_limits<double>::infinity();
+  EXPECT_DOUBLE_EQ(coverage.getJointDistance({ 0.5, 0.5 }, { 0.5, 0.5 }), 0.0);
+  EXPECT_NEAR(coverage.getJointDistance({ 1.5, 2.0 }, { 1.5, 2.0 }), 1.5, 1e-6);
+  EXPECT_NEAR(coverage.getJointDistance({ -0.25, -inf }, { -0.25, inf }), 0.25, 1e-6);
+  EXPECT_DOUBLE_EQ(coverage.getJointDistance({ 5.0 }, { 5.0 }), 0.0);
+
+  // tool positions are (0, 0, 0.5), (0.3, 0, 0.5) and (0.6, 0, 0.5)
+  EXPECT_TRUE(coverage.coversPosition(Eigen::Vector3d(0.3, 0.0, 0.5), 0.01));
+  EXPECT_TRUE(coverage.coversPosition(Eigen::Vector3d(0.6, 0.2, 0.5), 0.21));
+  EXPECT_FALSE(coverage.coversPosition(Eigen::Vector3d(0.15, 0.0, 0.5), 0.05));
+  EXPECT_FALSE(coverage.coversPosition(Eigen::Vector3d(0.3, 0.0, 1.0), 0.3));
+  EXPECT_FALSE(coverage.coversPosition(Eigen::Vector3d(-1.0, 0.0, 0.5), 0.5));
+
+  // serialized coverage maps are only valid for the same .og file version and cell size
+  std::vector<char> buffer;
+  coverage.serialize(stamp, buffer);
+  rtr_moveit::RoadmapCoverage loaded_coverage;
+  EXPECT_FALSE(loaded_coverage.deserialize(buffer.data(), buffer.size(), { 1234, 5679 }, 0.05));
+  EXPECT_FALSE(loaded_coverage.deserialize(buffer.data(), buffer.size(), stamp, 0.1));
+  EXPECT_FALSE(loaded_coverage.deserialize(buffer.data(), buffer.size() - 1, stamp, 0.05));
+  ASSERT_TRUE(loaded_coverage.deserialize(buffer.data(), buffer.size(), stamp, 0.05));
+  EXPECT_EQ(loaded_coverage.getBaseLinkFrame(), spec.base_link_frame);
+  EXPECT_EQ(loaded_coverage.getEndEffectorFrame(), spec.end_effector_frame);
+  EXPECT_NEAR(loaded_coverage.getJointDistance({ 1.5, 2.0 }, { 1.5, 2.0 }), 1.5, 1e-6);
+  EXPECT_TRUE(loaded_coverage.coversPosition(Eigen::Vector3d(0.6, 0.2, 0.5), 0.21));
+  EXPECT_FALSE(loaded_coverage.coversPosition(Eigen::Vector3d(0.15, 0.0, 0.5), 0.05));
+
+  // the roadmap cache keeps separate coverage maps for each cell size
+  spec.roadmap_id = "rtr_moveit_test_coverage_" + std::to_string(getpid());
+  spec.og_file = "/tmp/" + spec.roadmap_id + ".og";
+  ASSERT_TRUE(rtr_moveit::writeRoadmapFile(spec.og_file, std::vector<char>(1)));
+  rtr_moveit::RoadmapFileStamp og_stamp;
+  ASSERT_TRUE(rtr_moveit::getRoadmapFileStamp(spec.og_file, og_stamp));
+  rtr_moveit::writeRoadmapBuffer(spec, configs, poses, { rtr::EdgeInfo() }, og_stamp, roadmap_buffer);
+  const std::string snapshot_file = "/tmp/" + spec.roadmap_id + ".rmap";
+  ASSERT_TRUE(rtr_moveit::writeRoadmapFile(snapshot_file, roadmap_buffer));
+  rtr_moveit::RoadmapCache roadmap_cache("/tmp");
+  rtr_moveit::RoadmapCoverageConstPtr coarse_coverage, fine_coverage, cached_coverage;
+  ASSERT_TRUE(roadmap_cache.getRoadmapCoverage(spec, 0.1, false, coarse_coverage));
+  ASSERT_TRUE(roadmap_cache.getRoadmapCoverage(spec, 0.05, false, fine_coverage));
+  ASSERT_TRUE(roadmap_cache.getRoadmapCoverage(spec, 0.1, false, cached_coverage));
+  std::remove(snapshot_file.c_str());
+  std::remove(spec.og_file.c_str());
+  EXPECT_DOUBLE_EQ(coarse_coverage->getCellSize(), 0.1);
+  EXPECT_DOUBLE_EQ(fine_coverage->getCellSize(), 0.05);
+  EXPECT_EQ(cached_coverage, coarse_coverage);
+}
+
+/* This test sweeps a box on a single joint arm along two roadmap edges and checks collisions with occupancy data */
+TEST(TestSuite, roadmapSweptVolumes)
+{
+  // the box link center moves on a circle with radius 0.5 around the Z axis of base_link
+  urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(
+      "<robot name=\"swept_volumes_robot\"><link name=\"base_link\"/><link name=\"arm_link\"><collision>"
+      "<origin xyz=\"0.5 0 0\"/><geometry><box size=\"0.1 0.1 0.1\"/></geometry></collision></link>"
+      "<joint name=\"joint\" type=\"revolute\"><parent link=\"base_link\"/><child link=\"arm_link\"/>"
+      "<axis xyz=\"0 0 1\"/><limit lower=\"-3.2\" upper=\"3.2\" effort=\"1\" velocity=\"1\"/></joint></robot>");
+  ASSERT_TRUE(urdf_model != nullptr);
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  srdf_model->initString(*urdf_model, "<robot name=\"swept_volumes_robot\"><group name=\"arm\"><joint "
+                                      "name=\"joint\"/></group></robot>");
+  moveit::core::RobotModelConstPtr robot_model(new moveit::core::RobotModel(urdf_model, srdf_model));
+  moveit::core::RobotState default_state(robot_model);
+  default_state.setToDefaultValues();
+  default_state.update();
+
+  // volume of 20x20x10 voxels with 0.1m edge length centered at base_link
+  rtr_moveit::RoadmapSpecification spec;
+  spec.volume.pose.header.frame_id = "base_link";
+  spec.volume.pose.pose.position.x = -1.0;
+  spec.volume.pose.pose.position.y = -1.0;
+  spec.volume.pose.pose.position.z = -0.5;
+  spec.volume.pose.pose.orientation.w = 1.0;
+  spec.volume.dimension = { 2.0, 2.0, 1.0 };
+  spec.volume.voxel_resolution = { 20, 20, 10 };
+  std::vector<rtr::Config> configs = { { 0.0 }, { float(M_PI_2) }, { float(M_PI) } };
+  std::vector<rtr::ToolPose> poses(configs.size());
+  std::vector<rtr::EdgeInfo> edges(2);
+  edges[0].start_index = 0;
+  edges[0].end_index = 1;
+  edges[1].start_index = 1;
+  edges[1].end_index = 2;
+  rtr_moveit::RoadmapFileStamp stamp{ 1234, 5678 };
+  std::vector<char> roadmap_buffer;
+  rtr_moveit::writeRoadmapBuffer(spec, configs, poses, edges, stamp, roadmap_buffer);
+  rtr_moveit::RoadmapData roadmap_data;
+  ASSERT_TRUE(rtr_moveit::readRoadmapBuffer(nullptr, roadmap_buffer.data(), roadmap_buffer.size(), stamp,
+                                            roadmap_data));
+
+  rtr_moveit::RoadmapSweptVolumes swept_volumes;
+  EXPECT_FALSE(swept_volumes.build(roadmap_data, default_state, "unknown_group", 0.05, 1));
+  ASSERT_TRUE(swept_volumes.build(roadmap_data, default_state, "arm", 0.05, 2));
+  ASSERT_EQ(swept_volumes.getNumEdges(), edges.size());
+
+  // obstacles in the first quadrant, the second quadrant and outside of the arm's reach
+  std::vector<uint8_t> collisions;
+  rtr_moveit::OccupancyData occupancy;
+  occupancy.type = rtr_moveit::OccupancyData::Type::VOXELS;
+  occupancy.voxels = { rtr::Voxel(13, 13, 5) };
+  ASSERT_TRUE(swept_volumes.checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 1, 0 }));
+  occupancy.voxels = { rtr::Voxel(6, 13, 5) };
+  ASSERT_TRUE(swept_volumes.checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 0, 1 }));
+  occupancy.voxels = { rtr::Voxel(19, 1, 5), rtr::Voxel(10, 10, 0) };
+  ASSERT_TRUE(swept_volumes.checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 0, 0 }));
+
+  // grids and point clouds in the volume frame give the same results
+  occupancy.type = rtr_moveit::OccupancyData::Type::GRID;
+  occupancy.grid.resize(spec.volume.voxel_resolution);
+  occupancy.grid.setOccupied(13, 13, 5);
+  ASSERT_TRUE(swept_volumes.checkScene(occupancy, collisions, 2));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 1, 0 }));
+  occupancy.grid.resize({ 10, 10, 10 });
+  EXPECT_FALSE(swept_volumes.checkScene(occupancy, collisions, 1));
+  occupancy.type = rtr_moveit::OccupancyData::Type::POINT_CLOUD;
+  pcl::PointCloud<pcl::PointXYZ>::Ptr cloud(new pcl::PointCloud<pcl::PointXYZ>());
+  cloud->push_back(pcl::PointXYZ(-0.35, 0.35, 0.0));
+  cloud->push_back(pcl::PointXYZ(5.0, 0.0, 0.0));
+  occupancy.point_cloud = cloud;
+  ASSERT_TRUE(swept_volumes.checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 0, 1 }));
+
+  // serialized swept volumes are only valid for the same .og file version and robot geometry
+  std::vector<char> buffer;
+  swept_volumes.serialize(stamp, buffer);
+  const uint64_t fingerprint = rtr_moveit::RoadmapSweptVolumes::getFingerprint(default_state, "arm", 0.05);
+  EXPECT_NE(fingerprint, rtr_moveit::RoadmapSweptVolumes::getFingerprint(default_state, "arm", 0.1));
+  rtr_moveit::RoadmapSweptVolumes loaded_swept_volumes;
+  EXPECT_FALSE(loaded_swept_volumes.deserialize(buffer.data(), buffer.size(), { 1234, 5679 }, fingerprint));
+  EXPECT_FALSE(loaded_swept_volumes.deserialize(buffer.data(), buffer.size(), stamp, fingerprint + 1));
+  EXPECT_FALSE(loaded_swept_volumes.deserialize(buffer.data(), buffer.size() - 1, stamp, fingerprint));
+  ASSERT_TRUE(loaded_swept_volumes.deserialize(buffer.data(), buffer.size(), stamp, fingerprint));
+  ASSERT_EQ(loaded_swept_volumes.getNumEdges(), edges.size());
+  for (std::size_t i = 0; i < edges.size(); ++i)
+  {
+    std::vector<std::pair<uint32_t, uint32_t>> ranges, loaded_ranges;
+    swept_volumes.getEdgeVoxelRanges(i, ranges);
+    loaded_swept_volumes.getEdgeVoxelRanges(i, loaded_ranges);
+    EXPECT_FALSE(ranges.empty());
+    EXPECT_EQ(ranges, loaded_ranges);
+  }
+  ASSERT_TRUE(loaded_swept_volumes.checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 0, 1 }));
+}
+
+/* This test configures planning contexts of two groups that share one roadmap and checks that each group keeps
+ * its own specification and collision checks */
+TEST(TestSuite, sharedRoadmapGroups)
+{
+  ros::NodeHandle nh;
+  ros::NodeHandle private_nh("~");
+  private_nh.setParam("planner_config/allowed_position_distance", 0.01);
+  private_nh.setParam("planner_config/allowed_joint_distance", 0.1);
+  private_nh.setParam("planner_config/max_goal_states", 1);
+  private_nh.setParam("planner_config/max_waypoint_distance", 0.01);
+
+  // the box links of both arms move on a circle with radius 0.5 around the Z axis of base_link, starting at opposite
+  // sides of the circle
+  urdf::ModelInterfaceSharedPtr urdf_model = urdf::parseURDF(
+      "<robot name=\"two_arm_robot\"><link name=\"base_link\"/><link name=\"arm_link\"><collision>"
+      "<origin xyz=\"0.5 0 0\"/><geometry><box size=\"0.1 0.1 0.1\"/></geometry></collision></link>"
+      "<link name=\"other_arm_link\"><collision><origin xyz=\"-0.5 0 0\"/><geometry><box size=\"0.1 0.1 0.1\"/>"
+      "</geometry></collision></link>"
+      "<joint name=\"joint\" type=\"revolute\"><parent link=\"base_link\"/><child link=\"arm_link\"/>"
+      "<axis xyz=\"0 0 1\"/><limit lower=\"-3.2\" upper=\"3.2\" effort=\"1\" velocity=\"1\"/></joint>"
+      "<joint name=\"other_joint\" type=\"revolute\"><parent link=\"base_link\"/><child link=\"other_arm_link\"/>"
+      "<axis xyz=\"0 0 1\"/><limit lower=\"-3.2\" upper=\"3.2\" effort=\"1\" velocity=\"1\"/></joint></robot>");
+  ASSERT_TRUE(urdf_model != nullptr);
+  srdf::ModelSharedPtr srdf_model(new srdf::Model());
+  srdf_model->initString(*urdf_model, "<robot name=\"two_arm_robot\"><group name=\"arm\"><joint name=\"joint\"/>"
+                                      "</group><group name=\"other_arm\"><joint name=\"other_joint\"/></group>"
+                                      "</robot>");
+  moveit::core::RobotModelConstPtr robot_model(new moveit::core::RobotModel(urdf_model, srdf_model));
+  planning_scene::PlanningScenePtr scene(new planning_scene::PlanningScene(robot_model));
+  robot_state::RobotState default_state(robot_model);
+  default_state.setToDefaultValues();
+  default_state.update();
+
+  // roadmap snapshot of a .og file version, so that the roadmap is mapped without reading the .og file
+  const std::string roadmap_id = "rtr_moveit_test_shared_" + std::to_string(getpid());
+  rtr_moveit::RoadmapSpecification spec;
+  spec.roadmap_id = roadmap_id;
+  spec.og_file = "/tmp/" + roadmap_id + ".og";
+  ASSERT_TRUE(rtr_moveit::writeRoadmapFile(spec.og_file, std::vector<char>(1)));
+  rtr_moveit::RoadmapFileStamp stamp;
+  ASSERT_TRUE(rtr_moveit::getRoadmapFileStamp(spec.og_file, stamp));
+  rtr_moveit::RoadmapSpecification file_spec;
+  file_spec.volume.pose.header.frame_id = "base_link";
+  file_spec.volume.pose.pose.position.x = -1.0;
+  file_spec.volume.pose.pose.position.y = -1.0;
+  file_spec.volume.pose.pose.position.z = -0.5;
+  file_spec.volume.pose.pose.orientation.w = 1.0;
+  file_spec.volume.dimension = { 2.0, 2.0, 1.0 };
+  file_spec.volume.voxel_resolution = { 20, 20, 10 };
+  file_spec.base_link_frame = "base_link";
+  file_spec.end_effector_frame = "arm_link";
+  std::vector<rtr::Config> configs = { { 0.0 }, { float(M_PI_2) }, { float(M_PI) } };
+  std::vector<rtr::ToolPose> poses(configs.size());
+  std::vector<rtr::EdgeInfo> edges(2);
+  edges[0].start_index = 0;
+  edges[0].end_index = 1;
+  edges[1].start_index = 1;
+  edges[1].end_index = 2;
+  std::vector<char> buffer;
+  rtr_moveit::writeRoadmapBuffer(file_spec, configs, poses, edges, stamp, buffer);
+  const std::string snapshot_file = "/tmp/" + roadmap_id + ".rmap";
+  ASSERT_TRUE(rtr_moveit::writeRoadmapFile(snapshot_file, buffer));
+
+  // the roadmap is preloaded without a group like by the planner manager
+  rtr_moveit::RoadmapCachePtr roadmap_cache = std::make_shared<rtr_moveit::RoadmapCache>("/tmp");
+  ASSERT_TRUE(roadmap_cache->loadRoadmap(spec));
+  rtr_moveit::RoadmapSweptVolumesConstPtr arm_swept_volumes, other_arm_swept_volumes;
+  ASSERT_TRUE(roadmap_cache->getRoadmapSweptVolumes(spec, default_state, "arm", 0.05, 1, false, arm_swept_volumes));
+  ASSERT_TRUE(roadmap_cache->getRoadmapSweptVolumes(spec, default_state, "other_arm", 0.05, 1, false,
+                                                    other_arm_swept_volumes));
+  std::remove(snapshot_file.c_str());
+  std::remove(spec.og_file.c_str());
+  EXPECT_NE(arm_swept_volumes, other_arm_swept_volumes);
+
+  // the first edge of each arm sweeps another quadrant of the circle
+  rtr_moveit::OccupancyData occupancy;
+  occupancy.type = rtr_moveit::OccupancyData::Type::VOXELS;
+  std::vector<uint8_t> collisions;
+  occupancy.voxels = { rtr::Voxel(13, 13, 5) };
+  ASSERT_TRUE(arm_swept_volumes->checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 1, 0 }));
+  ASSERT_TRUE(other_arm_swept_volumes->checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 0, 0 }));
+  occupancy.voxels = { rtr::Voxel(6, 6, 5) };
+  ASSERT_TRUE(arm_swept_volumes->checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 0, 0 }));
+  ASSERT_TRUE(other_arm_swept_volumes->checkScene(occupancy, collisions, 1));
+  EXPECT_EQ(collisions, std::vector<uint8_t>({ 1, 0 }));
+
+  // contexts keep their group and roadmap file, only the volume and frames are read from the shared roadmap data
+  rtr_moveit::RTRPlannerInterfacePtr planner_interface = std::make_shared<rtr_moveit::RTRPlannerInterface>(nh);
+  planner_interface->setSweptVolumes("arm", roadmap_id, arm_swept_volumes);
+  std::shared_ptr<rtr_moveit::OccupancyHandler> occupancy_handler =
+      std::make_shared<rtr_moveit::OccupancyHandler>(nh);
+  std::vector<std::shared_ptr<rtr_moveit::RTRPlanningContext>> contexts;
+  for (const std::string& group : std::vector<std::string>({ "arm", "other_arm" }))
+  {
+    contexts.push_back(std::make_shared<rtr_moveit::RTRPlanningContext>(group, spec, planner_interface, nullptr));
+    contexts.back()->setPlanningScene(scene);
+    contexts.back()->setOccupancyHandler(occupancy_handler);
+    contexts.back()->setRoadmapCache(roadmap_cache);
+    moveit_msgs::MoveItErrorCodes error_code;
+    contexts.back()->configure(error_code);
+    ASSERT_EQ(error_code.val, moveit_msgs::MoveItErrorCodes::SUCCESS);
+    const rtr_moveit::RoadmapSpecification& context_spec = contexts.back()->getRoadmapSpecification();
+    EXPECT_EQ(context_spec.group_name, group);
+    EXPECT_EQ(context_spec.roadmap_id, roadmap_id);
+    EXPECT_EQ(context_spec.og_file, spec.og_file);
+    EXPECT_EQ(context_spec.volume.pose.header.frame_id, "base_link");
+    EXPECT_EQ(context_spec.volume.voxel_resolution, file_spec.volume.voxel_resolution);
+    EXPECT_EQ(context_spec.end_effector_frame, "arm_link");
+  }
+
+  // without the MPA, groups without swept volumes fail instead of planning without collision checks
+  rtr_moveit::RoadmapCollisions roadmap_collisions;
+  EXPECT_FALSE(planner_interface->checkScene(contexts[1]->getRoadmapSpecification(), occupancy, roadmap_collisions));
+  EXPECT_TRUE(roadmap_collisions.collisions.empty());
+}
+
+TEST(TestSuite, bisectionOrder)
+{
+  // end points first, then the midpoints of each level
+  EXPECT_EQ(rtr_moveit::getBisectionOrder(0), std::vector<std::size_t>({ 0 }));
+  EXPECT_EQ(rtr_moveit::getBisectionOrder(1), std::vector<std::size_t>({ 1, 0 }));
+  EXPECT_EQ(rtr_moveit::getBisectionOrder(2), std::vector<std::size_t>({ 2, 0, 1 }));
+  EXPECT_EQ(rtr_moveit::getBisectionOrder(7), std::vector<std::size_t>({ 7, 0, 3, 1, 5, 2, 4, 6 }));
+
+  // every step is contained exactly once
+  for (std::size_t step_count : { 0, 1, 2, 7, 100 })
+  {
+    std::vector<std::size_t> steps = rtr_moveit::getBisectionOrder(step_count);
+    std::sort(steps.begin(), steps.end());
+    std::vector<std::size_t> expected_steps(step_count + 1);
+    std::iota(expected_steps.begin(), expected_steps.end(), 0);
+    EXPECT_EQ(steps, expected_steps);
+  }
+}
+
+TEST(TestSuite, toolPoseGoal)
+{
+  // position tolerance is the radius of the largest sphere inside the constraint region
+  shape_msgs::SolidPrimitive region;
+  double tolerance;
+  region.type = shape_msgs::SolidPrimitive::SPHERE;
+  region.dimensions = { 0.1 };
+  ASSERT_TRUE(rtr_moveit::getRegionTolerance(region, tolerance));
+  EXPECT_DOUBLE_EQ(tolerance, 0.1);
+  region.type = shape_msgs::SolidPrimitive::BOX;
+  region.dimensions = { 0.4, 0.2, 0.6 };
+  ASSERT_TRUE(rtr_moveit::getRegionTolerance(region, tolerance));
+  EXPECT_DOUBLE_EQ(tolerance, 0.1);
+  region.type = shape_msgs::SolidPrimitive::CYLINDER;
+  region.dimensions.resize(2);
+  region.dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT] = 0.1;
+  region.dimensions[shape_msgs::SolidPrimitive::CYLINDER_RADIUS] = 0.3;
+  ASSERT_TRUE(rtr_moveit::getRegionTolerance(region, tolerance));
+  EXPECT_DOUBLE_EQ(tolerance, 0.05);
+  region.dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT] = 1.0;
+  ASSERT_TRUE(rtr_moveit::getRegionTolerance(region, tolerance));
+  EXPECT_DOUBLE_EQ(tolerance, 0.3);
+
+  // unknown primitives and invalid dimensions are rejected
+  region.type = shape_msgs::SolidPrimitive::CONE;
+  EXPECT_FALSE(rtr_moveit::getRegionTolerance(region, tolerance));
+  region.type = shape_msgs::SolidPrimitive::BOX;
+  EXPECT_FALSE(rtr_moveit::getRegionTolerance(region, tolerance));
+
+  // roll/pitch/yaw around the fixed axes are recovered, including negative angles
+  const std::vector<Eigen::Vector3d> rpys = { { 0.0, 0.0, -0.1 }, { 0.2, -0.3, -2.5 }, { -1.0, 0.4, 3.0 } };
+  for (const Eigen::Vector3d& rpy : rpys)
+  {
+    const Eigen::Matrix3d rotation((Eigen::AngleAxisd(rpy[2], Eigen::Vector3d::UnitZ()) *
+                                    Eigen::AngleAxisd(rpy[1], Eigen::Vector3d::UnitY()) *
+                                    Eigen::AngleAxisd(rpy[0], Eigen::Vector3d::UnitX()))
+                                       .toRotationMatrix());
+    double roll, pitch, yaw;
+    rtr_moveit::getRollPitchYaw(rotation, roll, pitch, yaw);
+    EXPECT_NEAR(roll, rpy[0], 1e-9);
+    EXPECT_NEAR(pitch, rpy[1], 1e-9);
+    EXPECT_NEAR(yaw, rpy[2], 1e-9);
+  }
+}
+
+TEST(TestSuite, latencyHistogram)
+{
+  rtr_moveit::LatencyHistogram histogram;
+  EXPECT_EQ(histogram.getSummary().count, 0u);
+  EXPECT_EQ(histogram.getSummary().p99, 0.0);
+
+  // record 1ms..100ms from multiple threads
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < 4; ++t)
+    threads.emplace_back([&histogram, t]() {
+      for (std::size_t i = t + 1; i <= 100; i += 4)
+        histogram.record(1e-3 * i);
+    });
+  for (std::thread& thread : threads)
+    thread.join();
+
+  // percentiles are bucket bounds with a relative error of up to 2^(1/4)
+  rtr_moveit::LatencyHistogram::Summary summary = histogram.getSummary();
+  EXPECT_EQ(summary.count, 100u);
+  EXPECT_NEAR(summary.max, 0.1, 1e-9);
+  EXPECT_GE(summary.p50, 0.050);
+  EXPECT_LE(summary.p50, 0.050 * 1.19);
+  EXPECT_GE(summary.p99, 0.099);
+  EXPECT_LE(summary.p99, summary.max);
+
+  // out of range samples end up in the first and last bucket
+  histogram.reset();
+  histogram.record(-1.0);
+  histogram.record(1e3);
+  summary = histogram.getSummary();
+  EXPECT_EQ(summary.count, 2u);
+  EXPECT_NEAR(summary.max, 1e3, 1e-6);
+}
+
 int main(int argc, char** argv)
 {
   testing::InitGoogleTest(&argc, argv);